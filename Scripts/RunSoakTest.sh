@@ -0,0 +1,91 @@
+#!/usr/bin/env bash
+#
+# Headless soak test - A dedicated server and N bot clients on loopback, each writing a JSON report when done.
+#
+# Usage: Scripts/RunSoakTest.sh <path to UE4Editor> [NumClients] [DurationSeconds]
+#
+# Environment:
+#   MAP           Map to run (default /Game/Maps/UM_TespMap)
+#   PORT          Server port (default 7777)
+#   OUT_DIR       Where reports and logs go (default Saved/Soak/<timestamp>)
+#   SERVER_PKT    Packet simulation for everything the server sends, e.g. "-NTPktLag=50 -NTPktLoss=2"
+#   CLIENT_PKT    Packet simulation for every client, e.g. "-NTPktLag=50 -NTPktLagVariance=20 -NTPktOrder=1"
+#   CLIENT_PKT_<n> Overrides CLIENT_PKT for client n, counting from 1
+#   BOT_ARGS      Extra bot arguments, e.g. "-NTBotScript=1,5,9,0 -NTBotHold=0.5"
+
+set -euo pipefail
+
+if [ $# -lt 1 ]; then
+	echo "Usage: $0 <path to UE4Editor> [NumClients] [DurationSeconds]"
+	exit 1
+fi
+
+UE_BIN="$1"
+NUM_CLIENTS="${2:-4}"
+DURATION="${3:-60}"
+
+PROJECT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+UPROJECT="$PROJECT_DIR/NTGame.uproject"
+MAP="${MAP:-/Game/Maps/UM_TespMap}"
+PORT="${PORT:-7777}"
+OUT_DIR="${OUT_DIR:-$PROJECT_DIR/Saved/Soak/$(date +%Y%m%d_%H%M%S)}"
+
+COMMON_ARGS="-nullrhi -nosound -unattended -nosplash -NTSoak"
+
+mkdir -p "$OUT_DIR"
+PIDS=()
+
+cleanup()
+{
+	for PID in "${PIDS[@]}"; do
+		kill "$PID" 2>/dev/null || true
+	done
+}
+trap cleanup EXIT
+
+# Clients join a little after the server, and each measures from when it joins, so give the server some slack
+"$UE_BIN" "$UPROJECT" "$MAP" -server -port="$PORT" $COMMON_ARGS ${SERVER_PKT:-} \
+	-NTSoakDuration="$((DURATION + 15))" -NTSoakReport="$OUT_DIR/server.json" \
+	-log="$OUT_DIR/server.log" > /dev/null 2>&1 &
+SERVER_PID=$!
+PIDS+=("$SERVER_PID")
+
+sleep 10
+
+for i in $(seq 1 "$NUM_CLIENTS"); do
+	PKT_VAR="CLIENT_PKT_$i"
+	PKT="${!PKT_VAR:-${CLIENT_PKT:-}}"
+
+	"$UE_BIN" "$UPROJECT" "127.0.0.1:$PORT" -game $COMMON_ARGS $PKT ${BOT_ARGS:-} \
+		-NTBot -NTBotSeed="$i" -NTSoakDuration="$DURATION" -NTSoakReport="$OUT_DIR/client_$i.json" \
+		-log="$OUT_DIR/client_$i.log" > /dev/null 2>&1 &
+	PIDS+=("$!")
+done
+
+# Everything quits by itself once its report is written. Anything still running well after that is stuck.
+TIMEOUT=$((DURATION + 120))
+for PID in "${PIDS[@]}"; do
+	while kill -0 "$PID" 2>/dev/null && [ "$SECONDS" -lt "$TIMEOUT" ]; do
+		sleep 1
+	done
+done
+
+# Gather the individual reports into one
+REPORT="$OUT_DIR/report.json"
+{
+	echo "{"
+	echo "  \"clients\": $NUM_CLIENTS,"
+	echo "  \"duration\": $DURATION,"
+	echo "  \"reports\": ["
+	FIRST=1
+	for FILE in "$OUT_DIR/server.json" "$OUT_DIR"/client_*.json; do
+		[ -f "$FILE" ] || continue
+		[ "$FIRST" -eq 1 ] || echo ","
+		cat "$FILE"
+		FIRST=0
+	done
+	echo "  ]"
+	echo "}"
+} > "$REPORT"
+
+echo "Soak report: $REPORT"
@@ -0,0 +1,238 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NTGame.h"
+#include "NTAckSystem.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Messages Acked"), STAT_NTMessagesAcked, STATGROUP_NTNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Messages Lost"), STAT_NTMessagesLost, STATGROUP_NTNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Duplicate Messages"), STAT_NTDuplicateMessages, STATGROUP_NTNet);
+
+void FNTAckHeader::Serialize(FArchive& Ar)
+{
+	uint8 bHasSequence = (Ar.IsSaving() && bValid) ? 1 : 0;
+	Ar.SerializeBits(&bHasSequence, 1);
+	bValid = bHasSequence != 0;
+
+	if (bValid)
+	{
+		Ar << Sequence;
+	}
+
+	uint8 bHasAckBit = (Ar.IsSaving() && bHasAck) ? 1 : 0;
+	Ar.SerializeBits(&bHasAckBit, 1);
+	bHasAck = bHasAckBit != 0;
+
+	if (bHasAck)
+	{
+		Ar << Ack;
+		Ar << AckBits;
+	}
+}
+
+FNTAckSystem::FNTAckSystem()
+{
+	Reset();
+}
+
+void FNTAckSystem::Reset()
+{
+	for (int32 i = 0; i < BufferSize; i++)
+	{
+		Sent[i].Sequence = INDEX_NONE;
+		Received[i] = INDEX_NONE;
+	}
+
+	Pending.Reset();
+	LocalSequence = 0;
+	RemoteSequence = 0;
+	bReceivedAny = false;
+	LastReceiveTime = 0.0;
+
+	NumSent = 0;
+	NumAcked = 0;
+	NumLost = 0;
+
+	SmoothedRTT = 0.f;
+	RTTVariance = 0.f;
+	Loss = 0.f;
+	bHasRTTSample = false;
+}
+
+FNTAckHeader FNTAckSystem::WriteHeader(double SendTime)
+{
+	FNTAckHeader Header = WriteAcks();
+	Header.bValid = true;
+	Header.Sequence = LocalSequence;
+
+	// Whatever was in this slot is a full buffer old - If it never got resolved, it isn't going to be
+	FSentMessage& Message = Sent[LocalSequence % BufferSize];
+	if (Message.Sequence != INDEX_NONE && !Message.bResolved)
+	{
+		Pending.RemoveSingle((uint16)Message.Sequence);
+		AddLossSample(true);
+	}
+
+	Message.Sequence = LocalSequence;
+	Message.SendTime = SendTime;
+	Message.bResolved = false;
+	Pending.Add(LocalSequence);
+
+	LocalSequence++;
+	NumSent++;
+
+	return Header;
+}
+
+FNTAckHeader FNTAckSystem::WriteAcks() const
+{
+	FNTAckHeader Header;
+
+	// Nothing to ack until we've heard from the other side
+	Header.bHasAck = bReceivedAny;
+	if (bReceivedAny)
+	{
+		Header.Ack = RemoteSequence;
+		for (int32 i = 0; i < 32; i++)
+		{
+			const uint16 Sequence = (uint16)(RemoteSequence - 1 - i);
+			if (Received[Sequence % BufferSize] == Sequence)
+			{
+				Header.AckBits |= 1u << i;
+			}
+		}
+	}
+
+	return Header;
+}
+
+bool FNTAckSystem::ReadHeader(const FNTAckHeader& Header, double ReceiveTime, TArray<uint16>& OutAcked)
+{
+	if (Header.bValid && !ReceiveSequence(Header.Sequence, ReceiveTime))
+	{
+		return false;
+	}
+
+	if (Header.bHasAck)
+	{
+		// Acks without a sequence still show the other side is talking
+		LastReceiveTime = ReceiveTime;
+
+		OnAcked(Header.Ack, ReceiveTime, OutAcked);
+		for (int32 i = 0; i < 32; i++)
+		{
+			if (Header.AckBits & (1u << i))
+			{
+				OnAcked((uint16)(Header.Ack - 1 - i), ReceiveTime, OutAcked);
+			}
+		}
+	}
+
+	return Header.bValid;
+}
+
+bool FNTAckSystem::ReceiveSequence(uint16 Sequence, double ReceiveTime)
+{
+	const int32 Slot = Sequence % BufferSize;
+	if (bReceivedAny)
+	{
+		if (Received[Slot] == Sequence)
+		{
+			INC_DWORD_STAT(STAT_NTDuplicateMessages);
+			return false;
+		}
+
+		if (IsNewer(RemoteSequence, Sequence) && (uint16)(RemoteSequence - Sequence) >= BufferSize)
+		{
+			return false;
+		}
+	}
+
+	LastReceiveTime = ReceiveTime;
+
+	// Slots hold the full sequence, so entries from a lap ago never pass for the ones we're acking
+	Received[Slot] = Sequence;
+	if (!bReceivedAny || IsNewer(Sequence, RemoteSequence))
+	{
+		RemoteSequence = Sequence;
+		bReceivedAny = true;
+	}
+
+	return true;
+}
+
+void FNTAckSystem::OnAcked(uint16 Sequence, double ReceiveTime, TArray<uint16>& OutAcked)
+{
+	FSentMessage& Message = Sent[Sequence % BufferSize];
+	if (Message.Sequence != Sequence || Message.bResolved)
+	{
+		return;
+	}
+
+	Message.bResolved = true;
+	Pending.RemoveSingle(Sequence);
+	OutAcked.Add(Sequence);
+	NumAcked++;
+	INC_DWORD_STAT(STAT_NTMessagesAcked);
+
+	// Includes however long the ack waited for a message to ride on, which is part of what a resend would cost too
+	const float Sample = (float)(ReceiveTime - Message.SendTime);
+	if (Sample >= 0.f)
+	{
+		if (!bHasRTTSample)
+		{
+			SmoothedRTT = Sample;
+			RTTVariance = Sample * 0.5f;
+			bHasRTTSample = true;
+		}
+		else
+		{
+			RTTVariance += (FMath::Abs(SmoothedRTT - Sample) - RTTVariance) * 0.25f;
+			SmoothedRTT += (Sample - SmoothedRTT) * 0.125f;
+		}
+	}
+
+	AddLossSample(false);
+}
+
+void FNTAckSystem::Update(double CurrentTime)
+{
+	const double Timeout = FMath::Max(1.0f, SmoothedRTT + RTTVariance * 4.0f);
+
+	// If the other side has gone quiet, nothing is carrying acks back. That's silence, not loss.
+	const bool bOtherSideQuiet = !bReceivedAny || CurrentTime - LastReceiveTime > Timeout;
+
+	// Pending is in send order, so everything past the first one still in time is too
+	int32 NumExpired = 0;
+	while (NumExpired < Pending.Num())
+	{
+		FSentMessage& Message = Sent[Pending[NumExpired] % BufferSize];
+		if (CurrentTime - Message.SendTime <= Timeout)
+		{
+			break;
+		}
+
+		Message.bResolved = true;
+		if (!bOtherSideQuiet)
+		{
+			AddLossSample(true);
+		}
+		NumExpired++;
+	}
+
+	if (NumExpired > 0)
+	{
+		Pending.RemoveAt(0, NumExpired, false);
+	}
+}
+
+void FNTAckSystem::AddLossSample(bool bLost)
+{
+	if (bLost)
+	{
+		NumLost++;
+		INC_DWORD_STAT(STAT_NTMessagesLost);
+	}
+
+	// Roughly the last twenty messages
+	Loss += ((bLost ? 1.f : 0.f) - Loss) * 0.05f;
+}
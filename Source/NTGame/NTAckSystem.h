@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/**
+ * Stamped on every unreliable message that takes part in acking - Input batches one way, snapshots and server moves the other.
+ * Each side acks the other's newest sequence, plus the 32 before it as a bitfield, so an ack survives as long as any
+ * one of the next few messages gets through.
+ */
+struct NTGAME_API FNTAckHeader
+{
+	/* False if the message has no sequence of its own - Nothing to ack back, but it can still carry acks. See WriteAcks. */
+	bool bValid;
+
+	uint16 Sequence;
+
+	/* False until the sender has received something to ack */
+	bool bHasAck;
+
+	/* Newest sequence received from the other side */
+	uint16 Ack;
+
+	/* Bit N set - Ack - 1 - N was received too */
+	uint32 AckBits;
+
+	FNTAckHeader()
+		: bValid(false)
+		, Sequence(0)
+		, bHasAck(false)
+		, Ack(0)
+		, AckBits(0)
+	{}
+
+	void Serialize(FArchive& Ar);
+};
+
+/**
+ * One end of a connection's ack layer. Hands out sequence numbers, remembers which of the other side's it has received
+ * to ack them back, and works out per-message RTT and loss from the acks it gets.
+ *
+ * There's no resending here - Callers keep track of what went out under each sequence, and decide what to resend when
+ * a sequence is acked or isn't.
+ */
+struct NTGAME_API FNTAckSystem
+{
+	/* Messages tracked in each direction. Anything older is forgotten. */
+	enum { BufferSize = 256 };
+
+	FNTAckSystem();
+	void Reset();
+
+	/* Stamps an outgoing message with the next sequence, and our acks for the other side */
+	FNTAckHeader WriteHeader(double SendTime);
+
+	/**
+	 * Just our acks for the other side, with no sequence. For messages that can be overwritten before they go out, like
+	 * replicated properties - A sequence that never left would be counted as lost.
+	 */
+	FNTAckHeader WriteAcks() const;
+
+	/**
+	 * Reads an incoming header - Records its sequence to ack back, and adds the sequences of ours it newly acks to OutAcked.
+	 * Returns false for a duplicate, a message too old to track, or a header with no sequence.
+	 */
+	bool ReadHeader(const FNTAckHeader& Header, double ReceiveTime, TArray<uint16>& OutAcked);
+
+	/* Counts messages that have gone unacked for too long as lost */
+	void Update(double CurrentTime);
+
+	/* Handles wrapping - 1 is newer than 65535 */
+	static bool IsNewer(uint16 A, uint16 B)
+	{
+		return (int16)(A - B) > 0;
+	}
+
+	bool HasRTTSample() const { return bHasRTTSample; }
+
+	/* Smoothed round trip time and its mean deviation, in seconds. Same smoothing as FNTConnectionQuality. */
+	float GetSmoothedRTT() const { return SmoothedRTT; }
+	float GetRTTVariance() const { return RTTVariance; }
+
+	/* Fraction of recent messages lost, 0 - 1 */
+	float GetLoss() const { return Loss; }
+
+	uint32 NumSent;
+	uint32 NumAcked;
+	uint32 NumLost;
+
+private:
+	struct FSentMessage
+	{
+		int32 Sequence;
+		double SendTime;
+		bool bResolved;
+	};
+
+	/* Records a sequence from the other side to ack back. False for a duplicate, or one too old to track. */
+	bool ReceiveSequence(uint16 Sequence, double ReceiveTime);
+
+	void OnAcked(uint16 Sequence, double ReceiveTime, TArray<uint16>& OutAcked);
+	void AddLossSample(bool bLost);
+
+	FSentMessage Sent[BufferSize];
+
+	/* Oldest first. Only ever a few round trips' worth. */
+	TArray<uint16> Pending;
+
+	/* Sequence received into each slot, or INDEX_NONE */
+	int32 Received[BufferSize];
+
+	uint16 LocalSequence;
+	uint16 RemoteSequence;
+	bool bReceivedAny;
+	double LastReceiveTime;
+
+	float SmoothedRTT;
+	float RTTVariance;
+	float Loss;
+	bool bHasRTTSample;
+};
@@ -0,0 +1,589 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NTGame.h"
+#include "NTPawn.h"
+#include "NTCubeIntegrator.h"
+#include "NTNetSettings.h"
+#include "NTSpatialGrid.h"
+#include "NTBenchmarkFixtures.h"
+#include "Json.h"
+#include "NTBenchmarkCommandlet.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogNTBenchmark, Log, All);
+
+namespace NTBenchmark
+{
+	/* The move buffer ANTPawn used before TNTRingBuffer, kept here as the baseline */
+	struct FLegacyMoveBuffer
+	{
+		uint32 Head;
+		uint32 Tail;
+
+		FLegacyMoveBuffer()
+			: Head(0)
+			, Tail(0)
+		{}
+
+		void Resize(uint32 NewSize)
+		{
+			Head = 0;
+			Tail = 0;
+			MoveArray.SetNumUninitialized(NewSize);
+		}
+
+		void Add(const FCubeMove& NewMove)
+		{
+			MoveArray[Head] = NewMove;
+			Next(Head);
+		}
+
+		void Remove()
+		{
+			ensure(!IsEmpty());
+			Next(Tail);
+		}
+
+		FCubeMove& Oldest()
+		{
+			return MoveArray[Tail];
+		}
+
+		bool IsEmpty() const
+		{
+			return Head == Tail;
+		}
+
+		void Next(uint32& Index)
+		{
+			Index++;
+			if (Index >= (uint32)MoveArray.Num())
+			{
+				Index -= MoveArray.Num();
+			}
+		}
+
+		FCubeMove& operator[](uint32 Index)
+		{
+			ensure(Index < (uint32)MoveArray.Num());
+			return MoveArray[Index];
+		}
+
+	private:
+		TArray<FCubeMove> MoveArray;
+	};
+
+	/* Roughly the same amount of work at every size, so small sizes aren't lost in timer noise */
+	int32 GetNumIterations(int32 NumEntries)
+	{
+		return FMath::Max(1000000 / NumEntries, 10);
+	}
+}
+
+UNTBenchmarkCommandlet::UNTBenchmarkCommandlet(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UNTBenchmarkCommandlet::Main(const FString& Params)
+{
+	Results.Reset();
+
+	const int32 Sizes[] = { 100, 1000, 10000 };
+	for (int32 NumEntries : Sizes)
+	{
+		RunMoveBufferBenchmarks(NumEntries);
+		RunHistoryCompareBenchmarks(NumEntries);
+	}
+
+	const int32 ReplayLengths[] = { 10, 100, 1000 };
+	for (int32 NumMoves : ReplayLengths)
+	{
+		RunReplayBenchmarks(NumMoves);
+	}
+
+	RunSerializationBenchmarks(1000);
+
+	const int32 CubeCounts[] = { 1000, 10000 };
+	for (int32 NumCubes : CubeCounts)
+	{
+		RunRelevancyBenchmarks(NumCubes);
+	}
+
+	WriteResults(Params);
+	return 0;
+}
+
+void UNTBenchmarkCommandlet::Report(const TCHAR* Name, int32 NumEntries, double Seconds, int32 NumOps)
+{
+	FBenchmarkResult Result;
+	Result.Name = Name;
+	Result.NumEntries = NumEntries;
+	Result.NanosecondsPerOp = (Seconds * 1.0e9) / FMath::Max(NumOps, 1);
+	Result.NumOps = NumOps;
+	Results.Add(Result);
+
+	UE_LOG(LogNTBenchmark, Display, TEXT("%-32s N=%-6i %10.2f ns/op"), Name, NumEntries, Result.NanosecondsPerOp);
+}
+
+void UNTBenchmarkCommandlet::WriteResults(const FString& Params) const
+{
+	const FString DefaultName = FPaths::GameSavedDir() / TEXT("Benchmarks") / FString::Printf(TEXT("NTBenchmark-%s"), *FDateTime::Now().ToString());
+
+	FString JsonPath = DefaultName + TEXT(".json");
+	FString CsvPath = DefaultName + TEXT(".csv");
+	FString Label;
+	FParse::Value(*Params, TEXT("Json="), JsonPath);
+	FParse::Value(*Params, TEXT("Csv="), CsvPath);
+	FParse::Value(*Params, TEXT("Label="), Label);
+
+	// --- JSON ---
+	FString JsonOutput;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&JsonOutput);
+
+	Writer->WriteObjectStart();
+	Writer->WriteValue(TEXT("label"), Label);
+	Writer->WriteValue(TEXT("engineVersion"), FEngineVersion::Current().ToString());
+	Writer->WriteValue(TEXT("timestamp"), FDateTime::UtcNow().ToIso8601());
+
+	Writer->WriteArrayStart(TEXT("results"));
+	for (const FBenchmarkResult& Result : Results)
+	{
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("name"), Result.Name);
+		Writer->WriteValue(TEXT("n"), Result.NumEntries);
+		Writer->WriteValue(TEXT("nsPerOp"), Result.NanosecondsPerOp);
+		Writer->WriteValue(TEXT("ops"), Result.NumOps);
+		Writer->WriteObjectEnd();
+	}
+	Writer->WriteArrayEnd();
+
+	Writer->WriteObjectEnd();
+	Writer->Close();
+
+	// --- CSV ---
+	FString CsvOutput = TEXT("label,name,n,ns_per_op,ops\n");
+	for (const FBenchmarkResult& Result : Results)
+	{
+		CsvOutput += FString::Printf(TEXT("\"%s\",\"%s\",%i,%.3f,%i\n"), *Label, *Result.Name, Result.NumEntries, Result.NanosecondsPerOp, Result.NumOps);
+	}
+
+	if (FFileHelper::SaveStringToFile(JsonOutput, *JsonPath) && FFileHelper::SaveStringToFile(CsvOutput, *CsvPath))
+	{
+		UE_LOG(LogNTBenchmark, Display, TEXT("Results written to %s and %s"), *JsonPath, *CsvPath);
+	}
+	else
+	{
+		UE_LOG(LogNTBenchmark, Error, TEXT("Couldn't write results to %s and %s"), *JsonPath, *CsvPath);
+	}
+}
+
+void UNTBenchmarkCommandlet::RunMoveBufferBenchmarks(int32 NumEntries)
+{
+	using namespace NTBenchmark;
+
+	const int32 NumIterations = GetNumIterations(NumEntries);
+	int64 Checksum = 0;
+
+	// The legacy buffer reads as empty when it wraps all the way round, so give it a spare slot
+	FLegacyMoveBuffer Legacy;
+	Legacy.Resize(NumEntries + 1);
+
+	TNTRingBuffer<FCubeMove> Ring;
+	Ring.Resize(NumEntries);
+
+	// --- ADD ---
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		Legacy.Head = Legacy.Tail = 0;
+		for (int32 i = 0; i < NumEntries; i++)
+		{
+			Legacy.Add(MakeMove(i));
+		}
+		Checksum += Legacy.Oldest().TickNumber;
+	}
+	Report(TEXT("Add (Legacy)"), NumEntries, FPlatformTime::Seconds() - StartTime, NumIterations * NumEntries);
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		Ring.Reset();
+		for (int32 i = 0; i < NumEntries; i++)
+		{
+			Ring.Add(MakeMove(i));
+		}
+		Checksum += Ring.Oldest().TickNumber;
+	}
+	Report(TEXT("Add (Ring)"), NumEntries, FPlatformTime::Seconds() - StartTime, NumIterations * NumEntries);
+
+	// --- LOOKUP ---
+	// Finding the move a correction refers to. The legacy buffer can only walk from the oldest move.
+	FRandomStream Random(NumEntries);
+	const int32 NumLookups = NumIterations * 16;
+	TArray<int32> Keys;
+	Keys.SetNumUninitialized(NumLookups);
+	for (int32& Key : Keys)
+	{
+		Key = Random.RandRange(0, NumEntries - 1);
+	}
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Key : Keys)
+	{
+		uint32 Index = Legacy.Tail;
+		while (Index != Legacy.Head && Legacy[Index].TickNumber < Key)
+		{
+			Legacy.Next(Index);
+		}
+		Checksum += Index;
+	}
+	Report(TEXT("Lookup (Legacy, Linear)"), NumEntries, FPlatformTime::Seconds() - StartTime, NumLookups);
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Key : Keys)
+	{
+		Checksum += Ring.LowerBound(Key, &GetTick);
+	}
+	Report(TEXT("Lookup (Ring, Binary Search)"), NumEntries, FPlatformTime::Seconds() - StartTime, NumLookups);
+
+	// --- DISCARD ---
+	// Refill, then throw away everything older than a correction halfway through the history
+	const int32 DiscardKey = NumEntries / 2;
+	const int32 NumDiscardIterations = FMath::Max(NumIterations / 4, 10);
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumDiscardIterations; Iteration++)
+	{
+		Legacy.Head = Legacy.Tail = 0;
+		for (int32 i = 0; i < NumEntries; i++)
+		{
+			Legacy.Add(MakeMove(i));
+		}
+		while (!Legacy.IsEmpty() && Legacy.Oldest().TickNumber < DiscardKey)
+		{
+			Legacy.Remove();
+		}
+		Checksum += Legacy.Tail;
+	}
+	Report(TEXT("Fill + Discard Half (Legacy)"), NumEntries, FPlatformTime::Seconds() - StartTime, NumDiscardIterations);
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumDiscardIterations; Iteration++)
+	{
+		Ring.Reset();
+		for (int32 i = 0; i < NumEntries; i++)
+		{
+			Ring.Add(MakeMove(i));
+		}
+		Ring.RemoveBefore(DiscardKey, &GetTick);
+		Checksum += Ring.Num();
+	}
+	Report(TEXT("Fill + Discard Half (Ring)"), NumEntries, FPlatformTime::Seconds() - StartTime, NumDiscardIterations);
+
+	// Printed so none of the above can be optimized away
+	UE_LOG(LogNTBenchmark, Verbose, TEXT("Checksum %lld"), Checksum);
+}
+
+void UNTBenchmarkCommandlet::RunHistoryCompareBenchmarks(int32 NumEntries)
+{
+	using namespace NTBenchmark;
+
+	const int32 NumIterations = GetNumIterations(NumEntries);
+	int64 Checksum = 0;
+
+	// Compare on its own, over pairs either side of its threshold in no particular order, so the branch can't be predicted
+	FRandomStream Random(NumEntries);
+	TArray<FCubeState> States;
+	TArray<FCubeState> Others;
+	for (int32 i = 0; i < NumEntries; i++)
+	{
+		const FCubeState State = MakeState(Random);
+		FCubeState Other = State;
+		Other.Position.X += Random.FRandRange(0.f, 0.02f);
+		States.Add(State);
+		Others.Add(Other);
+	}
+
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		for (int32 i = 0; i < NumEntries; i++)
+		{
+			Checksum += States[i].Compare(Others[i]) ? 1 : 0;
+		}
+	}
+	Report(TEXT("FCubeState Compare"), NumEntries, FPlatformTime::Seconds() - StartTime, NumIterations * NumEntries);
+
+	// Every move matches the correction, so both versions have to look at all of them
+	FCubeState Correction;
+	Correction.Position = FVector(100.f, 200.f, 300.f);
+	Correction.Rotation = FQuat::Identity;
+
+	TNTRingBuffer<FCubeMove> Moves;
+	Moves.Resize(NumEntries);
+
+	FNTMoveHistory History;
+	History.Resize(NumEntries);
+
+	for (int32 i = 0; i < NumEntries; i++)
+	{
+		FCubeMove Move = MakeMove(i);
+		Move.CubeState = Correction;
+		Moves.Add(Move);
+		History.Add(Move);
+	}
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		int32 Divergent = INDEX_NONE;
+		for (const FCubeMove& Move : Moves)
+		{
+			if (Correction.Compare(Move.CubeState))
+			{
+				Divergent = Move.TickNumber;
+				break;
+			}
+		}
+		Checksum += Divergent;
+	}
+	Report(TEXT("Compare Span (AoS, Scalar)"), NumEntries, FPlatformTime::Seconds() - StartTime, NumIterations * NumEntries);
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		Checksum += History.FindFirstDivergent(Correction, 0, History.Num());
+	}
+	Report(TEXT("Compare Span (SoA, Vector)"), NumEntries, FPlatformTime::Seconds() - StartTime, NumIterations * NumEntries);
+
+	UE_LOG(LogNTBenchmark, Verbose, TEXT("Checksum %lld"), Checksum);
+}
+
+void UNTBenchmarkCommandlet::RunReplayBenchmarks(int32 NumMoves)
+{
+	using namespace NTBenchmark;
+
+	const int32 NumIterations = GetNumIterations(NumMoves);
+	const float StepTime = 1.f / 60.0f;
+
+	FRandomStream Random(NumMoves);
+	const FCubeSimParams Params;
+	const FCubeState Correction = MakeState(Random);
+
+	FNTMoveHistory History = MakeHistory(NumMoves, Correction, StepTime);
+
+	// Putting a move back after each replay keeps the history the same length, without a copy in the timed loop
+	FCubeMove SpareMove = MakeMove(NumMoves + 1);
+	SpareMove.DeltaTime = StepTime;
+
+	double Checksum = 0.0;
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		const FCubeState Result = FCubeIntegrator::ReplayHistory(History, Correction, Params);
+		History.Add(SpareMove);
+		Checksum += Result.Position.X;
+	}
+	Report(TEXT("Replay History"), NumMoves, FPlatformTime::Seconds() - StartTime, NumIterations);
+
+	UE_LOG(LogNTBenchmark, Verbose, TEXT("Checksum %f"), Checksum);
+}
+
+void UNTBenchmarkCommandlet::RunSerializationBenchmarks(int32 NumStates)
+{
+	using namespace NTBenchmark;
+
+	const int32 NumIterations = GetNumIterations(NumStates);
+	int64 Checksum = 0;
+
+	// Pairs of states a tick apart, for the deltas
+	FRandomStream Random(NumStates);
+	TArray<FCubeState> States;
+	TArray<FCubeQuantizedState> Quantized;
+	TArray<FCubeQuantizedState> Baselines;
+	for (int32 i = 0; i < NumStates; i++)
+	{
+		const FCubeState State = MakeState(Random);
+		FCubeState Previous = State;
+		Previous.Position -= State.Velocity / 60.0f;
+
+		States.Add(State);
+		Quantized.AddDefaulted();
+		Quantized.Last().FromState(State);
+		Baselines.AddDefaulted();
+		Baselines.Last().FromState(Previous);
+	}
+
+	// --- QUANTIZE ---
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		for (const FCubeState& State : States)
+		{
+			FCubeQuantizedState Result;
+			Result.FromState(State);
+			Checksum += Result.Position[0];
+		}
+	}
+	Report(TEXT("Quantize State"), NumStates, FPlatformTime::Seconds() - StartTime, NumIterations * NumStates);
+
+	// --- WRITE FULL ---
+	int64 FullBits = 0;
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		FBitWriter Writer(0, true);
+		for (FCubeQuantizedState& State : Quantized)
+		{
+			State.Serialize(Writer);
+		}
+		FullBits = Writer.GetNumBits();
+	}
+	Report(TEXT("Write Full State"), NumStates, FPlatformTime::Seconds() - StartTime, NumIterations * NumStates);
+
+	// --- READ FULL ---
+	FBitWriter FullWriter(0, true);
+	for (FCubeQuantizedState& State : Quantized)
+	{
+		State.Serialize(FullWriter);
+	}
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		FBitReader Reader(FullWriter.GetData(), FullWriter.GetNumBits());
+		for (int32 i = 0; i < NumStates; i++)
+		{
+			FCubeQuantizedState Result;
+			Result.Serialize(Reader);
+			Checksum += Result.Position[0];
+		}
+	}
+	Report(TEXT("Read Full State"), NumStates, FPlatformTime::Seconds() - StartTime, NumIterations * NumStates);
+
+	// --- WRITE DELTA ---
+	int64 DeltaBits = 0;
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		FBitWriter Writer(0, true);
+		for (int32 i = 0; i < NumStates; i++)
+		{
+			FCubeQuantizedState Delta;
+			uint8 DeltaFlags = FCubeQuantizedState::MakeDelta(Quantized[i], Baselines[i], Delta);
+			FCubeQuantizedState::SerializeDelta(Writer, DeltaFlags, Delta);
+		}
+		DeltaBits = Writer.GetNumBits();
+	}
+	Report(TEXT("Write Delta State"), NumStates, FPlatformTime::Seconds() - StartTime, NumIterations * NumStates);
+
+	UE_LOG(LogNTBenchmark, Display, TEXT("State size: Full %.1f bytes, Delta %.1f bytes"), FullBits / (8.0 * NumStates), DeltaBits / (8.0 * NumStates));
+	UE_LOG(LogNTBenchmark, Verbose, TEXT("Checksum %lld"), Checksum);
+}
+
+void UNTBenchmarkCommandlet::RunRelevancyBenchmarks(int32 NumCubes)
+{
+	using namespace NTBenchmark;
+
+	const int32 NumIterations = GetNumIterations(NumCubes);
+	const int32 NumViewers = 16;
+	int64 Checksum = 0;
+
+	const UNTNetSettings* Settings = GetDefault<UNTNetSettings>();
+	const float Radius = Settings->RelevancyDistance;
+
+	// Same density at every size - A cube every 10m or so - so bigger maps mean more cubes out of range
+	const float HalfExtent = 500.0f * FMath::Sqrt((float)NumCubes);
+
+	FRandomStream Random(NumCubes);
+	TArray<FVector> Positions;
+	Positions.SetNumUninitialized(NumCubes);
+	for (FVector& Position : Positions)
+	{
+		Position = FVector(Random.FRandRange(-HalfExtent, HalfExtent), Random.FRandRange(-HalfExtent, HalfExtent), 0.f);
+	}
+
+	TArray<FVector> Viewers;
+	for (int32 i = 0; i < NumViewers; i++)
+	{
+		Viewers.Add(Positions[Random.RandHelper(NumCubes)]);
+	}
+
+	FNTSpatialGrid Grid;
+	Grid.Reset(Settings->RelevancyCellSize);
+	for (int32 i = 0; i < NumCubes; i++)
+	{
+		Grid.Add(i, Positions[i]);
+	}
+
+	// --- DISTANCE CHECKS ---
+	// What the engine does by default, one distance check per actor per connection
+	const float RadiusSquared = FMath::Square(Radius);
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		for (const FVector& Viewer : Viewers)
+		{
+			for (const FVector& Position : Positions)
+			{
+				Checksum += FVector::DistSquared(Position, Viewer) < RadiusSquared ? 1 : 0;
+			}
+		}
+	}
+	Report(TEXT("Relevancy (Distance Checks)"), NumCubes, FPlatformTime::Seconds() - StartTime, NumIterations * NumViewers);
+
+	// --- GRID QUERY ---
+	// Refreshing one viewer's cache
+	FNTRelevancyCache Cache;
+	Cache.Radius = Radius;
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		for (const FVector& Viewer : Viewers)
+		{
+			Cache.Invalidate();
+			Cache.Update(0.f, Grid, Viewer);
+			Checksum += Cache.GetRelevant().Num();
+		}
+	}
+	Report(TEXT("Relevancy (Grid Query)"), NumCubes, FPlatformTime::Seconds() - StartTime, NumIterations * NumViewers);
+
+	// --- GRID QUERY + LOOKUPS ---
+	// Refreshing the cache, then asking it about every cube, as IsNetRelevantFor does
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		for (const FVector& Viewer : Viewers)
+		{
+			Cache.Invalidate();
+			Cache.Update(0.f, Grid, Viewer);
+			for (int32 i = 0; i < NumCubes; i++)
+			{
+				Checksum += Cache.IsRelevant(i) ? 1 : 0;
+			}
+		}
+	}
+	Report(TEXT("Relevancy (Grid Query + Lookups)"), NumCubes, FPlatformTime::Seconds() - StartTime, NumIterations * NumViewers);
+
+	// --- GRID MOVE ---
+	// Keeping the grid up to date, a step's worth of movement for every cube
+	const int32 NumMoveIterations = FMath::Max(NumIterations / 4, 10);
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumMoveIterations; Iteration++)
+	{
+		const FVector Step = FVector((Iteration & 1) ? 10.0f : -10.0f, 5.0f, 0.f);
+		for (int32 i = 0; i < NumCubes; i++)
+		{
+			Positions[i] += Step;
+			Grid.Move(i, Positions[i]);
+		}
+	}
+	Report(TEXT("Relevancy Grid Move"), NumCubes, FPlatformTime::Seconds() - StartTime, NumMoveIterations * NumCubes);
+
+	UE_LOG(LogNTBenchmark, Display, TEXT("Relevancy: %i cubes, %i cells, %i relevant to the last viewer"), NumCubes, Grid.NumCells(), Cache.GetRelevant().Num());
+	UE_LOG(LogNTBenchmark, Verbose, TEXT("Checksum %lld"), Checksum);
+}
@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "NTBenchmarkCommandlet.generated.h"
+
+/**
+ * Microbenchmarks for the prediction code. Runs headless, results go to the log and to JSON and CSV files.
+ * Usage: UE4Editor-Cmd.exe NTGame.uproject -run=NTBenchmark [-Json=<path>] [-Csv=<path>] [-Label=<build name>]
+ * Output defaults to Saved/Benchmarks/, one file per run.
+ */
+UCLASS()
+class UNTBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UNTBenchmarkCommandlet(const FObjectInitializer& ObjectInitializer);
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	struct FBenchmarkResult
+	{
+		FString Name;
+		int32 NumEntries;
+		double NanosecondsPerOp;
+		int32 NumOps;
+	};
+
+	TArray<FBenchmarkResult> Results;
+
+	/* Logs a result and keeps it for the output files */
+	void Report(const TCHAR* Name, int32 NumEntries, double Seconds, int32 NumOps);
+
+	void WriteResults(const FString& Params) const;
+
+	/* Move history add / discard / lookup, TNTRingBuffer against the old wrap-around buffer */
+	void RunMoveBufferBenchmarks(int32 NumEntries);
+
+	/* FCubeState::Compare alone, then checking a correction against a run of history, Compare per move against FNTMoveHistory::FindFirstDivergent */
+	void RunHistoryCompareBenchmarks(int32 NumEntries);
+
+	/* Replaying a correction through NumMoves of history, as HistoryCorrection does */
+	void RunReplayBenchmarks(int32 NumMoves);
+
+	/* Quantizing and writing / reading states, full and delta, as ServerMoveData and snapshots do */
+	void RunSerializationBenchmarks(int32 NumStates);
+
+	/* Deciding which of NumCubes are relevant to each viewer, per-actor distance checks against FNTSpatialGrid */
+	void RunRelevancyBenchmarks(int32 NumCubes);
+};
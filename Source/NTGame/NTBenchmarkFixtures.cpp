@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NTGame.h"
+#include "NTBenchmarkFixtures.h"
+
+namespace NTBenchmark
+{
+	FCubeMove MakeMove(int32 Tick)
+	{
+		FCubeMove Move;
+		Move.TickNumber = Tick;
+		Move.TimeStamp = Tick * 16;
+		Move.CubeInput.FromBits(Tick & 15);
+		return Move;
+	}
+
+	int32 GetTick(const FCubeMove& Move)
+	{
+		return Move.TickNumber;
+	}
+
+	FCubeState MakeState(FRandomStream& Random)
+	{
+		FCubeState State;
+		State.Position = Random.VRand() * Random.FRandRange(0.f, 5000.0f);
+		State.Velocity = Random.VRand() * Random.FRandRange(0.f, 1000.0f);
+		State.AngularVelocity = Random.VRand() * Random.FRandRange(0.f, 360.0f);
+		State.Rotation = FQuat(Random.VRand(), Random.FRandRange(-PI, PI));
+		return State;
+	}
+
+	FNTMoveHistory MakeHistory(int32 NumMoves, const FCubeState& State, float StepTime)
+	{
+		FNTMoveHistory History;
+		History.Resize(NumMoves + 1);
+
+		for (int32 i = 0; i <= NumMoves; i++)
+		{
+			FCubeMove Move = MakeMove(i);
+			Move.DeltaTime = StepTime;
+			Move.CubeState = State;
+			History.Add(Move);
+		}
+
+		return History;
+	}
+}
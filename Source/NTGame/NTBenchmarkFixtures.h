@@ -0,0 +1,22 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "NTPawn.h"
+
+/**
+ * Data the benchmarks and their automation tests build their runs from, so the tests check what NTBenchmarkCommandlet times.
+ */
+namespace NTBenchmark
+{
+	/* A move with its tick, a time stamp to match, and input that changes every tick */
+	NTGAME_API FCubeMove MakeMove(int32 Tick);
+
+	NTGAME_API int32 GetTick(const FCubeMove& Move);
+
+	/* A state that's moving and spinning, inside the quantization bounds, so nothing quantizes away to zero */
+	NTGAME_API FCubeState MakeState(FRandomStream& Random);
+
+	/* A corrected move followed by NumMoves more, all at State, as a replay finds the history */
+	NTGAME_API FNTMoveHistory MakeHistory(int32 NumMoves, const FCubeState& State, float StepTime);
+}
@@ -0,0 +1,689 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NTGame.h"
+#include "NTPawn.h"
+#include "NTCubeIntegrator.h"
+#include "NTNetSettings.h"
+#include "NTSnapshot.h"
+#include "NTBenchmarkFixtures.h"
+#include "AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Pass / fail checks on the paths NTBenchmarkCommandlet times. The commandlet says how fast, these say it's still right -
+ * Serialization round trips, replay consistency, and under PerfFilter, timings against a baseline measured in the same run.
+ */
+namespace NTBenchmarkTests
+{
+	const int32 NumStates = 1000;
+	const float StepTime = 1.f / 60.0f;
+
+	/* MakeState, MakeHistory and the rest, shared with the commandlet */
+	using namespace NTBenchmark;
+}
+
+//////// SERIALIZATION ////
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNTQuantizedStateRoundTripTest, "NTGame.Serialization.QuantizedStateRoundTrip", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FNTQuantizedStateRoundTripTest::RunTest(const FString& Parameters)
+{
+	using namespace NTBenchmarkTests;
+
+	const UNTNetSettings* Settings = GetDefault<UNTNetSettings>();
+
+	// Rounding to the nearest step is off by half a step at most. Rotation loses up to half a step on three components.
+	const float PositionTolerance = Settings->PositionPrecision * 0.51f;
+	const float VelocityTolerance = Settings->LinearVelocityPrecision * 0.51f;
+	const float AngularVelocityTolerance = Settings->AngularVelocityPrecision * 0.51f;
+	const float RotationStep = FMath::Sqrt(2.f) / (float)((1 << Settings->RotationComponentBits) - 1);
+	const float RotationTolerance = 2.f * FMath::Sqrt(3.f) * RotationStep;
+
+	FRandomStream Random(NumStates);
+	TArray<FCubeQuantizedState> Written;
+
+	FBitWriter Writer(0, true);
+	TArray<FCubeState> States;
+	for (int32 i = 0; i < NumStates; i++)
+	{
+		States.Add(MakeState(Random));
+		Written.AddDefaulted();
+		Written.Last().FromState(States.Last());
+		Written.Last().Serialize(Writer);
+	}
+
+	FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+
+	int32 NumMismatched = 0;
+	float MaxPositionError = 0.f;
+	float MaxVelocityError = 0.f;
+	float MaxAngularVelocityError = 0.f;
+	float MaxRotationError = 0.f;
+
+	for (int32 i = 0; i < NumStates; i++)
+	{
+		FCubeQuantizedState Read;
+		Read.Serialize(Reader);
+		NumMismatched += (Read == Written[i]) ? 0 : 1;
+
+		const FCubeState Result = Read.ToState();
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			MaxPositionError = FMath::Max(MaxPositionError, FMath::Abs(Result.Position[Axis] - States[i].Position[Axis]));
+			MaxVelocityError = FMath::Max(MaxVelocityError, FMath::Abs(Result.Velocity[Axis] - States[i].Velocity[Axis]));
+			MaxAngularVelocityError = FMath::Max(MaxAngularVelocityError, FMath::Abs(Result.AngularVelocity[Axis] - States[i].AngularVelocity[Axis]));
+		}
+		MaxRotationError = FMath::Max(MaxRotationError, Result.Rotation.AngularDistance(States[i].Rotation));
+	}
+
+	TestFalse(TEXT("Reader ran out of bits"), Reader.IsError());
+	TestEqual(TEXT("Quantized states read back exactly as written"), NumMismatched, 0);
+	TestTrue(FString::Printf(TEXT("Position error %.4f within %.4f"), MaxPositionError, PositionTolerance), MaxPositionError <= PositionTolerance);
+	TestTrue(FString::Printf(TEXT("Velocity error %.4f within %.4f"), MaxVelocityError, VelocityTolerance), MaxVelocityError <= VelocityTolerance);
+	TestTrue(FString::Printf(TEXT("Angular velocity error %.4f within %.4f"), MaxAngularVelocityError, AngularVelocityTolerance), MaxAngularVelocityError <= AngularVelocityTolerance);
+	TestTrue(FString::Printf(TEXT("Rotation error %.5f rad within %.5f"), MaxRotationError, RotationTolerance), MaxRotationError <= RotationTolerance);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNTServerMoveRoundTripTest, "NTGame.Serialization.ServerMoveRoundTrip", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FNTServerMoveRoundTripTest::RunTest(const FString& Parameters)
+{
+	using namespace NTBenchmarkTests;
+
+	FRandomStream Random(NumStates);
+	FCubeBaselineBuffer SentBaselines;
+	FCubeBaselineBuffer ReceivedBaselines;
+
+	int32 NumMismatched = 0;
+	int32 NumUnresolved = 0;
+	int64 DeltaBits = 0;
+	int64 FullBits = 0;
+
+	// A cube moving a tick at a time, with the Client acking every state it gets, so all but the first are deltas
+	FCubeState State = MakeState(Random);
+	for (int32 Tick = 1; Tick <= NumStates; Tick++)
+	{
+		State.Position += State.Velocity * StepTime;
+
+		FCubeMove Move;
+		Move.TickNumber = Tick;
+		Move.CubeState = State;
+
+		FCubeServerMove Sent;
+		Sent.SetState(Move, Tick, SentBaselines, Tick - 1);
+		SentBaselines.Add(Tick, Sent.Quantized);
+
+		FBitWriter Writer(0, true);
+		bool bSuccess = false;
+		Sent.NetSerialize(Writer, nullptr, bSuccess);
+		(Sent.BaselineTick != INDEX_NONE ? DeltaBits : FullBits) += Writer.GetNumBits();
+
+		FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+		FCubeServerMove Received;
+		Received.NetSerialize(Reader, nullptr, bSuccess);
+
+		if (!bSuccess || !Received.ResolveBaseline(ReceivedBaselines))
+		{
+			NumUnresolved++;
+			continue;
+		}
+
+		ReceivedBaselines.Add(Received.ServerTick, Received.Quantized);
+		NumMismatched += (Received.Quantized == Sent.Quantized && Received.Move.TickNumber == Tick) ? 0 : 1;
+	}
+
+	TestEqual(TEXT("Every move resolved its baseline"), NumUnresolved, 0);
+	TestEqual(TEXT("Every move arrived as sent"), NumMismatched, 0);
+
+	// One full state to start, then deltas that have to be worth it. Only position changes here, so they should be well under.
+	const float FullBytes = FullBits / 8.0f;
+	const float MeanDeltaBytes = DeltaBits / (8.0f * (NumStates - 1));
+	TestTrue(FString::Printf(TEXT("Deltas (%.1f bytes) under 3/4 of a full state (%.1f bytes)"), MeanDeltaBytes, FullBytes), MeanDeltaBytes < FullBytes * 0.75f);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNTInputBatchRoundTripTest, "NTGame.Serialization.InputBatchRoundTrip", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FNTInputBatchRoundTripTest::RunTest(const FString& Parameters)
+{
+	FNTAckSystem AckSystem;
+
+	FCubeInputBatch Sent;
+	Sent.BaseTick = 12345;
+	Sent.AckedServerTick = 6789;
+	Sent.AckHeader = AckSystem.WriteHeader(0.0);
+
+	// Every input value in short runs, then keys held for a while, which is how players actually play
+	for (int32 i = 0; i < FCubeInputBatch::MaxInputs; i++)
+	{
+		Sent.Inputs.Add((uint8)((i < 32 ? i / 2 : i / 16) & 15));
+	}
+	for (int32 i = 0; i < FCubeInputBatch::MaxStateHashes; i++)
+	{
+		Sent.StateHashes.Add(FCrc::MemCrc32(&i, sizeof(i)));
+	}
+
+	FBitWriter Writer(0, true);
+	bool bSuccess = false;
+	Sent.NetSerialize(Writer, nullptr, bSuccess);
+
+	FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+	FCubeInputBatch Received;
+	Received.NetSerialize(Reader, nullptr, bSuccess);
+
+	TestTrue(TEXT("Batch read back"), bSuccess);
+	TestEqual(TEXT("BaseTick"), Received.BaseTick, Sent.BaseTick);
+	TestEqual(TEXT("AckedServerTick"), Received.AckedServerTick, Sent.AckedServerTick);
+	TestTrue(TEXT("Inputs"), Received.Inputs == Sent.Inputs);
+	TestTrue(TEXT("State hashes"), Received.StateHashes == Sent.StateHashes);
+	TestTrue(TEXT("Ack header"), Received.AckHeader.bValid && Received.AckHeader.Sequence == Sent.AckHeader.Sequence);
+
+	// Run-length encoding has to beat a flat 4 bits per input by a good margin, even paying for the rest of the batch
+	const int32 FlatBits = FCubeInputBatch::MaxInputs * 4;
+	const int32 InputBits = (int32)Writer.GetNumBits() - FCubeInputBatch::MaxStateHashes * 32;
+	TestTrue(FString::Printf(TEXT("Batch without hashes (%i bits) under 3/4 of flat input (%i bits)"), InputBits, FlatBits), InputBits < FlatBits * 3 / 4);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNTSnapshotBudgetTest, "NTGame.Serialization.SnapshotBudget", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FNTSnapshotBudgetTest::RunTest(const FString& Parameters)
+{
+	using namespace NTBenchmarkTests;
+
+	// Worst case header, which is what FNTSnapshotSender charges
+	FNTAckSystem AckSystem;
+	FNTAckHeader ReceivedHeader;
+	ReceivedHeader.bValid = true;
+	TArray<uint16> Acked;
+	AckSystem.ReadHeader(ReceivedHeader, 0.0, Acked);
+
+	FCubeSnapshot Sent;
+	Sent.ServerTick = 1000000;
+	Sent.AckHeader = AckSystem.WriteHeader(0.0);
+	TestTrue(TEXT("Header carries acks"), Sent.AckHeader.bHasAck);
+
+	// Fill to the default budget the same way the sender does
+	const int32 BudgetBits = GetDefault<UNTNetSettings>()->SnapshotByteBudget * 8;
+	int32 UsedBits = FCubeSnapshot::GetMaxHeaderBits();
+
+	FRandomStream Random(NumStates);
+	for (int32 i = 0; i < FCubeSnapshot::MaxEntries; i++)
+	{
+		FCubeSnapshotEntry Entry;
+		Entry.CubeId = i * 7;
+		Entry.State.FromState(MakeState(Random));
+
+		FBitWriter EntryWriter(0, true);
+		Entry.Serialize(EntryWriter);
+		if (UsedBits + (int32)EntryWriter.GetNumBits() > BudgetBits)
+		{
+			break;
+		}
+
+		UsedBits += (int32)EntryWriter.GetNumBits();
+		Sent.Entries.Add(Entry);
+	}
+
+	FBitWriter Writer(0, true);
+	bool bSuccess = false;
+	Sent.NetSerialize(Writer, nullptr, bSuccess);
+
+	TestTrue(TEXT("Snapshot has entries"), Sent.Entries.Num() > 0);
+	TestTrue(FString::Printf(TEXT("Snapshot (%i bits) within budget (%i bits)"), (int32)Writer.GetNumBits(), BudgetBits), (int32)Writer.GetNumBits() <= BudgetBits);
+
+	FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+	FCubeSnapshot Received;
+	Received.NetSerialize(Reader, nullptr, bSuccess);
+
+	int32 NumMismatched = 0;
+	for (int32 i = 0; i < FMath::Min(Sent.Entries.Num(), Received.Entries.Num()); i++)
+	{
+		NumMismatched += (Received.Entries[i].CubeId == Sent.Entries[i].CubeId && Received.Entries[i].State == Sent.Entries[i].State) ? 0 : 1;
+	}
+
+	TestTrue(TEXT("Snapshot read back"), bSuccess);
+	TestEqual(TEXT("ServerTick"), Received.ServerTick, Sent.ServerTick);
+	TestEqual(TEXT("Entry count"), Received.Entries.Num(), Sent.Entries.Num());
+	TestEqual(TEXT("Entries arrived as sent"), NumMismatched, 0);
+	TestTrue(TEXT("Ack header"), Received.AckHeader.bHasAck && Received.AckHeader.Ack == Sent.AckHeader.Ack);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNTAckSystemTest, "NTGame.Serialization.AckSystem", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FNTAckSystemTest::RunTest(const FString& Parameters)
+{
+	FNTAckSystem Client;
+	FNTAckSystem Server;
+
+	// Forty messages one way, every fifth one lost, then a single reply through the archive
+	TArray<uint16> Acked;
+	for (int32 i = 0; i < 40; i++)
+	{
+		const FNTAckHeader Header = Client.WriteHeader(i * 0.01);
+		if (i % 5 != 4)
+		{
+			Server.ReadHeader(Header, i * 0.01 + 0.05, Acked);
+		}
+	}
+
+	FNTAckHeader Reply = Server.WriteHeader(0.5);
+	FBitWriter Writer(0, true);
+	Reply.Serialize(Writer);
+
+	FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+	FNTAckHeader ReadReply;
+	ReadReply.Serialize(Reader);
+
+	TestTrue(TEXT("Reply accepted"), Client.ReadHeader(ReadReply, 0.55, Acked));
+
+	// The reply acks the newest delivered sequence and the 32 before it - Everything delivered in that window is acked, nothing lost is
+	int32 NumWrong = 0;
+	for (int32 i = 40 - 33; i < 40; i++)
+	{
+		const bool bDelivered = i % 5 != 4;
+		NumWrong += (Acked.Contains((uint16)i) == bDelivered) ? 0 : 1;
+	}
+
+	TestEqual(TEXT("Acks match what was delivered"), NumWrong, 0);
+	TestTrue(TEXT("RTT sampled"), Client.HasRTTSample());
+	TestFalse(TEXT("A duplicate reply is rejected"), Client.ReadHeader(ReadReply, 0.6, Acked));
+
+	// Server moves carry acks at the step rate, without sequences of their own that coalesced moves would lose
+	const FNTAckHeader NewHeader = Client.WriteHeader(0.6);
+	Server.ReadHeader(NewHeader, 0.65, Acked);
+
+	const uint32 ServerNumSent = Server.NumSent;
+	FCubeBaselineBuffer Baselines;
+	FCubeServerMove SentMove;
+	SentMove.SetState(FCubeMove(), 1, Baselines, INDEX_NONE);
+	SentMove.AckHeader = Server.WriteAcks();
+
+	FBitWriter MoveWriter(0, true);
+	bool bSuccess = false;
+	SentMove.NetSerialize(MoveWriter, nullptr, bSuccess);
+
+	FBitReader MoveReader(MoveWriter.GetData(), MoveWriter.GetNumBits());
+	FCubeServerMove ReceivedMove;
+	ReceivedMove.NetSerialize(MoveReader, nullptr, bSuccess);
+
+	Acked.Reset();
+	TestFalse(TEXT("A server move has no sequence to ack back"), Client.ReadHeader(ReceivedMove.AckHeader, 0.7, Acked));
+	TestTrue(TEXT("A server move acks the newest batch"), Acked.Num() == 1 && Acked[0] == NewHeader.Sequence);
+	TestEqual(TEXT("Acks alone use up no Server sequence"), Server.NumSent, ServerNumSent);
+
+	return true;
+}
+
+//////// HISTORY AND REPLAY ////
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNTMoveBufferTest, "NTGame.Replay.MoveBuffer", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FNTMoveBufferTest::RunTest(const FString& Parameters)
+{
+	using namespace NTBenchmarkTests;
+
+	FCubeMoveBuffer Moves;
+	Moves.Resize(64);
+
+	// Wrap round a few times, so the live moves straddle the end of the array
+	for (int32 Tick = 0; Tick < 200; Tick++)
+	{
+		FCubeMove Move;
+		Move.TickNumber = Tick;
+		Moves.Add(Move);
+	}
+
+	TestEqual(TEXT("Full buffer keeps its capacity"), (int32)Moves.Num(), 64);
+	TestEqual(TEXT("Oldest move"), Moves.Oldest().TickNumber, 200 - 64);
+	TestEqual(TEXT("Newest move"), Moves.Newest().TickNumber, 199);
+	TestEqual(TEXT("Lookup"), (int32)Moves.LowerBound(170, &GetTick), 170 - (200 - 64));
+	TestEqual(TEXT("Lookup past the newest"), (int32)Moves.LowerBound(500, &GetTick), 64);
+
+	Moves.RemoveBefore(190, &GetTick);
+	TestEqual(TEXT("Discard keeps the rest"), (int32)Moves.Num(), 10);
+	TestEqual(TEXT("Discard leaves the key move oldest"), Moves.Oldest().TickNumber, 190);
+
+	int32 NumOutOfOrder = 0;
+	int32 Expected = 190;
+	for (const FCubeMove& Move : Moves)
+	{
+		NumOutOfOrder += Move.TickNumber == Expected++ ? 0 : 1;
+	}
+	TestEqual(TEXT("Iterates oldest to newest"), NumOutOfOrder, 0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNTFindFirstDivergentTest, "NTGame.Replay.FindFirstDivergent", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FNTFindFirstDivergentTest::RunTest(const FString& Parameters)
+{
+	using namespace NTBenchmarkTests;
+
+	FRandomStream Random(NumStates);
+	const FCubeState State = MakeState(Random);
+
+	// Wrap the history round, so spans straddle the end of the arrays and have a scalar tail
+	FNTMoveHistory History = MakeHistory(15, State, StepTime);
+	for (int32 Tick = 16; Tick < 40; Tick++)
+	{
+		History.Remove();
+
+		FCubeMove Move;
+		Move.TickNumber = Tick;
+		Move.CubeState = State;
+		History.Add(Move);
+	}
+
+	TestEqual(TEXT("Matching history has nothing divergent"), History.FindFirstDivergent(State, 0, History.Num()), (int32)INDEX_NONE);
+
+	FCubeState Moved = State;
+	Moved.Position.X += 1.f;
+	History.SetState(11, Moved);
+
+	TestEqual(TEXT("Finds the divergent move"), History.FindFirstDivergent(State, 0, History.Num()), 11);
+	TestEqual(TEXT("Finds it from part way in"), History.FindFirstDivergent(State, 9, History.Num()), 11);
+	TestEqual(TEXT("Spans that stop short of it find nothing"), History.FindFirstDivergent(State, 0, 11), (int32)INDEX_NONE);
+	TestEqual(TEXT("Spans that start after it find nothing"), History.FindFirstDivergent(State, 12, History.Num()), (int32)INDEX_NONE);
+
+	// Agrees with FCubeState::Compare, move for move, either side of its 0.01cm threshold
+	int32 NumDisagreements = 0;
+	for (uint32 i = 0; i < History.Num(); i++)
+	{
+		FCubeState Other = State;
+		Other.Position.X += Random.FRandRange(0.f, 0.02f);
+		History.SetState(i, Other);
+
+		const bool bDivergent = History.FindFirstDivergent(State, i, 1) == (int32)i;
+		NumDisagreements += bDivergent == State.Compare(Other) ? 0 : 1;
+
+		History.SetState(i, State);
+	}
+	TestEqual(TEXT("Agrees with FCubeState::Compare"), NumDisagreements, 0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNTReplayResumesFromStoredStateTest, "NTGame.Replay.ResumesFromStoredState", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FNTReplayResumesFromStoredStateTest::RunTest(const FString& Parameters)
+{
+	using namespace NTBenchmarkTests;
+
+	const FCubeSimParams Params;
+	FRandomStream Random(NumStates);
+	const FCubeState Corrected = MakeState(Random);
+
+	// A correction that agrees with a state the history stored has to change nothing after it. That only holds if each
+	// stored state and hash is exactly the state the replay carried on from - Which is what the Server's hash acks rely on.
+	const int32 ReplayLengths[] = { 10, 100, 1000 };
+	for (int32 NumMoves : ReplayLengths)
+	{
+		FNTMoveHistory Full = MakeHistory(NumMoves, Corrected, StepTime);
+		const FCubeState FullResult = FCubeIntegrator::ReplayHistory(Full, Corrected, Params);
+
+		// Correct again from half way, with the state the first replay stored there
+		const int32 Midpoint = NumMoves / 2;
+		FNTMoveHistory Resumed = Full;
+		Resumed.RemoveOldest(Midpoint);
+		const FCubeState ResumedResult = FCubeIntegrator::ReplayHistory(Resumed, Full.GetState(Midpoint), Params);
+
+		int32 NumStateMismatches = 0;
+		int32 NumHashMismatches = 0;
+		for (uint32 i = 0; i < Resumed.Num(); i++)
+		{
+			const uint32 FullIndex = Midpoint + 1 + i;
+			NumStateMismatches += Resumed.GetState(i) == Full.GetState(FullIndex) ? 0 : 1;
+			NumHashMismatches += Resumed.GetStateHash(i) == Full.GetStateHash(FullIndex) ? 0 : 1;
+		}
+
+		TestEqual(FString::Printf(TEXT("%i moves - Resuming keeps the rest of the moves"), NumMoves), (int32)Resumed.Num(), NumMoves - Midpoint - 1);
+		TestTrue(FString::Printf(TEXT("%i moves - Resumed replay ends where the full one did"), NumMoves), ResumedResult == FullResult);
+		TestEqual(FString::Printf(TEXT("%i moves - Resumed states match"), NumMoves), NumStateMismatches, 0);
+		TestEqual(FString::Printf(TEXT("%i moves - Resumed hashes match"), NumMoves), NumHashMismatches, 0);
+
+		// And the replay really did something, or all of the above would hold trivially
+		TestFalse(FString::Printf(TEXT("%i moves - Replay moved the cube"), NumMoves), FullResult.Position.Equals(Corrected.Position, 1.f));
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNTReplayHashesMatchAcrossCorrectionTest, "NTGame.Replay.HashesMatchAcrossCorrection", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FNTReplayHashesMatchAcrossCorrectionTest::RunTest(const FString& Parameters)
+{
+	using namespace NTBenchmarkTests;
+
+	const FCubeSimParams Params;
+	const int32 NumTicks = 120;
+	const int32 Latency = 6;
+
+	// The Server's cube gets knocked on this tick, which the Client can't predict
+	const int32 PushTick = 40;
+
+	FRandomStream Random(NumTicks);
+	FCubeState StartState = MakeState(Random);
+	StartState.Quantize();
+
+	// Both sides start together and step the same inputs, rounding each step as EndStep does
+	FCubeState ServerState = StartState;
+	FCubeState ClientState = StartState;
+
+	FNTMoveHistory ClientHistory;
+	ClientHistory.Resize(NumTicks + 1);
+
+	FCubeBaselineBuffer SentBaselines;
+	FCubeBaselineBuffer ReceivedBaselines;
+	TArray<FCubeServerMove> ServerMoves;
+
+	int32 NumMismatchesBeforePush = 0;
+	int32 NumMatchesAfterCorrection = 0;
+	int32 NumMismatchesAfterCorrection = 0;
+	int32 CorrectedTick = INDEX_NONE;
+
+	for (int32 Tick = 1; Tick <= NumTicks; Tick++)
+	{
+		FCubeInput Input;
+		Input.FromBits((Tick / 5) & 15);
+
+		// Client - Predict, and record the move as UpdateHistoryBuffer does
+		FCubeIntegrator::Step(ClientState, Input, StepTime, Params);
+		ClientState.Quantize();
+
+		FCubeQuantizedState ClientQuantized;
+		ClientQuantized.FromState(ClientState);
+
+		FCubeMove ClientMove;
+		ClientMove.TickNumber = Tick;
+		ClientMove.CubeInput = Input;
+		ClientMove.DeltaTime = StepTime;
+		ClientMove.CubeState = ClientQuantized.ToState();
+		ClientMove.RandHash = (int32)ClientQuantized.GetHash();
+		ClientHistory.Add(ClientMove);
+
+		// Server - The same input, then send the result the way SendServerMove does
+		if (Tick == PushTick)
+		{
+			ServerState.Velocity += FVector(300.0f, 0.f, 0.f);
+		}
+		FCubeIntegrator::Step(ServerState, Input, StepTime, Params);
+		ServerState.Quantize();
+
+		FCubeMove ServerMove;
+		ServerMove.TickNumber = Tick;
+		ServerMove.CubeState = ServerState;
+
+		// The Client's ack takes a round trip to come back, so deltas are against a state that old
+		const int32 AckedServerTick = Tick > 2 * Latency ? Tick - 2 * Latency : INDEX_NONE;
+
+		FCubeServerMove Sent;
+		Sent.SetState(ServerMove, Tick, SentBaselines, AckedServerTick);
+		SentBaselines.Add(Tick, Sent.Quantized);
+
+		FBitWriter Writer(0, true);
+		bool bSuccess = false;
+		Sent.NetSerialize(Writer, nullptr, bSuccess);
+
+		FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+		FCubeServerMove& Received = ServerMoves[ServerMoves.AddDefaulted()];
+		Received.NetSerialize(Reader, nullptr, bSuccess);
+		if (!TestTrue(TEXT("Server move resolved its baseline"), bSuccess && Received.ResolveBaseline(ReceivedBaselines)))
+		{
+			return false;
+		}
+		ReceivedBaselines.Add(Received.ServerTick, Received.Quantized);
+
+		// Client - The move the Server sent Latency ticks ago arrives. Line the history up with it, as PrepareCorrection does.
+		const int32 ArrivedTick = Tick - Latency;
+		if (ArrivedTick < 1)
+		{
+			continue;
+		}
+
+		const FCubeServerMove& Arrived = ServerMoves[ArrivedTick - 1];
+		ClientHistory.RemoveOldest(ClientHistory.LowerBoundTick(ArrivedTick));
+		if (!TestEqual(TEXT("History still has the move the Server sent"), ClientHistory.GetTick(0), ArrivedTick))
+		{
+			return false;
+		}
+
+		const bool bMatched = (uint32)ClientHistory.GetStateHash(0) == Arrived.Quantized.GetHash();
+		if (CorrectedTick != INDEX_NONE)
+		{
+			(bMatched ? NumMatchesAfterCorrection : NumMismatchesAfterCorrection)++;
+		}
+		else if (!bMatched && ArrivedTick < PushTick)
+		{
+			NumMismatchesBeforePush++;
+		}
+		else if (!bMatched)
+		{
+			// The first miss is the push - Replay from the Server's state, as the Client does
+			ClientState = FCubeIntegrator::ReplayHistory(ClientHistory, Arrived.Move.CubeState, Params);
+			CorrectedTick = ArrivedTick;
+		}
+	}
+
+	TestEqual(TEXT("Hashes match until the push"), NumMismatchesBeforePush, 0);
+	TestEqual(TEXT("The push is corrected on the tick it happened"), CorrectedTick, PushTick);
+	TestTrue(TEXT("Moves arrived after the correction"), NumMatchesAfterCorrection > 0);
+	TestEqual(TEXT("After the correction, every hash matches - replayed moves and new ones alike"), NumMismatchesAfterCorrection, 0);
+	TestTrue(TEXT("Client ends where the Server is"), ClientState == ServerState);
+
+	return true;
+}
+
+//////// PERFORMANCE ////
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNTReplayPerfTest, "NTGame.Perf.Replay", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FNTReplayPerfTest::RunTest(const FString& Parameters)
+{
+	using namespace NTBenchmarkTests;
+
+	// Reported rather than gated - Wall-clock limits depend on the machine. The baseline is the same steps without the
+	// history, timed in the same run, so the ratio is what to watch across builds.
+	const int32 NumMoves = 1000;
+	const int32 NumIterations = 100;
+
+	const FCubeSimParams Params;
+	FRandomStream Random(NumMoves);
+	const FCubeState Corrected = MakeState(Random);
+	FNTMoveHistory History = MakeHistory(NumMoves, Corrected, StepTime);
+
+	FCubeMove SpareMove = MakeMove(NumMoves + 1);
+	SpareMove.DeltaTime = StepTime;
+
+	double Checksum = 0.0;
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		FCubeState State = Corrected;
+		for (uint32 i = 1; i < History.Num(); i++)
+		{
+			FCubeIntegrator::Step(State, History.GetInput(i), StepTime, Params);
+		}
+		Checksum += State.Position.X;
+	}
+	const double StepMilliseconds = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumIterations;
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		Checksum += FCubeIntegrator::ReplayHistory(History, Corrected, Params).Position.X;
+		History.Add(SpareMove);
+	}
+	const double ReplayMilliseconds = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumIterations;
+
+	AddLogItem(FString::Printf(TEXT("Replay of %i moves: %.3f ms, %.2fx the %.3f ms for the bare steps (checksum %f)"),
+		NumMoves, ReplayMilliseconds, ReplayMilliseconds / FMath::Max(StepMilliseconds, 1.0e-6), StepMilliseconds, Checksum));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNTSerializationPerfTest, "NTGame.Perf.Serialization", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FNTSerializationPerfTest::RunTest(const FString& Parameters)
+{
+	using namespace NTBenchmarkTests;
+
+	// Reported against quantizing alone, timed in the same run, for the same reason as Perf.Replay
+	const int32 NumIterations = 100;
+
+	FRandomStream Random(NumStates);
+	TArray<FCubeState> States;
+	for (int32 i = 0; i < NumStates; i++)
+	{
+		States.Add(MakeState(Random));
+	}
+
+	int64 Checksum = 0;
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		for (const FCubeState& State : States)
+		{
+			FCubeQuantizedState Quantized;
+			Quantized.FromState(State);
+			Checksum += Quantized.Position[0];
+		}
+	}
+	const double QuantizeMilliseconds = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumIterations;
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		FBitWriter Writer(0, true);
+		for (const FCubeState& State : States)
+		{
+			FCubeQuantizedState Quantized;
+			Quantized.FromState(State);
+			Quantized.Serialize(Writer);
+		}
+
+		FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+		for (int32 i = 0; i < NumStates; i++)
+		{
+			FCubeQuantizedState Quantized;
+			Quantized.Serialize(Reader);
+			Checksum += Quantized.Position[0];
+		}
+	}
+	const double RoundTripMilliseconds = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumIterations;
+
+	AddLogItem(FString::Printf(TEXT("Quantize, write and read %i states: %.3f ms, %.2fx the %.3f ms to quantize alone (checksum %lld)"),
+		NumStates, RoundTripMilliseconds, RoundTripMilliseconds / FMath::Max(QuantizeMilliseconds, 1.0e-6), QuantizeMilliseconds, Checksum));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/**
+ * Binary search over anything indexable - Sorted arrays, ring buffers and the move history's key columns all share it.
+ */
+struct FNTBinarySearch
+{
+	/**
+	 * First index in [0, Num) for which IsBefore(Index) is false, or Num if there isn't one.
+	 * IsBefore must be true for some prefix of the range and false for the rest, as "Keys[Index] < Key" is over sorted keys.
+	 */
+	template<typename IndexType, typename PredicateType>
+	static IndexType LowerBound(IndexType Num, PredicateType IsBefore)
+	{
+		IndexType First = 0;
+		IndexType Count = Num;
+
+		while (Count > 0)
+		{
+			const IndexType Step = Count / 2;
+			const IndexType Middle = First + Step;
+
+			if (IsBefore(Middle))
+			{
+				First = Middle + 1;
+				Count -= Step + 1;
+			}
+			else
+			{
+				Count = Step;
+			}
+		}
+
+		return First;
+	}
+};
@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NTGame.h"
+#include "NTBotInput.h"
+
+namespace
+{
+	// Random mode holds each input for somewhere between these, in seconds
+	const float MinRandomHold = 0.1f;
+	const float MaxRandomHold = 1.5f;
+
+	// Four directions, see FCubeInput::ToBits()
+	const uint8 InputBitsMask = 0x0F;
+}
+
+FNTBotInput::FNTBotInput()
+	: RandomStream(0)
+	, ScriptIndex(INDEX_NONE)
+	, HoldTime(0.5f)
+	, InputBits(0)
+	, TimeLeft(0.f)
+{}
+
+bool FNTBotInput::IsEnabled()
+{
+	return FParse::Param(FCommandLine::Get(), TEXT("NTBot"));
+}
+
+void FNTBotInput::InitFromCommandLine(const TCHAR* CommandLine)
+{
+	int32 Seed = 0;
+	FParse::Value(CommandLine, TEXT("NTBotSeed="), Seed);
+	RandomStream.Initialize(Seed);
+
+	FParse::Value(CommandLine, TEXT("NTBotHold="), HoldTime);
+	HoldTime = FMath::Max(HoldTime, 0.01f);
+
+	Script.Reset();
+	FString ScriptString;
+	if (FParse::Value(CommandLine, TEXT("NTBotScript="), ScriptString, false))
+	{
+		TArray<FString> Entries;
+		ScriptString.ParseIntoArray(Entries, TEXT(","), true);
+		for (const FString& Entry : Entries)
+		{
+			Script.Add((uint8)(FCString::Atoi(*Entry) & InputBitsMask));
+		}
+	}
+
+	ScriptIndex = INDEX_NONE;
+	InputBits = 0;
+	TimeLeft = 0.f;
+}
+
+void FNTBotInput::Update(float DeltaSeconds)
+{
+	TimeLeft -= DeltaSeconds;
+	if (TimeLeft <= 0.f)
+	{
+		NextInput();
+	}
+}
+
+void FNTBotInput::NextInput()
+{
+	if (Script.Num() > 0)
+	{
+		ScriptIndex = (ScriptIndex + 1) % Script.Num();
+		InputBits = Script[ScriptIndex];
+		TimeLeft = HoldTime;
+	}
+	else
+	{
+		InputBits = (uint8)(RandomStream.RandHelper(InputBitsMask + 1));
+		TimeLeft = RandomStream.FRandRange(MinRandomHold, MaxRandomHold);
+	}
+}
@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/**
+ * Generates input for a bot-driven Client, for soak testing. Either plays a script of input bits on a loop, or holds
+ * random inputs for random lengths of time. Seeded, so a run can be repeated.
+ *
+ * Command line:
+ *   -NTBot                 Drive the local pawn with this generator
+ *   -NTBotSeed=<int>       Random seed
+ *   -NTBotScript=1,3,0,8   Input bits to cycle through, see FCubeInput::ToBits(). Random if not given.
+ *   -NTBotHold=<seconds>   How long each scripted input is held
+ */
+struct NTGAME_API FNTBotInput
+{
+	FNTBotInput();
+
+	/* True if -NTBot is on the command line */
+	static bool IsEnabled();
+
+	/* Reads the settings above from the command line */
+	void InitFromCommandLine(const TCHAR* CommandLine);
+
+	void Update(float DeltaSeconds);
+
+	uint8 GetInputBits() const { return InputBits; }
+
+private:
+	void NextInput();
+
+	FRandomStream RandomStream;
+	TArray<uint8> Script;
+	int32 ScriptIndex;
+	float HoldTime;
+
+	uint8 InputBits;
+	float TimeLeft;
+};
@@ -0,0 +1,135 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NTGame.h"
+#include "NTNetSettings.h"
+#include "NTClockSync.h"
+
+FNTClockSync::FNTClockSync()
+{
+	Reset();
+}
+
+void FNTClockSync::Reset()
+{
+	Samples.Resize(GetDefault<UNTNetSettings>()->ClockSyncWindow);
+
+	Offset = 0.0;
+	EstimatedOffset = 0.0;
+	EstimateTime = 0.0;
+	Drift = 0.0;
+	LastRequestTime = -BIG_NUMBER;
+	NumResponses = 0;
+	bSynchronized = false;
+}
+
+bool FNTClockSync::ShouldSendRequest(double LocalTime) const
+{
+	const UNTNetSettings* Settings = GetDefault<UNTNetSettings>();
+	const float Interval = NumResponses < Samples.Capacity() ? Settings->ClockSyncWarmupInterval : Settings->ClockSyncInterval;
+	return LocalTime - LastRequestTime >= Interval;
+}
+
+void FNTClockSync::OnRequestSent(double LocalTime)
+{
+	LastRequestTime = LocalTime;
+}
+
+void FNTClockSync::OnResponse(double ClientSendTime, double ServerTime, double LocalTime)
+{
+	const double RTT = LocalTime - ClientSendTime;
+	if (RTT < 0.0)
+	{
+		return;
+	}
+
+	FNTClockSample Sample;
+	Sample.Time = LocalTime;
+	Sample.RTT = RTT;
+	Sample.Offset = ServerTime + RTT * 0.5 - LocalTime;
+	Samples.Add(Sample);
+
+	NumResponses++;
+	UpdateEstimate(LocalTime);
+
+	// Nothing to slew from yet
+	if (!bSynchronized)
+	{
+		Offset = EstimatedOffset;
+		bSynchronized = true;
+	}
+}
+
+void FNTClockSync::UpdateEstimate(double LocalTime)
+{
+	const UNTNetSettings* Settings = GetDefault<UNTNetSettings>();
+
+	// Older samples are brought forward by the drift we've seen since
+	TArray<FNTClockSample, TInlineAllocator<32>> Sorted;
+	for (const FNTClockSample& Sample : Samples)
+	{
+		FNTClockSample& Adjusted = Sorted[Sorted.Add(Sample)];
+		Adjusted.Offset += Drift * (LocalTime - Sample.Time);
+	}
+
+	Sorted.Sort([](const FNTClockSample& A, const FNTClockSample& B) { return A.RTT < B.RTT; });
+
+	const int32 NumBest = FMath::Clamp(FMath::RoundToInt(Sorted.Num() * Settings->ClockSyncBestFraction), 1, Sorted.Num());
+	double NewEstimate = 0.0;
+	for (int32 i = 0; i < NumBest; i++)
+	{
+		NewEstimate += Sorted[i].Offset;
+	}
+	NewEstimate /= NumBest;
+
+	// Drift is how fast the estimate moves. Only worth measuring over a decent stretch of time.
+	const double Elapsed = LocalTime - EstimateTime;
+	if (NumResponses > 1 && Elapsed >= Settings->ClockSyncInterval)
+	{
+		const double MaxDrift = Settings->ClockSyncMaxDrift;
+		const double SampleDrift = FMath::Clamp((NewEstimate - EstimatedOffset) / Elapsed, -MaxDrift, MaxDrift);
+		Drift += (SampleDrift - Drift) * 0.1;
+	}
+
+	if (NumResponses == 1 || Elapsed >= Settings->ClockSyncInterval)
+	{
+		EstimatedOffset = NewEstimate;
+		EstimateTime = LocalTime;
+	}
+}
+
+double FNTClockSync::GetTargetOffset(double LocalTime) const
+{
+	return EstimatedOffset + Drift * (LocalTime - EstimateTime);
+}
+
+double FNTClockSync::GetMinRTT() const
+{
+	double MinRTT = BIG_NUMBER;
+	for (const FNTClockSample& Sample : Samples)
+	{
+		MinRTT = FMath::Min(MinRTT, Sample.RTT);
+	}
+
+	return Samples.IsEmpty() ? 0.0 : MinRTT;
+}
+
+void FNTClockSync::Update(double LocalTime, float DeltaSeconds)
+{
+	if (!bSynchronized)
+	{
+		return;
+	}
+
+	const UNTNetSettings* Settings = GetDefault<UNTNetSettings>();
+	const double Error = GetTargetOffset(LocalTime) - Offset;
+
+	// Way out - Most likely a hitch on one end. Slewing would take forever, so jump.
+	if (FMath::Abs(Error) > Settings->ClockSyncSnapThreshold)
+	{
+		Offset += Error;
+		return;
+	}
+
+	const double MaxStep = Settings->ClockSyncMaxSlewRate * DeltaSeconds;
+	Offset += FMath::Clamp(Error, -MaxStep, MaxStep);
+}
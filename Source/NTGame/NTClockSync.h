@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "NTRingBuffer.h"
+
+/* One timestamp exchange with the Server */
+struct FNTClockSample
+{
+	/* Local time the response arrived */
+	double Time;
+	/* Round trip, in seconds */
+	double RTT;
+	/* Server time minus local time, assuming the trip was symmetric */
+	double Offset;
+
+	FNTClockSample()
+		: Time(0.0)
+		, RTT(0.0)
+		, Offset(0.0)
+	{}
+};
+
+/**
+ * Client - Estimates the Server's clock from timestamp exchanges sent at a fixed cadence.
+ *
+ * Queueing delay only ever makes a trip longer, and a longer trip is more likely to be lopsided, so the offset comes
+ * from the fastest few samples in the window rather than the latest one. Drift between the clocks is tracked from how
+ * the estimate moves over time. The offset we actually use is slewed towards the estimate, so Server time never jumps
+ * under the simulation once we're synchronized.
+ */
+struct NTGAME_API FNTClockSync
+{
+	FNTClockSync();
+
+	void Reset();
+
+	/* True when it's time to send another request. Faster until the window has filled. */
+	bool ShouldSendRequest(double LocalTime) const;
+	void OnRequestSent(double LocalTime);
+
+	/* ClientSendTime is our time echoed back by the Server, ServerTime the Server's time when it replied */
+	void OnResponse(double ClientSendTime, double ServerTime, double LocalTime);
+
+	/* Slews the offset in use towards the estimate */
+	void Update(double LocalTime, float DeltaSeconds);
+
+	bool IsSynchronized() const { return bSynchronized; }
+
+	double GetServerTime(double LocalTime) const { return LocalTime + Offset; }
+	double GetOffset() const { return Offset; }
+
+	/* Best estimate of the offset right now, drift included */
+	double GetTargetOffset(double LocalTime) const;
+
+	/* How fast the Server's clock runs relative to ours, in seconds per second */
+	double GetDrift() const { return Drift; }
+
+	/* RTT of the fastest sample in the window */
+	double GetMinRTT() const;
+
+private:
+	void UpdateEstimate(double LocalTime);
+
+	TNTRingBuffer<FNTClockSample> Samples;
+
+	/* Offset in use */
+	double Offset;
+
+	/* Offset estimated from the window, and when */
+	double EstimatedOffset;
+	double EstimateTime;
+
+	double Drift;
+
+	double LastRequestTime;
+	uint32 NumResponses;
+	bool bSynchronized;
+};
@@ -0,0 +1,136 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NTGame.h"
+#include "NTNetSettings.h"
+#include "NTCongestionControl.h"
+
+//////////////////////////////
+///// CONNECTION QUALITY /////
+//////////////////////////////
+
+FNTConnectionQuality::FNTConnectionQuality()
+	: SmoothedRTT(0.f)
+	, RTTVariance(0.f)
+	, Loss(0.f)
+	, bHasRTTSample(false)
+{}
+
+void FNTConnectionQuality::OnPingSent(float SendTime)
+{
+	OutstandingPings.Add(SendTime);
+}
+
+void FNTConnectionQuality::OnPingReturned(float SendTime, float CurrentTime)
+{
+	// Pings we've already written off as lost don't count twice
+	if (OutstandingPings.RemoveSingle(SendTime) == 0)
+	{
+		return;
+	}
+
+	const float Sample = CurrentTime - SendTime;
+	if (Sample < 0.f)
+	{
+		return;
+	}
+
+	if (!bHasRTTSample)
+	{
+		SmoothedRTT = Sample;
+		RTTVariance = Sample * 0.5f;
+		bHasRTTSample = true;
+	}
+	else
+	{
+		RTTVariance += (FMath::Abs(SmoothedRTT - Sample) - RTTVariance) * 0.25f;
+		SmoothedRTT += (Sample - SmoothedRTT) * 0.125f;
+	}
+
+	AddLossSample(false);
+}
+
+void FNTConnectionQuality::Update(float CurrentTime)
+{
+	const float Timeout = FMath::Max(1.0f, SmoothedRTT + RTTVariance * 4.0f);
+
+	for (int32 i = OutstandingPings.Num() - 1; i >= 0; i--)
+	{
+		if (CurrentTime - OutstandingPings[i] > Timeout)
+		{
+			OutstandingPings.RemoveAtSwap(i);
+			AddLossSample(true);
+		}
+	}
+}
+
+void FNTConnectionQuality::AddLossSample(bool bLost)
+{
+	// Roughly the last ten pings
+	Loss += ((bLost ? 1.f : 0.f) - Loss) * 0.1f;
+}
+
+//////////////////////////////
+///// CONGESTION CONTROL /////
+//////////////////////////////
+
+FNTCongestionControl::FNTCongestionControl()
+	: Mode(ENTConnectionMode::Good)
+	, TimeInMode(0.f)
+	, GoodConditionsTime(0.f)
+{
+	PenaltyTime = GetDefault<UNTNetSettings>()->CongestionInitialPenaltyTime;
+}
+
+void FNTCongestionControl::Update(float DeltaSeconds, float RTT, float RTTVariance, float Loss)
+{
+	const UNTNetSettings* Settings = GetDefault<UNTNetSettings>();
+	const bool bConditionsBad = RTT * 1000.0f > Settings->CongestionBadRTT
+		|| RTTVariance * 1000.0f > Settings->CongestionBadRTTVariance
+		|| Loss > Settings->CongestionBadLoss;
+
+	TimeInMode += DeltaSeconds;
+
+	if (Mode == ENTConnectionMode::Good)
+	{
+		if (bConditionsBad)
+		{
+			// Went bad again soon after recovering - We were too optimistic, so wait longer next time
+			if (TimeInMode < Settings->CongestionPenaltyRelaxTime)
+			{
+				PenaltyTime = FMath::Min(PenaltyTime * 2.0f, Settings->CongestionMaxPenaltyTime);
+			}
+
+			Mode = ENTConnectionMode::Bad;
+			TimeInMode = 0.f;
+			GoodConditionsTime = 0.f;
+			return;
+		}
+
+		GoodConditionsTime += DeltaSeconds;
+		if (GoodConditionsTime >= Settings->CongestionPenaltyRelaxTime)
+		{
+			PenaltyTime = FMath::Max(PenaltyTime * 0.5f, Settings->CongestionMinPenaltyTime);
+			GoodConditionsTime = 0.f;
+		}
+	}
+	else
+	{
+		GoodConditionsTime = bConditionsBad ? 0.f : GoodConditionsTime + DeltaSeconds;
+		if (GoodConditionsTime >= PenaltyTime)
+		{
+			Mode = ENTConnectionMode::Good;
+			TimeInMode = 0.f;
+			GoodConditionsTime = 0.f;
+		}
+	}
+}
+
+float FNTCongestionControl::GetRateScale() const
+{
+	return Mode == ENTConnectionMode::Bad ? GetDefault<UNTNetSettings>()->CongestionBadRateScale : 1.f;
+}
+
+float FNTCongestionControl::GetBudgetScale() const
+{
+	return Mode == ENTConnectionMode::Bad ? GetDefault<UNTNetSettings>()->CongestionBadBudgetScale : 1.f;
+}
@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "NTCongestionControl.generated.h"
+
+/* How hard the Server pushes a connection */
+UENUM()
+enum class ENTConnectionMode : uint8
+{
+	/* Full snapshot rate and budget */
+	Good,
+	/* Link can't keep up - Send less, less often */
+	Bad,
+};
+
+/**
+ * Client - Round trip time and packet loss, measured from the ping bounces ANTPlayerController already sends.
+ * A ping that hasn't come back after a few round trips is counted as lost.
+ */
+struct NTGAME_API FNTConnectionQuality
+{
+	FNTConnectionQuality();
+
+	void OnPingSent(float SendTime);
+	void OnPingReturned(float SendTime, float CurrentTime);
+
+	/* Expires pings that are never coming back */
+	void Update(float CurrentTime);
+
+	/* Smoothed round trip time and its mean deviation, in seconds. Same smoothing as TCP (RFC 6298). */
+	float SmoothedRTT;
+	float RTTVariance;
+
+	/* Fraction of recent pings lost, 0 - 1 */
+	float Loss;
+
+private:
+	void AddLossSample(bool bLost);
+
+	TArray<float> OutstandingPings;
+	bool bHasRTTSample;
+};
+
+/**
+ * Server - Good / Bad mode switching for one connection. Drops to Bad as soon as conditions turn, but only goes back
+ * to Good once they've been fine for the penalty time. Flapping straight back to Bad doubles the penalty, and a long
+ * run in Good halves it again.
+ */
+struct NTGAME_API FNTCongestionControl
+{
+	FNTCongestionControl();
+
+	/* RTT and Variance in seconds, Loss 0 - 1 */
+	void Update(float DeltaSeconds, float RTT, float RTTVariance, float Loss);
+
+	ENTConnectionMode GetMode() const { return Mode; }
+	float GetPenaltyTime() const { return PenaltyTime; }
+
+	/* Multipliers for send rate and snapshot size in the current mode */
+	float GetRateScale() const;
+	float GetBudgetScale() const;
+
+private:
+	ENTConnectionMode Mode;
+
+	/* How long conditions must stay good before we leave Bad */
+	float PenaltyTime;
+
+	/* Time in the current mode */
+	float TimeInMode;
+
+	/* Bad - How long conditions have been good. Good - Time since the penalty was last relaxed. */
+	float GoodConditionsTime;
+};
@@ -0,0 +1,296 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NTGame.h"
+#include "NTCubeIntegrator.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Moves Replayed"), STAT_NTMovesReplayed, STATGROUP_NTPrediction);
+
+FVector FCubeIntegrator::GetInputAccel(const FCubeInput& Input, float ForceStrength)
+{
+	FVector Result = FVector::ZeroVector;
+
+	/* Calculate Local Movement */
+	if (Input.Left) { Result.X -= ForceStrength; }
+	if (Input.Right) { Result.X += ForceStrength; }
+	if (Input.Forward) { Result.Y -= ForceStrength; }
+	if (Input.Backward) { Result.Y += ForceStrength; }
+
+	return Result;
+}
+
+namespace
+{
+	/* Four cubes, one register per component */
+	struct FCubeLanes
+	{
+		VectorRegister PX, PY, PZ;
+		VectorRegister QX, QY, QZ, QW;
+		VectorRegister VX, VY, VZ;
+		VectorRegister WX, WY, WZ;
+		VectorRegister AX, AY, AZ;
+		VectorRegister LinearDamping, AngularDamping, GravityZ;
+	};
+
+	/**
+	 * The one copy of the step arithmetic. Everything that steps a cube comes through here, with every operation in the same
+	 * order, so no compiler or call site can make a replay disagree with the live step.
+	 */
+	FORCEINLINE void StepLanes(FCubeLanes& L, float DeltaSeconds)
+	{
+		const VectorRegister Zero = VectorZero();
+		const VectorRegister One = VectorSetFloat1(1.f);
+		const VectorRegister Dt = VectorSetFloat1(DeltaSeconds);
+
+		// Input and Gravity
+		L.VX = VectorMultiplyAdd(L.AX, Dt, L.VX);
+		L.VY = VectorMultiplyAdd(L.AY, Dt, L.VY);
+		L.VZ = VectorMultiplyAdd(L.AZ, Dt, L.VZ);
+		L.VZ = VectorMultiplyAdd(L.GravityZ, Dt, L.VZ);
+
+		// Same damping model as PhysX
+		const VectorRegister LinearScale = VectorMin(VectorMax(VectorSubtract(One, VectorMultiply(L.LinearDamping, Dt)), Zero), One);
+		const VectorRegister AngularScale = VectorMin(VectorMax(VectorSubtract(One, VectorMultiply(L.AngularDamping, Dt)), Zero), One);
+		L.VX = VectorMultiply(L.VX, LinearScale);
+		L.VY = VectorMultiply(L.VY, LinearScale);
+		L.VZ = VectorMultiply(L.VZ, LinearScale);
+		L.WX = VectorMultiply(L.WX, AngularScale);
+		L.WY = VectorMultiply(L.WY, AngularScale);
+		L.WZ = VectorMultiply(L.WZ, AngularScale);
+
+		L.PX = VectorMultiplyAdd(L.VX, Dt, L.PX);
+		L.PY = VectorMultiplyAdd(L.VY, Dt, L.PY);
+		L.PZ = VectorMultiplyAdd(L.VZ, Dt, L.PZ);
+
+		// Angular Velocity is stored in Degrees, same as the body
+		const VectorRegister DegreesToRadians = VectorSetFloat1(PI / 180.f);
+		const VectorRegister OX = VectorMultiply(L.WX, DegreesToRadians);
+		const VectorRegister OY = VectorMultiply(L.WY, DegreesToRadians);
+		const VectorRegister OZ = VectorMultiply(L.WZ, DegreesToRadians);
+
+		// Lanes that aren't turning keep their rotation as it is, rather than being renormalized every step
+		const VectorRegister Tolerance = VectorSetFloat1(KINDA_SMALL_NUMBER);
+		const VectorRegister bSpinning = VectorBitwiseOr(VectorBitwiseOr(
+			VectorCompareGT(VectorAbs(OX), Tolerance),
+			VectorCompareGT(VectorAbs(OY), Tolerance)),
+			VectorCompareGT(VectorAbs(OZ), Tolerance));
+
+		// Spin = FQuat(Omega, 0) * Rotation, and Rotation += Spin * dt / 2
+		const VectorRegister SX = VectorSubtract(VectorMultiplyAdd(OX, L.QW, VectorMultiply(OY, L.QZ)), VectorMultiply(OZ, L.QY));
+		const VectorRegister SY = VectorSubtract(VectorMultiplyAdd(OY, L.QW, VectorMultiply(OZ, L.QX)), VectorMultiply(OX, L.QZ));
+		const VectorRegister SZ = VectorSubtract(VectorMultiplyAdd(OZ, L.QW, VectorMultiply(OX, L.QY)), VectorMultiply(OY, L.QX));
+		const VectorRegister SW = VectorNegate(VectorMultiplyAdd(OZ, L.QZ, VectorMultiplyAdd(OY, L.QY, VectorMultiply(OX, L.QX))));
+
+		const VectorRegister HalfDt = VectorSetFloat1(0.5f * DeltaSeconds);
+		const VectorRegister NX = VectorMultiplyAdd(SX, HalfDt, L.QX);
+		const VectorRegister NY = VectorMultiplyAdd(SY, HalfDt, L.QY);
+		const VectorRegister NZ = VectorMultiplyAdd(SZ, HalfDt, L.QZ);
+		const VectorRegister NW = VectorMultiplyAdd(SW, HalfDt, L.QW);
+
+		const VectorRegister SizeSquared = VectorMultiplyAdd(NW, NW, VectorMultiplyAdd(NZ, NZ, VectorMultiplyAdd(NY, NY, VectorMultiply(NX, NX))));
+		const VectorRegister InvSize = VectorReciprocalSqrtAccurate(SizeSquared);
+
+		L.QX = VectorSelect(bSpinning, VectorMultiply(NX, InvSize), L.QX);
+		L.QY = VectorSelect(bSpinning, VectorMultiply(NY, InvSize), L.QY);
+		L.QZ = VectorSelect(bSpinning, VectorMultiply(NZ, InvSize), L.QZ);
+		L.QW = VectorSelect(bSpinning, VectorMultiply(NW, InvSize), L.QW);
+	}
+
+	/* Steps one state in every lane, and reads the first back */
+	void StepSingle(FCubeState& State, const FVector& Accel, float DeltaSeconds, const FCubeSimParams& Params)
+	{
+		FCubeLanes L;
+		L.PX = VectorSetFloat1(State.Position.X);
+		L.PY = VectorSetFloat1(State.Position.Y);
+		L.PZ = VectorSetFloat1(State.Position.Z);
+		L.QX = VectorSetFloat1(State.Rotation.X);
+		L.QY = VectorSetFloat1(State.Rotation.Y);
+		L.QZ = VectorSetFloat1(State.Rotation.Z);
+		L.QW = VectorSetFloat1(State.Rotation.W);
+		L.VX = VectorSetFloat1(State.Velocity.X);
+		L.VY = VectorSetFloat1(State.Velocity.Y);
+		L.VZ = VectorSetFloat1(State.Velocity.Z);
+		L.WX = VectorSetFloat1(State.AngularVelocity.X);
+		L.WY = VectorSetFloat1(State.AngularVelocity.Y);
+		L.WZ = VectorSetFloat1(State.AngularVelocity.Z);
+		L.AX = VectorSetFloat1(Accel.X);
+		L.AY = VectorSetFloat1(Accel.Y);
+		L.AZ = VectorSetFloat1(Accel.Z);
+		L.LinearDamping = VectorSetFloat1(Params.LinearDamping);
+		L.AngularDamping = VectorSetFloat1(Params.AngularDamping);
+		L.GravityZ = VectorSetFloat1(Params.GravityZ);
+
+		StepLanes(L, DeltaSeconds);
+
+		VectorStoreFloat1(L.PX, &State.Position.X);
+		VectorStoreFloat1(L.PY, &State.Position.Y);
+		VectorStoreFloat1(L.PZ, &State.Position.Z);
+		VectorStoreFloat1(L.QX, &State.Rotation.X);
+		VectorStoreFloat1(L.QY, &State.Rotation.Y);
+		VectorStoreFloat1(L.QZ, &State.Rotation.Z);
+		VectorStoreFloat1(L.QW, &State.Rotation.W);
+		VectorStoreFloat1(L.VX, &State.Velocity.X);
+		VectorStoreFloat1(L.VY, &State.Velocity.Y);
+		VectorStoreFloat1(L.VZ, &State.Velocity.Z);
+		VectorStoreFloat1(L.WX, &State.AngularVelocity.X);
+		VectorStoreFloat1(L.WY, &State.AngularVelocity.Y);
+		VectorStoreFloat1(L.WZ, &State.AngularVelocity.Z);
+	}
+}
+
+void FCubeIntegrator::Integrate(FCubeState& State, float DeltaSeconds, const FCubeSimParams& Params)
+{
+	StepSingle(State, FVector::ZeroVector, DeltaSeconds, Params);
+}
+
+void FCubeIntegrator::Step(FCubeState& State, const FCubeInput& Input, float DeltaSeconds, const FCubeSimParams& Params)
+{
+	StepSingle(State, GetInputAccel(Input, Params.ForceStrength), DeltaSeconds, Params);
+}
+
+void FCubeIntegrator::StepBatch(FCubeStateBatch& Batch, float DeltaSeconds)
+{
+	const int32 NumPadded = Batch.PositionX.Num();
+	for (int32 i = 0; i < NumPadded; i += 4)
+	{
+		FCubeLanes L;
+		L.PX = VectorLoad(&Batch.PositionX[i]);
+		L.PY = VectorLoad(&Batch.PositionY[i]);
+		L.PZ = VectorLoad(&Batch.PositionZ[i]);
+		L.QX = VectorLoad(&Batch.RotationX[i]);
+		L.QY = VectorLoad(&Batch.RotationY[i]);
+		L.QZ = VectorLoad(&Batch.RotationZ[i]);
+		L.QW = VectorLoad(&Batch.RotationW[i]);
+		L.VX = VectorLoad(&Batch.VelocityX[i]);
+		L.VY = VectorLoad(&Batch.VelocityY[i]);
+		L.VZ = VectorLoad(&Batch.VelocityZ[i]);
+		L.WX = VectorLoad(&Batch.AngularVelocityX[i]);
+		L.WY = VectorLoad(&Batch.AngularVelocityY[i]);
+		L.WZ = VectorLoad(&Batch.AngularVelocityZ[i]);
+		L.AX = VectorLoad(&Batch.AccelX[i]);
+		L.AY = VectorLoad(&Batch.AccelY[i]);
+		L.AZ = VectorLoad(&Batch.AccelZ[i]);
+		L.LinearDamping = VectorLoad(&Batch.LinearDamping[i]);
+		L.AngularDamping = VectorLoad(&Batch.AngularDamping[i]);
+		L.GravityZ = VectorLoad(&Batch.GravityZ[i]);
+
+		StepLanes(L, DeltaSeconds);
+
+		VectorStore(L.PX, &Batch.PositionX[i]);
+		VectorStore(L.PY, &Batch.PositionY[i]);
+		VectorStore(L.PZ, &Batch.PositionZ[i]);
+		VectorStore(L.QX, &Batch.RotationX[i]);
+		VectorStore(L.QY, &Batch.RotationY[i]);
+		VectorStore(L.QZ, &Batch.RotationZ[i]);
+		VectorStore(L.QW, &Batch.RotationW[i]);
+		VectorStore(L.VX, &Batch.VelocityX[i]);
+		VectorStore(L.VY, &Batch.VelocityY[i]);
+		VectorStore(L.VZ, &Batch.VelocityZ[i]);
+		VectorStore(L.WX, &Batch.AngularVelocityX[i]);
+		VectorStore(L.WY, &Batch.AngularVelocityY[i]);
+		VectorStore(L.WZ, &Batch.AngularVelocityZ[i]);
+	}
+}
+
+FCubeState FCubeIntegrator::ReplayHistory(FNTMoveHistory& History, const FCubeState& CorrectedState, const FCubeSimParams& Params)
+{
+	// Discard Corrected Move
+	History.Remove();
+
+	FCubeState ReplayState = CorrectedState;
+	INC_DWORD_STAT_BY(STAT_NTMovesReplayed, History.Num());
+
+	// Each move's state is recorded at the end of its step, so the newest one is where the body is now
+	for (uint32 i = 0; i < History.Num(); i++)
+	{
+		Step(ReplayState, History.GetInput(i), History.GetDeltaTime(i), Params);
+		ReplayState.Quantize();
+
+		FCubeQuantizedState Quantized;
+		Quantized.FromState(ReplayState);
+		History.SetState(i, Quantized.ToState());
+		History.SetStateHash(i, (int32)Quantized.GetHash());
+	}
+
+	return ReplayState;
+}
+
+////////////////////////////
+///// CUBE STATE BATCH /////
+////////////////////////////
+
+void FCubeStateBatch::SetNum(int32 NewNum)
+{
+	const int32 OldPadded = PositionX.Num();
+	const int32 NumPadded = Align(NewNum, 4);
+
+	TArray<float>* Columns[] = {
+		&PositionX, &PositionY, &PositionZ,
+		&RotationX, &RotationY, &RotationZ, &RotationW,
+		&VelocityX, &VelocityY, &VelocityZ,
+		&AngularVelocityX, &AngularVelocityY, &AngularVelocityZ,
+		&AccelX, &AccelY, &AccelZ,
+		&LinearDamping, &AngularDamping, &GravityZ
+	};
+
+	for (TArray<float>* Column : Columns)
+	{
+		Column->SetNumZeroed(NumPadded, false);
+	}
+
+	// Padding lanes are a cube at rest, with a rotation that's safe to normalize
+	for (int32 i = NewNum; i < NumPadded; i++)
+	{
+		for (TArray<float>* Column : Columns)
+		{
+			(*Column)[i] = 0.f;
+		}
+		RotationW[i] = 1.f;
+	}
+
+	NumStates = NewNum;
+}
+
+void FCubeStateBatch::SetState(int32 Index, const FCubeState& State)
+{
+	checkSlow(Index < NumStates);
+	PositionX[Index] = State.Position.X;
+	PositionY[Index] = State.Position.Y;
+	PositionZ[Index] = State.Position.Z;
+	RotationX[Index] = State.Rotation.X;
+	RotationY[Index] = State.Rotation.Y;
+	RotationZ[Index] = State.Rotation.Z;
+	RotationW[Index] = State.Rotation.W;
+	VelocityX[Index] = State.Velocity.X;
+	VelocityY[Index] = State.Velocity.Y;
+	VelocityZ[Index] = State.Velocity.Z;
+	AngularVelocityX[Index] = State.AngularVelocity.X;
+	AngularVelocityY[Index] = State.AngularVelocity.Y;
+	AngularVelocityZ[Index] = State.AngularVelocity.Z;
+}
+
+FCubeState FCubeStateBatch::GetState(int32 Index) const
+{
+	checkSlow(Index < NumStates);
+	FCubeState State;
+	State.Position = FVector(PositionX[Index], PositionY[Index], PositionZ[Index]);
+	State.Rotation = FQuat(RotationX[Index], RotationY[Index], RotationZ[Index], RotationW[Index]);
+	State.Velocity = FVector(VelocityX[Index], VelocityY[Index], VelocityZ[Index]);
+	State.AngularVelocity = FVector(AngularVelocityX[Index], AngularVelocityY[Index], AngularVelocityZ[Index]);
+	return State;
+}
+
+void FCubeStateBatch::SetParams(int32 Index, const FCubeSimParams& Params)
+{
+	checkSlow(Index < NumStates);
+	LinearDamping[Index] = Params.LinearDamping;
+	AngularDamping[Index] = Params.AngularDamping;
+	GravityZ[Index] = Params.GravityZ;
+}
+
+void FCubeStateBatch::SetAccel(int32 Index, const FVector& Accel)
+{
+	checkSlow(Index < NumStates);
+	AccelX[Index] = Accel.X;
+	AccelY[Index] = Accel.Y;
+	AccelZ[Index] = Accel.Z;
+}
@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "NTPawn.h"
+
+/**
+ * Parameters the headless integrator needs from the live body.
+ */
+struct FCubeSimParams
+{
+	float ForceStrength;
+	float LinearDamping;
+	float AngularDamping;
+	float GravityZ; // Zero by default - The bodies are kinematic, so nothing holds a cube up. It's assumed to be resting on the ground.
+
+	FCubeSimParams()
+		: ForceStrength(1500.0f)
+		, LinearDamping(0.01f)
+		, AngularDamping(0.f)
+		, GravityZ(0.f)
+	{}
+};
+
+/**
+ * Many cubes' states and step parameters, one array per component, for FCubeIntegrator::StepBatch to step four at a time.
+ * The arrays are padded to a multiple of four. Padding lanes hold a cube at rest, so stepping them is harmless.
+ */
+struct NTGAME_API FCubeStateBatch
+{
+	FCubeStateBatch()
+		: NumStates(0)
+	{}
+
+	int32 Num() const { return NumStates; }
+
+	/* Sets the number of states, keeping the allocation. States past the old Num() need setting before they're stepped. */
+	void SetNum(int32 NewNum);
+
+	void SetState(int32 Index, const FCubeState& State);
+	FCubeState GetState(int32 Index) const;
+
+	/* Damping and gravity for the cube at Index. ForceStrength is already part of its Accel. */
+	void SetParams(int32 Index, const FCubeSimParams& Params);
+
+	/* Linear acceleration from the cube's input this step, see FCubeIntegrator::GetInputAccel */
+	void SetAccel(int32 Index, const FVector& Accel);
+	FVector GetAccel(int32 Index) const { return FVector(AccelX[Index], AccelY[Index], AccelZ[Index]); }
+
+	TArray<float> PositionX;
+	TArray<float> PositionY;
+	TArray<float> PositionZ;
+	TArray<float> RotationX;
+	TArray<float> RotationY;
+	TArray<float> RotationZ;
+	TArray<float> RotationW;
+	TArray<float> VelocityX;
+	TArray<float> VelocityY;
+	TArray<float> VelocityZ;
+	TArray<float> AngularVelocityX;
+	TArray<float> AngularVelocityY;
+	TArray<float> AngularVelocityZ;
+
+	TArray<float> AccelX;
+	TArray<float> AccelY;
+	TArray<float> AccelZ;
+	TArray<float> LinearDamping;
+	TArray<float> AngularDamping;
+	TArray<float> GravityZ;
+
+private:
+	int32 NumStates;
+};
+
+/**
+ * Engine-light integrator for FCubeState. The live cubes are kinematic and step through Step as well, so moves can be
+ * replayed on plain structs without touching the physics scene and still land where the live body did.
+ * Only the final state needs writing back to the body.
+ *
+ * All of the arithmetic runs four cubes at a time in one SIMD kernel. StepBatch fills the lanes with different cubes, and
+ * Step fills them with copies of one, so a cube stepped in ANTCubeManager's batch and the same cube replayed alone land
+ * on the same bits.
+ *
+ * There's no PhysX response in this model - No gravity, no angular response to contacts, no friction. ANTPawn::MoveBody
+ * sweeps each step and removes the velocity into whatever it hits, and a cube that gets hit takes that velocity on.
+ */
+struct NTGAME_API FCubeIntegrator
+{
+	/* Linear acceleration produced by an input */
+	static FVector GetInputAccel(const FCubeInput& Input, float ForceStrength);
+
+	/* Steps the state forwards with no input - Gravity, Damping, then Position and Rotation */
+	static void Integrate(FCubeState& State, float DeltaSeconds, const FCubeSimParams& Params);
+
+	/* One whole simulation step, exactly as the live cube takes it - The input's acceleration, then Integrate */
+	static void Step(FCubeState& State, const FCubeInput& Input, float DeltaSeconds, const FCubeSimParams& Params);
+
+	/* Step for every state in the batch, with each one's Accel as its input */
+	static void StepBatch(FCubeStateBatch& Batch, float DeltaSeconds);
+
+	/* Discards the corrected (oldest) move, replays the rest from CorrectedState and stores the new states. Returns where the body should be now.
+	 * Each step is quantized afterwards, as ANTPawn::EndStep does, so the replayed hashes match the ones the Server computes. */
+	static FCubeState ReplayHistory(FNTMoveHistory& History, const FCubeState& CorrectedState, const FCubeSimParams& Params);
+};
@@ -0,0 +1,366 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NTGame.h"
+#include "NTPawn.h"
+#include "NTCubeIntegrator.h"
+#include "NTNetSettings.h"
+#include "AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace NTIntegratorTests
+{
+	const float StepTime = 1.f / 60.0f;
+	const int32 NumSteps = 240;
+
+	/* Body transforms are stored as floats, so allow a little rounding */
+	const float PositionTolerance = 0.01f;
+	const float RotationTolerance = 0.001f;
+	const float VelocityTolerance = 0.01f;
+
+	/* The integrator takes fixed first-order steps, so it trails the closed-form motion a little. At 60Hz over a few seconds that stays well under 1%. */
+	const float AnalyticTolerance = 0.01f;
+
+	/* Within AnalyticTolerance of Expected, relative to its size */
+	bool IsNearAnalytic(float Actual, float Expected)
+	{
+		return FMath::Abs(Actual - Expected) <= FMath::Abs(Expected) * AnalyticTolerance;
+	}
+
+	/* A game world of its own with one cube in it, far from anything it could hit */
+	struct FTestWorld
+	{
+		UWorld* World;
+		ANTPawn* Cube;
+
+		FTestWorld()
+		{
+			World = UWorld::CreateWorld(EWorldType::Game, false);
+			FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+			WorldContext.SetCurrentWorld(World);
+
+			World->InitializeActorsForPlay(FURL());
+			World->BeginPlay();
+
+			Cube = World->SpawnActor<ANTPawn>(FVector::ZeroVector, FRotator::ZeroRotator);
+		}
+
+		~FTestWorld()
+		{
+			GEngine->DestroyWorldContext(World);
+			World->DestroyWorld(false);
+		}
+	};
+
+	/* Moving and spinning, so every term of the integrator has something to do */
+	FCubeState MakeStartState()
+	{
+		FCubeState State;
+		State.Position = FVector(0.f, 0.f, 500.0f);
+		State.Rotation = FQuat(FVector(0.f, 0.f, 1.f), 0.3f);
+		State.Velocity = FVector(120.0f, -40.0f, 0.f);
+		State.AngularVelocity = FVector(0.f, 30.0f, 90.0f);
+		return State;
+	}
+
+	/* Holds each combination of keys for a few ticks, so there are plenty of transitions */
+	FCubeInput GetInput(int32 Step)
+	{
+		FCubeInput Input;
+		Input.FromBits((Step / 7) & 15);
+		return Input;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNTIntegratorForceResponseTest, "NTGame.Integrator.ForceResponse", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FNTIntegratorForceResponseTest::RunTest(const FString& Parameters)
+{
+	using namespace NTIntegratorTests;
+
+	FTestWorld TestWorld;
+	ANTPawn* Cube = TestWorld.Cube;
+	if (!TestTrue(TEXT("Cube spawned"), Cube != nullptr))
+	{
+		return false;
+	}
+
+	// Holding Right from rest against linear damping d: v(t) = F/d (1 - e^-dt), x(t) = F/d (t - (1 - e^-dt) / d)
+	const float Damping = 0.2f;
+	Cube->GetRootCollision()->SetLinearDamping(Damping);
+
+	const FCubeSimParams Params = Cube->GetSimParams();
+	TestEqual(TEXT("Sim params pick up the body's damping"), Params.LinearDamping, Damping);
+
+	FCubeState StartState;
+	StartState.Position = FVector(0.f, 0.f, 500.0f);
+	Cube->Snap(StartState);
+
+	FCubeInput Right;
+	Right.Right = true;
+	for (int32 Step = 0; Step < NumSteps; Step++)
+	{
+		Cube->CalculateAccel(StepTime, Right);
+	}
+
+	const float Time = NumSteps * StepTime;
+	const float Force = Params.ForceStrength;
+	const float Settle = 1.f - FMath::Exp(-Damping * Time);
+	const float ExpectedSpeed = Force / Damping * Settle;
+	const float ExpectedDistance = Force / Damping * (Time - Settle / Damping);
+
+	const FCubeState& Result = Cube->CurrentPhysState;
+	const FVector BodyLocation = Cube->GetRootCollision()->GetComponentLocation();
+	TestTrue(FString::Printf(TEXT("Speed %.2f is within 1%% of F/d (1 - e^-dt) = %.2f"), Result.Velocity.X, ExpectedSpeed), IsNearAnalytic(Result.Velocity.X, ExpectedSpeed));
+	TestTrue(FString::Printf(TEXT("Distance %.2f is within 1%% of the closed form %.2f"), BodyLocation.X - StartState.Position.X, ExpectedDistance), IsNearAnalytic(BodyLocation.X - StartState.Position.X, ExpectedDistance));
+	TestTrue(TEXT("Right only pushes along +X"), FMath::IsNearlyZero(Result.Velocity.Y) && FMath::IsNearlyZero(Result.Velocity.Z));
+	TestTrue(TEXT("Body is where the cube's state says"), BodyLocation.Equals(Result.Position, PositionTolerance));
+
+	// Gravity isn't on for the live cubes, so check it on the integrator alone: v(t) = gt, z(t) = gt^2 / 2
+	FCubeSimParams Falling;
+	Falling.LinearDamping = 0.f;
+	Falling.GravityZ = -980.0f;
+
+	FCubeState Dropped;
+	for (int32 Step = 0; Step < NumSteps; Step++)
+	{
+		FCubeIntegrator::Step(Dropped, FCubeInput(), StepTime, Falling);
+	}
+
+	TestTrue(FString::Printf(TEXT("Falling speed %.2f is within 1%% of gt = %.2f"), Dropped.Velocity.Z, Falling.GravityZ * Time), IsNearAnalytic(Dropped.Velocity.Z, Falling.GravityZ * Time));
+	TestTrue(FString::Printf(TEXT("Fall %.2f is within 1%% of gt^2 / 2 = %.2f"), Dropped.Position.Z, 0.5f * Falling.GravityZ * Time * Time), IsNearAnalytic(Dropped.Position.Z, 0.5f * Falling.GravityZ * Time * Time));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNTIntegratorDampingDecayTest, "NTGame.Integrator.DampingDecay", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FNTIntegratorDampingDecayTest::RunTest(const FString& Parameters)
+{
+	using namespace NTIntegratorTests;
+
+	FTestWorld TestWorld;
+	ANTPawn* Cube = TestWorld.Cube;
+	if (!TestTrue(TEXT("Cube spawned"), Cube != nullptr))
+	{
+		return false;
+	}
+
+	// Coasting with no input: v(t) = v0 e^-dt, x(t) = v0 / d (1 - e^-dt), and the same decay for spin
+	const float LinearDamping = 0.5f;
+	const float AngularDamping = 0.25f;
+	Cube->GetRootCollision()->SetLinearDamping(LinearDamping);
+	Cube->GetRootCollision()->SetAngularDamping(AngularDamping);
+
+	FCubeState StartState;
+	StartState.Position = FVector(0.f, 0.f, 500.0f);
+	StartState.Velocity = FVector(300.0f, -150.0f, 0.f);
+	StartState.AngularVelocity = FVector(0.f, 0.f, 180.0f);
+	Cube->Snap(StartState);
+
+	for (int32 Step = 0; Step < NumSteps; Step++)
+	{
+		Cube->CalculateAccel(StepTime, FCubeInput());
+	}
+
+	const float Time = NumSteps * StepTime;
+	const float LinearDecay = FMath::Exp(-LinearDamping * Time);
+	const FVector ExpectedVelocity = StartState.Velocity * LinearDecay;
+	const FVector ExpectedTravel = StartState.Velocity / LinearDamping * (1.f - LinearDecay);
+	const float ExpectedSpin = StartState.AngularVelocity.Z * FMath::Exp(-AngularDamping * Time);
+
+	const FCubeState& Result = Cube->CurrentPhysState;
+	const FVector Travel = Cube->GetRootCollision()->GetComponentLocation() - StartState.Position;
+	TestTrue(FString::Printf(TEXT("Velocity %s is within 1%% of v0 e^-dt = %s"), *Result.Velocity.ToString(), *ExpectedVelocity.ToString()), IsNearAnalytic(Result.Velocity.X, ExpectedVelocity.X) && IsNearAnalytic(Result.Velocity.Y, ExpectedVelocity.Y));
+	TestTrue(FString::Printf(TEXT("Travel %s is within 1%% of v0 / d (1 - e^-dt) = %s"), *Travel.ToString(), *ExpectedTravel.ToString()), IsNearAnalytic(Travel.X, ExpectedTravel.X) && IsNearAnalytic(Travel.Y, ExpectedTravel.Y));
+	TestTrue(FString::Printf(TEXT("Spin %.3f is within 1%% of w0 e^-dt = %.3f"), Result.AngularVelocity.Z, ExpectedSpin), IsNearAnalytic(Result.AngularVelocity.Z, ExpectedSpin));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNTIntegratorSpinRateTest, "NTGame.Integrator.SpinRate", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FNTIntegratorSpinRateTest::RunTest(const FString& Parameters)
+{
+	using namespace NTIntegratorTests;
+
+	FTestWorld TestWorld;
+	ANTPawn* Cube = TestWorld.Cube;
+	if (!TestTrue(TEXT("Cube spawned"), Cube != nullptr))
+	{
+		return false;
+	}
+
+	// Undamped spin at w degrees a second turns the cube by w * t about the spin axis
+	Cube->GetRootCollision()->SetAngularDamping(0.f);
+
+	const FVector Axis = FVector(1.f, 2.f, 2.f).GetSafeNormal();
+	const float DegreesPerSecond = 90.0f;
+
+	FCubeState StartState;
+	StartState.Position = FVector(0.f, 0.f, 500.0f);
+	StartState.Rotation = FQuat(FVector(0.f, 0.f, 1.f), 0.3f);
+	StartState.AngularVelocity = Axis * DegreesPerSecond;
+	Cube->Snap(StartState);
+
+	for (int32 Step = 0; Step < NumSteps; Step++)
+	{
+		Cube->CalculateAccel(StepTime, FCubeInput());
+	}
+
+	const float Time = NumSteps * StepTime;
+	const FQuat Expected = FQuat(Axis, FMath::DegreesToRadians(DegreesPerSecond * Time)) * StartState.Rotation;
+
+	// First-order steps undershoot the angle by about (w dt)^3 / 12 a step, a few ten-thousandths of a radian here
+	const float AngleError = Cube->GetRootCollision()->GetComponentQuat().AngularDistance(Expected);
+	TestTrue(FString::Printf(TEXT("Body turned within 0.01 rad of w * t (error %.5f rad)"), AngleError), AngleError <= 0.01f);
+	TestTrue(TEXT("Rotation stays normalized"), Cube->CurrentPhysState.Rotation.IsNormalized());
+	TestTrue(TEXT("Spinning doesn't move the cube"), Cube->CurrentPhysState.Position.Equals(StartState.Position, PositionTolerance));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNTIntegratorReplayReproducesLiveStepsTest, "NTGame.Integrator.ReplayReproducesLiveSteps", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FNTIntegratorReplayReproducesLiveStepsTest::RunTest(const FString& Parameters)
+{
+	using namespace NTIntegratorTests;
+
+	FTestWorld TestWorld;
+	ANTPawn* Cube = TestWorld.Cube;
+	if (!TestTrue(TEXT("Cube spawned"), Cube != nullptr))
+	{
+		return false;
+	}
+
+	const FCubeSimParams Params = Cube->GetSimParams();
+	const FCubeState StartState = MakeStartState();
+	Cube->Snap(StartState);
+
+	// Record the live cube the way the history does - The state at the end of each step, with that step's input
+	FNTMoveHistory History;
+	History.Resize(NumSteps + 1);
+
+	FCubeMove StartMove;
+	StartMove.CubeState = StartState;
+	StartMove.DeltaTime = StepTime;
+	History.Add(StartMove);
+
+	TArray<uint32> LiveHashes;
+	for (int32 Step = 0; Step < NumSteps; Step++)
+	{
+		const FCubeInput Input = GetInput(Step);
+		Cube->CalculateAccel(StepTime, Input);
+
+		// As EndStep does
+		Cube->CurrentPhysState.Quantize();
+
+		FCubeQuantizedState Quantized;
+		Quantized.FromState(Cube->CurrentPhysState);
+		LiveHashes.Add(Quantized.GetHash());
+
+		FCubeMove Move;
+		Move.TickNumber = Step + 1;
+		Move.CubeInput = Input;
+		Move.CubeState = Quantized.ToState();
+		Move.DeltaTime = StepTime;
+		History.Add(Move);
+	}
+
+	const FCubeState LiveState = Cube->CurrentPhysState;
+	const FVector LivePosition = Cube->GetRootCollision()->GetComponentLocation();
+
+	// Started from the exact live state, a replay has to take every step bit for bit the same as the live cube did
+	{
+		FNTMoveHistory Replayed = History;
+		const FCubeState Result = FCubeIntegrator::ReplayHistory(Replayed, StartState, Params);
+
+		TestEqual(TEXT("Replay keeps every move after the corrected one"), (int32)Replayed.Num(), NumSteps);
+		TestTrue(TEXT("Replay ends where the live cube is"), Result == LiveState);
+		TestTrue(FString::Printf(TEXT("Replay ends within %.3f cm of the body"), PositionTolerance), Result.Position.Equals(LivePosition, PositionTolerance));
+
+		int32 NumHashMismatches = 0;
+		for (uint32 i = 0; i < Replayed.Num(); i++)
+		{
+			NumHashMismatches += (uint32)Replayed.GetStateHash(i) != LiveHashes[i] ? 1 : 0;
+		}
+		TestEqual(TEXT("Replayed state hashes match the live cube's"), NumHashMismatches, 0);
+	}
+
+	// A correction that only moves the cube carries straight through - Position doesn't feed back into the forces
+	{
+		const FVector Offset(50.0f, -25.0f, 0.f);
+		FCubeState Corrected = StartState;
+		Corrected.Position += Offset;
+
+		FNTMoveHistory Replayed = History;
+		const FCubeState Result = FCubeIntegrator::ReplayHistory(Replayed, Corrected, Params);
+
+		// Each step rounds the position to the network's precision, and the offset can tip that rounding by one step either way
+		const float QuantizedTolerance = GetDefault<UNTNetSettings>()->PositionPrecision;
+		TestTrue(TEXT("Offset correction moves the result by the offset"), Result.Position.Equals(LiveState.Position + Offset, QuantizedTolerance));
+		TestTrue(TEXT("Offset correction leaves velocity alone"), Result.Velocity.Equals(LiveState.Velocity, VelocityTolerance));
+		TestTrue(TEXT("Offset correction leaves rotation alone"), Result.Rotation.AngularDistance(LiveState.Rotation) <= RotationTolerance);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNTIntegratorBatchMatchesSingleStepsTest, "NTGame.Integrator.BatchMatchesSingleSteps", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FNTIntegratorBatchMatchesSingleStepsTest::RunTest(const FString& Parameters)
+{
+	using namespace NTIntegratorTests;
+
+	// Not a multiple of four, so the last group of lanes is part padding
+	const int32 NumCubes = 13;
+	FRandomStream Random(NumCubes);
+
+	TArray<FCubeState> States;
+	TArray<FCubeSimParams> Params;
+	FCubeStateBatch Batch;
+	Batch.SetNum(NumCubes);
+
+	for (int32 i = 0; i < NumCubes; i++)
+	{
+		FCubeState State;
+		State.Position = Random.VRand() * Random.FRandRange(0.f, 5000.0f);
+		State.Rotation = FQuat(Random.VRand(), Random.FRandRange(-PI, PI));
+		State.Velocity = Random.VRand() * Random.FRandRange(0.f, 1000.0f);
+		State.AngularVelocity = i % 3 == 0 ? FVector::ZeroVector : Random.VRand() * Random.FRandRange(0.f, 360.0f);
+		States.Add(State);
+
+		FCubeSimParams CubeParams;
+		CubeParams.LinearDamping = Random.FRandRange(0.f, 1.f);
+		CubeParams.AngularDamping = Random.FRandRange(0.f, 1.f);
+		Params.Add(CubeParams);
+
+		Batch.SetState(i, State);
+		Batch.SetParams(i, CubeParams);
+	}
+
+	// The live cubes step in ANTCubeManager's batch and replay alone, so the two have to agree to the bit
+	int32 NumMismatches = 0;
+	for (int32 Step = 0; Step < NumSteps; Step++)
+	{
+		for (int32 i = 0; i < NumCubes; i++)
+		{
+			const FCubeInput Input = GetInput(Step + i);
+			Batch.SetAccel(i, FCubeIntegrator::GetInputAccel(Input, Params[i].ForceStrength));
+			FCubeIntegrator::Step(States[i], Input, StepTime, Params[i]);
+		}
+
+		FCubeIntegrator::StepBatch(Batch, StepTime);
+
+		for (int32 i = 0; i < NumCubes; i++)
+		{
+			NumMismatches += Batch.GetState(i) == States[i] ? 0 : 1;
+		}
+	}
+
+	TestEqual(TEXT("Batched steps match single steps exactly"), NumMismatches, 0);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,364 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NTGame.h"
+#include "NTPawn.h"
+#include "NTNetSettings.h"
+#include "NTCubeManager.h"
+#include "ParallelFor.h"
+
+DECLARE_CYCLE_STAT(TEXT("Step Cubes"), STAT_NTStepCubes, STATGROUP_NTPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cubes At Rest"), STAT_NTCubesAtRest, STATGROUP_NTPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cubes Holding For Input"), STAT_NTCubesHoldingForInput, STATGROUP_NTPrediction);
+DECLARE_CYCLE_STAT(TEXT("Correction Replay (Wall)"), STAT_NTCorrectionReplayWall, STATGROUP_NTPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Corrections Replayed"), STAT_NTCorrectionsReplayed, STATGROUP_NTPrediction);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Correction Replay Parallel Speedup"), STAT_NTCorrectionReplaySpeedup, STATGROUP_NTPrediction);
+
+static TAutoConsoleVariable<int32> CVarParallelCorrectionThreshold(
+	TEXT("nt.ParallelCorrectionThreshold"),
+	4,
+	TEXT("Corrections in a frame before replays are spread across worker threads. Fewer than this replay serially on the game thread."),
+	ECVF_Default);
+
+/* One manager per world, kept here so ANTCubeManager::Get doesn't have to search the world's actors for it */
+static TMap<const UWorld*, TWeakObjectPtr<ANTCubeManager>> ManagersByWorld;
+
+ANTCubeManager::ANTCubeManager(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = true;
+	PrimaryActorTick.TickGroup = ETickingGroup::TG_PrePhysics;
+
+	bReplicates = false;
+
+	StepTime = 1.f / 60.0f;
+	MaxCatchUpSteps = 5;
+	TickAccumulator = 0.f;
+	SimulationTimeScale = 1.f;
+	NextCubeId = 0;
+	ServerTick = 0;
+
+	const UNTNetSettings* Settings = GetDefault<UNTNetSettings>();
+	bUseRelevancyGrid = Settings->bUseRelevancyGrid;
+	RelevancyGrid.Reset(Settings->RelevancyCellSize);
+
+	for (uint8 Bits = 0; Bits < 16; Bits++)
+	{
+		FCubeInput Input;
+		Input.FromBits(Bits);
+		InputAccelTable[Bits] = FCubeIntegrator::GetInputAccel(Input, 1.f);
+	}
+}
+
+ANTCubeManager* ANTCubeManager::Get(UWorld* World)
+{
+	if (!World)
+	{
+		return nullptr;
+	}
+
+	ANTCubeManager* Manager = ManagersByWorld.FindRef(World).Get();
+	if (Manager && !Manager->IsPendingKill())
+	{
+		return Manager;
+	}
+
+	FActorSpawnParameters SpawnInfo;
+	SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnInfo.ObjectFlags |= RF_Transient;
+	Manager = World->SpawnActor<ANTCubeManager>(SpawnInfo);
+
+	ManagersByWorld.Add(World, Manager);
+	return Manager;
+}
+
+void ANTCubeManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Super::EndPlay(EndPlayReason);
+
+	if (ManagersByWorld.FindRef(GetWorld()).Get() == this)
+	{
+		ManagersByWorld.Remove(GetWorld());
+	}
+}
+
+void ANTCubeManager::RegisterCube(ANTPawn* Cube)
+{
+	check(Cube);
+	if (Cube->CubeIndex != INDEX_NONE)
+	{
+		return;
+	}
+
+	if (Cubes.Num() == 0)
+	{
+		StepTime = Cube->GetFixedDeltaTime();
+		MaxCatchUpSteps = Cube->MaxCatchUpSteps;
+	}
+	else
+	{
+		ensureMsgf(FMath::IsNearlyEqual(StepTime, Cube->GetFixedDeltaTime()), TEXT("Cubes stepped by ANTCubeManager must share a FixedTickRate"));
+	}
+
+	// The Server hands out ids, Clients get them through replication
+	if (Cube->Role == ROLE_Authority && Cube->CubeId == INDEX_NONE)
+	{
+		Cube->CubeId = NextCubeId++;
+	}
+
+	if (Cube->CubeId != INDEX_NONE)
+	{
+		CubesById.Add(Cube->CubeId, Cube);
+	}
+
+	if (bUseRelevancyGrid && Cube->Role == ROLE_Authority)
+	{
+		RelevancyGrid.Add(Cube->CubeId, Cube->GetActorLocation());
+	}
+
+	Cube->CubeIndex = Cubes.Add(Cube);
+	SimParams.Add(Cube->GetSimParams());
+}
+
+void ANTCubeManager::UnregisterCube(ANTPawn* Cube)
+{
+	check(Cube);
+	const int32 Index = Cube->CubeIndex;
+	if (!Cubes.IsValidIndex(Index) || Cubes[Index] != Cube)
+	{
+		return;
+	}
+
+	// Swap the last cube into the gap so the arrays stay packed
+	Cubes.RemoveAtSwap(Index, 1, false);
+	SimParams.RemoveAtSwap(Index, 1, false);
+
+	if (Cubes.IsValidIndex(Index))
+	{
+		Cubes[Index]->CubeIndex = Index;
+	}
+
+	if (CubesById.FindRef(Cube->CubeId) == Cube)
+	{
+		CubesById.Remove(Cube->CubeId);
+	}
+
+	if (Cube->Role == ROLE_Authority)
+	{
+		RelevancyGrid.Remove(Cube->CubeId);
+	}
+
+	PendingCorrections.RemoveAll([Cube](const FPendingCorrection& Correction) { return Correction.Cube == Cube; });
+
+	Cube->CubeIndex = INDEX_NONE;
+}
+
+ANTPawn* ANTCubeManager::FindCube(int32 CubeId) const
+{
+	return CubesById.FindRef(CubeId);
+}
+
+void ANTCubeManager::UpdateCubeId(ANTPawn* Cube)
+{
+	for (auto It = CubesById.CreateIterator(); It; ++It)
+	{
+		if (It.Value() == Cube)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	if (Cube->CubeId != INDEX_NONE && Cube->CubeIndex != INDEX_NONE)
+	{
+		CubesById.Add(Cube->CubeId, Cube);
+	}
+}
+
+void ANTCubeManager::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	// Corrections that arrived since last frame. Done before stepping, same as replaying them straight from the OnRep.
+	ProcessCorrections();
+
+	for (ANTPawn* Cube : Cubes)
+	{
+		Cube->PreviousPhysState = Cube->CurrentPhysState;
+	}
+
+	// Same accumulator as ANTPawn::Tick, shared by every cube so they step together
+	int32 NumSteps = 0;
+
+	TickAccumulator += DeltaSeconds * SimulationTimeScale;
+	while (TickAccumulator >= StepTime && NumSteps < MaxCatchUpSteps)
+	{
+		StepCubes(StepTime);
+		TickAccumulator -= StepTime;
+		NumSteps++;
+	}
+
+	if (TickAccumulator >= StepTime)
+	{
+		TickAccumulator = FMath::Fmod(TickAccumulator, StepTime);
+	}
+
+	for (ANTPawn* Cube : Cubes)
+	{
+		Cube->PostSimulate(DeltaSeconds);
+	}
+}
+
+void ANTCubeManager::StepCubes(float StepDeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_NTStepCubes);
+
+	const int32 NumCubes = Cubes.Num();
+	ServerTick++;
+
+	// Gather - Advance each cube and pack its state and input. Resting cubes and cubes holding for their Client's input drop
+	// out here.
+	SteppedCubes.Reset();
+	SteppedIndices.Reset();
+	int32 NumHolding = 0;
+
+	for (int32 i = 0; i < NumCubes; i++)
+	{
+		ANTPawn* Cube = Cubes[i];
+		Cube->BeginStep();
+
+		if (Cube->IsHoldingForInput())
+		{
+			NumHolding++;
+			continue;
+		}
+
+		if (Cube->IsAtRest())
+		{
+			continue;
+		}
+
+		SteppedCubes.Add(Cube);
+		SteppedIndices.Add(i);
+	}
+
+	const int32 NumStepped = SteppedCubes.Num();
+	SET_DWORD_STAT(STAT_NTCubesAtRest, NumCubes - NumStepped - NumHolding);
+	SET_DWORD_STAT(STAT_NTCubesHoldingForInput, NumHolding);
+
+	Batch.SetNum(NumStepped);
+	for (int32 Slot = 0; Slot < NumStepped; Slot++)
+	{
+		const ANTPawn* Cube = SteppedCubes[Slot];
+		const FCubeSimParams& Params = SimParams[SteppedIndices[Slot]];
+
+		Batch.SetState(Slot, Cube->CurrentPhysState);
+		Batch.SetParams(Slot, Params);
+		Batch.SetAccel(Slot, InputAccelTable[Cube->InputStates.ToBits()] * Params.ForceStrength);
+	}
+
+	// Integrate - Every stepped cube at once, four to a SIMD register
+	FCubeIntegrator::StepBatch(Batch, StepDeltaTime);
+
+	// Write Back - One pass to move each body and finish its step
+	for (int32 Slot = 0; Slot < NumStepped; Slot++)
+	{
+		ANTPawn* Cube = SteppedCubes[Slot];
+
+		Cube->Accel = Batch.GetAccel(Slot);
+		Cube->Alpha = FVector::ZeroVector;
+		Cube->MoveBody(Batch.GetState(Slot));
+
+		if (bUseRelevancyGrid && Cube->Role == ROLE_Authority)
+		{
+			RelevancyGrid.Move(Cube->CubeId, Cube->CurrentPhysState.Position);
+		}
+
+		Cube->EndStep(StepDeltaTime);
+	}
+}
+
+void ANTCubeManager::QueueCorrection(ANTPawn* Cube, const FCubeMove& Move)
+{
+	// Only the newest correction matters - it discards everything an older one would have replayed
+	for (FPendingCorrection& Correction : PendingCorrections)
+	{
+		if (Correction.Cube == Cube)
+		{
+			Correction.Move = Move;
+			return;
+		}
+	}
+
+	FPendingCorrection& Correction = PendingCorrections[PendingCorrections.AddDefaulted()];
+	Correction.Cube = Cube;
+	Correction.Move = Move;
+}
+
+void ANTCubeManager::CancelCorrection(ANTPawn* Cube)
+{
+	PendingCorrections.RemoveAll([Cube](const FPendingCorrection& Correction) { return Correction.Cube == Cube; });
+}
+
+void ANTCubeManager::ProcessCorrections()
+{
+	const int32 NumCorrections = PendingCorrections.Num();
+	if (NumCorrections == 0)
+	{
+		return;
+	}
+
+	// Game Thread - Discard old moves and read everything the replay needs from the bodies
+	for (FPendingCorrection& Correction : PendingCorrections)
+	{
+		ANTPawn* Cube = Correction.Cube;
+		Correction.bNeedsReplay = Cube->PrepareCorrection(Correction.Move);
+		Correction.Params = SimParams[Cube->CubeIndex];
+		Correction.OriginalState = Cube->CurrentPhysState;
+		Correction.ReplayCycles = 0;
+		Cube->bReplayingMoves = Correction.bNeedsReplay;
+	}
+
+	// Replay - Each correction only touches its own cube's history, so they're independent
+	auto ReplayCorrection = [this](int32 Index)
+	{
+		FPendingCorrection& Correction = PendingCorrections[Index];
+		if (Correction.bNeedsReplay)
+		{
+			const uint32 StartCycles = FPlatformTime::Cycles();
+			Correction.Result = Correction.Cube->ReplayHistory(Correction.Move.CubeState, Correction.Params);
+			Correction.ReplayCycles = FPlatformTime::Cycles() - StartCycles;
+		}
+	};
+
+	const uint32 WallStartCycles = FPlatformTime::Cycles();
+	{
+		SCOPE_CYCLE_COUNTER(STAT_NTCorrectionReplayWall);
+
+		const bool bParallel = NumCorrections >= CVarParallelCorrectionThreshold.GetValueOnGameThread();
+		ParallelFor(NumCorrections, ReplayCorrection, !bParallel);
+	}
+	const uint32 WallCycles = FPlatformTime::Cycles() - WallStartCycles;
+
+	// Game Thread - Write the results back to the bodies
+	uint32 TotalReplayCycles = 0;
+	uint32 NumReplayed = 0;
+	for (FPendingCorrection& Correction : PendingCorrections)
+	{
+		ANTPawn* Cube = Correction.Cube;
+		if (Correction.bNeedsReplay)
+		{
+			Cube->Snap(Correction.Result);
+			Cube->bReplayingMoves = false;
+			TotalReplayCycles += Correction.ReplayCycles;
+			NumReplayed++;
+
+			Cube->BeginSmoothing(Correction.OriginalState);
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_NTCorrectionsReplayed, NumReplayed);
+
+	// Time the replays would have taken back to back, over the time they actually took
+	SET_FLOAT_STAT(STAT_NTCorrectionReplaySpeedup, WallCycles > 0 ? (float)TotalReplayCycles / WallCycles : 1.f);
+
+	PendingCorrections.Reset();
+}
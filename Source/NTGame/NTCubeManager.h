@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "GameFramework/Actor.h"
+#include "NTCubeIntegrator.h"
+#include "NTSpatialGrid.h"
+#include "NTCubeManager.generated.h"
+
+/**
+ * Steps every registered cube in the world together, so a thousand cubes cost one actor tick instead of a thousand.
+ * Each step packs every moving cube's state into an FCubeStateBatch, integrates them all there four at a time, and writes
+ * the results back to the bodies in a single pass.
+ * One is spawned per world on demand - it isn't replicated, Client and Server each run their own.
+ */
+UCLASS(NotPlaceable, Transient)
+class NTGAME_API ANTCubeManager : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ANTCubeManager(const FObjectInitializer& ObjectInitializer);
+	virtual void Tick(float DeltaSeconds) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/* Finds the manager for this world, spawning one if there isn't one yet. Every cube asks on BeginPlay, so it's a map lookup rather than an actor search. */
+	static ANTCubeManager* Get(UWorld* World);
+
+	void RegisterCube(ANTPawn* Cube);
+	void UnregisterCube(ANTPawn* Cube);
+
+	int32 GetNumCubes() const { return Cubes.Num(); }
+	const TArray<ANTPawn*>& GetCubes() const { return Cubes; }
+
+	/* Number of fixed steps taken. Snapshots are stamped with this. */
+	int32 GetServerTick() const { return ServerTick; }
+
+	/* Looks a cube up by its replicated CubeId, or null */
+	ANTPawn* FindCube(int32 CubeId) const;
+
+	/* Client - Called when a cube's CubeId arrives after it registered */
+	void UpdateCubeId(ANTPawn* Cube);
+
+	/* Holds a correction until the next tick, when all of the frame's corrections are replayed together. Replaces any older one for the same cube. */
+	void QueueCorrection(ANTPawn* Cube, const FCubeMove& Move);
+
+	/* Drops a cube's queued correction, once a newer ack has made it pointless */
+	void CancelCorrection(ANTPawn* Cube);
+
+	/* Server - Where every cube we have authority over is, by CubeId. Null if bUseRelevancyGrid is off. */
+	const FNTSpatialGrid* GetRelevancyGrid() const { return bUseRelevancyGrid ? &RelevancyGrid : nullptr; }
+
+	/* Client - Rate the shared simulation runs at. The local player's time dilation sets this. */
+	float SimulationTimeScale;
+
+private:
+	struct FPendingCorrection
+	{
+		ANTPawn* Cube;
+		FCubeMove Move;
+		FCubeSimParams Params;
+		FCubeState OriginalState;
+		FCubeState Result;
+		bool bNeedsReplay;
+		uint32 ReplayCycles;
+	};
+
+	/* Replays every queued correction, across worker threads when there are enough of them */
+	void ProcessCorrections();
+
+	TArray<FPendingCorrection> PendingCorrections;
+
+	/* Runs one fixed step for every cube that isn't resting */
+	void StepCubes(float StepDeltaTime);
+
+	/* Cubes being stepped this tick, and where each is in Cubes. Batch is packed in this order while stepping. */
+	TArray<ANTPawn*> SteppedCubes;
+	TArray<int32> SteppedIndices;
+
+	UPROPERTY()
+	TArray<ANTPawn*> Cubes;
+
+	TMap<int32, ANTPawn*> CubesById;
+
+	/* Kept up to date as cubes step. Resting cubes don't move, so they cost nothing. */
+	FNTSpatialGrid RelevancyGrid;
+	bool bUseRelevancyGrid;
+
+	/* Server - Next CubeId to hand out */
+	int32 NextCubeId;
+	int32 ServerTick;
+
+	/* Parallel to Cubes. Read from each body once when it registers, rather than from its FBodyInstance every step. */
+	TArray<FCubeSimParams> SimParams;
+
+	/* The stepped cubes' states while they integrate, parallel to SteppedCubes */
+	FCubeStateBatch Batch;
+
+	/* Unit acceleration for each of the 16 input combinations, see FCubeInput::ToBits() */
+	FVector InputAccelTable[16];
+
+	/* Fixed step length and catch-up limit, taken from the first cube registered. All cubes must agree. */
+	float StepTime;
+	int32 MaxCatchUpSteps;
+	float TickAccumulator;
+};
@@ -3,3 +3,11 @@
 #include "NTGame.h"
 
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, NTGame, "NTGame" );
+
+#if !UE_BUILD_SHIPPING
+TAutoConsoleVariable<int32> CVarNTDebugText(
+	TEXT("nt.DebugText"),
+	0,
+	TEXT("Shows on-screen debug text for pings, corrections and smoothing. Not available in shipping builds."),
+	ECVF_Default);
+#endif
@@ -3,4 +3,23 @@
 #pragma once
 
 #include "Engine.h"
-#include "UnrealNetwork.h"
\ No newline at end of file
+#include "UnrealNetwork.h"
+
+DECLARE_STATS_GROUP(TEXT("NTNet"), STATGROUP_NTNet, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("NTPrediction"), STATGROUP_NTPrediction, STATCAT_Advanced);
+
+#if !UE_BUILD_SHIPPING
+/* nt.DebugText - Gates the on-screen debug strings. The message and its arguments aren't evaluated when it's off. */
+extern TAutoConsoleVariable<int32> CVarNTDebugText;
+
+#define NT_DEBUG_MESSAGE(Duration, Color, Format, ...) \
+	do \
+	{ \
+		if (CVarNTDebugText.GetValueOnGameThread() != 0 && GEngine) \
+		{ \
+			GEngine->AddOnScreenDebugMessage(-1, Duration, Color, FString::Printf(Format, ##__VA_ARGS__)); \
+		} \
+	} while (0)
+#else
+#define NT_DEBUG_MESSAGE(Duration, Color, Format, ...) do {} while (0)
+#endif
@@ -0,0 +1,161 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NTGame.h"
+#include "NTInputBuffer.h"
+
+FNTInputJitterBuffer::FNTInputJitterBuffer()
+{
+	Reset(1.f / 60.0f);
+}
+
+void FNTInputJitterBuffer::Reset(float InStepTime)
+{
+	const UNTNetSettings* Settings = GetDefault<UNTNetSettings>();
+	StepTime = FMath::Max(InStepTime, KINDA_SMALL_NUMBER);
+	MinDepth = FMath::Max(Settings->MinInputBufferDepth, 1);
+	MaxDepth = FMath::Clamp(Settings->MaxInputBufferDepth, MinDepth, (int32)Capacity / 2);
+	JitterMultiplier = Settings->InputJitterMultiplier;
+	MissingInputPolicy = Settings->MissingInputPolicy;
+
+	for (int32 i = 0; i < Capacity; i++)
+	{
+		Ticks[i] = INDEX_NONE;
+	}
+
+	FirstTick = INDEX_NONE;
+	NextTick = INDEX_NONE;
+	NewestTick = INDEX_NONE;
+	bBuffering = true;
+	TargetDepth = MinDepth;
+	LastInput = 0;
+
+	Jitter = 0.f;
+	LastArrivalTime = 0.0;
+	LastArrivalTick = INDEX_NONE;
+
+	NumUnderruns = 0;
+	NumLateDrops = 0;
+	NumSkipped = 0;
+}
+
+void FNTInputJitterBuffer::OnBatchReceived(int32 InNewestTick, double ArrivalTime)
+{
+	if (LastArrivalTick != INDEX_NONE && InNewestTick > LastArrivalTick)
+	{
+		// Compare how far apart the batches arrived with how far apart they were sent
+		const double Expected = (InNewestTick - LastArrivalTick) * StepTime;
+		const double Actual = ArrivalTime - LastArrivalTime;
+		const float Deviation = (float)FMath::Abs(Actual - Expected);
+
+		Jitter += (Deviation - Jitter) / 16.0f;
+		UpdateTargetDepth();
+	}
+
+	if (LastArrivalTick == INDEX_NONE || InNewestTick > LastArrivalTick)
+	{
+		LastArrivalTick = InNewestTick;
+		LastArrivalTime = ArrivalTime;
+	}
+}
+
+void FNTInputJitterBuffer::UpdateTargetDepth()
+{
+	const int32 JitterSteps = FMath::CeilToInt(JitterMultiplier * Jitter / StepTime);
+	TargetDepth = FMath::Clamp(MinDepth + JitterSteps, MinDepth, MaxDepth);
+}
+
+bool FNTInputJitterBuffer::Insert(int32 Tick, uint8 InputBits)
+{
+	const int32 Index = Tick & (Capacity - 1);
+	if (Ticks[Index] == Tick)
+	{
+		// Redundant copy from an overlapping batch
+		return false;
+	}
+
+	if (NextTick != INDEX_NONE && (Tick < NextTick || Tick - NextTick >= Capacity))
+	{
+		NumLateDrops++;
+		return false;
+	}
+
+	Ticks[Index] = Tick;
+	Inputs[Index] = InputBits;
+	FirstTick = (FirstTick == INDEX_NONE) ? Tick : FMath::Min(FirstTick, Tick);
+	NewestTick = (NewestTick == INDEX_NONE) ? Tick : FMath::Max(NewestTick, Tick);
+	return true;
+}
+
+int32 FNTInputJitterBuffer::GetDepth() const
+{
+	if (NewestTick == INDEX_NONE)
+	{
+		return 0;
+	}
+
+	const int32 PlayTick = (NextTick == INDEX_NONE) ? FirstTick : NextTick;
+	return FMath::Max(NewestTick - PlayTick + 1, 0);
+}
+
+uint8 FNTInputJitterBuffer::Consume(int32& OutTick)
+{
+	const uint8 MissingInput = MissingInputPolicy == ENTMissingInputPolicy::RepeatLast ? LastInput : 0;
+
+	if (NewestTick == INDEX_NONE)
+	{
+		OutTick = INDEX_NONE;
+		return MissingInput;
+	}
+
+	if (NextTick == INDEX_NONE)
+	{
+		NextTick = FirstTick;
+	}
+
+	const int32 Depth = GetDepth();
+
+	// Wait until we've got enough buffered to ride out the jitter before we start (or restart) playing
+	if (bBuffering)
+	{
+		if (Depth < TargetDepth)
+		{
+			OutTick = INDEX_NONE;
+			return MissingInput;
+		}
+
+		bBuffering = false;
+	}
+
+	// Ran dry - hold position and rebuffer, rather than running ahead of the Client
+	if (Depth <= 0)
+	{
+		NumUnderruns++;
+		bBuffering = true;
+		OutTick = INDEX_NONE;
+		return MissingInput;
+	}
+
+	// Too much buffered is just added latency. Skip forward to the target.
+	if (Depth > TargetDepth * 2)
+	{
+		const int32 NewNextTick = NewestTick - TargetDepth + 1;
+		NumSkipped += NewNextTick - NextTick;
+		NextTick = NewNextTick;
+	}
+
+	const int32 Index = NextTick & (Capacity - 1);
+	if (Ticks[Index] == NextTick)
+	{
+		LastInput = Inputs[Index];
+	}
+	else
+	{
+		// A hole that redundancy didn't cover
+		NumUnderruns++;
+		LastInput = MissingInput;
+	}
+
+	OutTick = NextTick;
+	NextTick++;
+	return LastInput;
+}
@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "NTNetSettings.h"
+
+/**
+ * Server-side jitter buffer for a single Client's inputs, keyed by Client tick.
+ * Inputs are played out one per Server tick, after a delay that adapts to how much jitter we're seeing on the connection.
+ * Inputs are stored as bits, see FCubeInput::ToBits().
+ */
+struct NTGAME_API FNTInputJitterBuffer
+{
+	enum { Capacity = 256 };
+
+	FNTInputJitterBuffer();
+
+	/* Resets the buffer and picks up the current settings */
+	void Reset(float InStepTime);
+
+	/* Called once per received batch, with the newest tick it contained. Drives the jitter estimate. */
+	void OnBatchReceived(int32 NewestTick, double ArrivalTime);
+
+	/* Adds a single input. Returns false if it was a duplicate, or arrived too late to be played */
+	bool Insert(int32 Tick, uint8 InputBits);
+
+	/**
+	 * Gets the input for this Server tick. OutTick is the Client tick it belongs to, or INDEX_NONE while buffering or run dry,
+	 * when the input is only a stand-in for one the Client hasn't sent yet.
+	 */
+	uint8 Consume(int32& OutTick);
+
+	/* Number of inputs buffered ahead of playout */
+	int32 GetDepth() const;
+	int32 GetTargetDepth() const { return TargetDepth; }
+	float GetJitterMs() const { return Jitter * 1000.0f; }
+
+	/* Stats, cleared on Reset */
+	uint32 NumUnderruns;
+	uint32 NumLateDrops;
+	uint32 NumSkipped;
+
+private:
+	uint8 Inputs[Capacity];
+	int32 Ticks[Capacity];
+
+	/* Next Client tick to play. INDEX_NONE until we've started playing. */
+	int32 NextTick;
+	int32 FirstTick;
+	int32 NewestTick;
+
+	/* True while we're waiting for the buffer to fill to TargetDepth */
+	bool bBuffering;
+	int32 TargetDepth;
+
+	uint8 LastInput;
+
+	/* Inter-arrival jitter in seconds, smoothed the same way as RFC 3550 */
+	float Jitter;
+	double LastArrivalTime;
+	int32 LastArrivalTick;
+
+	float StepTime;
+	int32 MinDepth;
+	int32 MaxDepth;
+	float JitterMultiplier;
+	ENTMissingInputPolicy MissingInputPolicy;
+
+	void UpdateTargetDepth();
+};
@@ -0,0 +1,252 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NTGame.h"
+#include "NTPawn.h"
+#include "NTBinarySearch.h"
+#include "NTMoveHistory.h"
+
+FNTMoveHistory::FNTMoveHistory()
+	: Head(0)
+	, Tail(0)
+	, IndexMask(0)
+{
+	Resize(1);
+}
+
+void FNTMoveHistory::Resize(uint32 MinCapacity)
+{
+	const int32 NewCapacity = (int32)FMath::RoundUpToPowerOfTwo(FMath::Max(MinCapacity, 1u));
+
+	TimeStamps.SetNumZeroed(NewCapacity);
+	Ticks.SetNumZeroed(NewCapacity);
+	InputBits.SetNumZeroed(NewCapacity);
+	DeltaTimes.SetNumZeroed(NewCapacity);
+	StateHashes.SetNumZeroed(NewCapacity);
+
+	PositionX.SetNumZeroed(NewCapacity);
+	PositionY.SetNumZeroed(NewCapacity);
+	PositionZ.SetNumZeroed(NewCapacity);
+
+	RotationX.SetNumZeroed(NewCapacity);
+	RotationY.SetNumZeroed(NewCapacity);
+	RotationZ.SetNumZeroed(NewCapacity);
+	RotationW.SetNumZeroed(NewCapacity);
+
+	VelocityX.SetNumZeroed(NewCapacity);
+	VelocityY.SetNumZeroed(NewCapacity);
+	VelocityZ.SetNumZeroed(NewCapacity);
+
+	AngularVelocityX.SetNumZeroed(NewCapacity);
+	AngularVelocityY.SetNumZeroed(NewCapacity);
+	AngularVelocityZ.SetNumZeroed(NewCapacity);
+
+	IndexMask = NewCapacity - 1;
+	Reset();
+}
+
+void FNTMoveHistory::Reset()
+{
+	Head = 0;
+	Tail = 0;
+}
+
+void FNTMoveHistory::Add(const FCubeMove& Move)
+{
+	if (IsFull())
+	{
+		Tail++;
+	}
+
+	const uint32 Slot = Head & IndexMask;
+	Head++;
+
+	TimeStamps[Slot] = Move.TimeStamp;
+	Ticks[Slot] = Move.TickNumber;
+	InputBits[Slot] = Move.CubeInput.ToBits();
+	DeltaTimes[Slot] = Move.DeltaTime;
+	StateHashes[Slot] = Move.RandHash;
+
+	SetState(GetNewestIndex(), Move.CubeState);
+}
+
+void FNTMoveHistory::Remove()
+{
+	ensure(!IsEmpty());
+	RemoveOldest(1);
+}
+
+void FNTMoveHistory::RemoveOldest(uint32 Count)
+{
+	Tail += FMath::Min(Count, Num());
+}
+
+FCubeMove FNTMoveHistory::GetMove(uint32 Index) const
+{
+	const uint32 Slot = ToSlot(Index);
+
+	FCubeMove Move;
+	Move.TimeStamp = TimeStamps[Slot];
+	Move.TickNumber = Ticks[Slot];
+	Move.DeltaTime = DeltaTimes[Slot];
+	Move.RandHash = StateHashes[Slot];
+	Move.CubeInput.FromBits(InputBits[Slot]);
+	Move.CubeState = GetState(Index);
+	return Move;
+}
+
+FCubeState FNTMoveHistory::GetState(uint32 Index) const
+{
+	const uint32 Slot = ToSlot(Index);
+
+	FCubeState State;
+	State.Position = FVector(PositionX[Slot], PositionY[Slot], PositionZ[Slot]);
+	State.Rotation = FQuat(RotationX[Slot], RotationY[Slot], RotationZ[Slot], RotationW[Slot]);
+	State.Velocity = FVector(VelocityX[Slot], VelocityY[Slot], VelocityZ[Slot]);
+	State.AngularVelocity = FVector(AngularVelocityX[Slot], AngularVelocityY[Slot], AngularVelocityZ[Slot]);
+	return State;
+}
+
+FCubeInput FNTMoveHistory::GetInput(uint32 Index) const
+{
+	FCubeInput Input;
+	Input.FromBits(GetInputBits(Index));
+	return Input;
+}
+
+void FNTMoveHistory::SetState(uint32 Index, const FCubeState& State)
+{
+	const uint32 Slot = ToSlot(Index);
+
+	PositionX[Slot] = State.Position.X;
+	PositionY[Slot] = State.Position.Y;
+	PositionZ[Slot] = State.Position.Z;
+
+	RotationX[Slot] = State.Rotation.X;
+	RotationY[Slot] = State.Rotation.Y;
+	RotationZ[Slot] = State.Rotation.Z;
+	RotationW[Slot] = State.Rotation.W;
+
+	VelocityX[Slot] = State.Velocity.X;
+	VelocityY[Slot] = State.Velocity.Y;
+	VelocityZ[Slot] = State.Velocity.Z;
+
+	AngularVelocityX[Slot] = State.AngularVelocity.X;
+	AngularVelocityY[Slot] = State.AngularVelocity.Y;
+	AngularVelocityZ[Slot] = State.AngularVelocity.Z;
+}
+
+FVector FNTMoveHistory::GetPosition(uint32 Index) const
+{
+	const uint32 Slot = ToSlot(Index);
+	return FVector(PositionX[Slot], PositionY[Slot], PositionZ[Slot]);
+}
+
+FQuat FNTMoveHistory::GetRotation(uint32 Index) const
+{
+	const uint32 Slot = ToSlot(Index);
+	return FQuat(RotationX[Slot], RotationY[Slot], RotationZ[Slot], RotationW[Slot]);
+}
+
+uint32 FNTMoveHistory::LowerBoundTick(int32 Key) const
+{
+	return LowerBound(Ticks, Key);
+}
+
+uint32 FNTMoveHistory::LowerBoundTimeStamp(int32 Key) const
+{
+	return LowerBound(TimeStamps, Key);
+}
+
+uint32 FNTMoveHistory::LowerBound(const TArray<int32>& Keys, int32 Key) const
+{
+	return FNTBinarySearch::LowerBound(Num(), [this, &Keys, Key](uint32 Index) { return Keys[ToSlot(Index)] < Key; });
+}
+
+int32 FNTMoveHistory::FindFirstDivergent(const FCubeState& State, uint32 First, uint32 Count) const
+{
+	if (First >= Num())
+	{
+		return INDEX_NONE;
+	}
+
+	Count = FMath::Min(Count, Num() - First);
+
+	// The span can wrap round the end of the arrays, in which case it's checked as two runs
+	const uint32 FirstSlot = ToSlot(First);
+	const uint32 FirstRun = FMath::Min(Count, Capacity() - FirstSlot);
+
+	int32 Offset = FindFirstDivergentInSlots(State, FirstSlot, FirstRun);
+	if (Offset != INDEX_NONE)
+	{
+		return First + Offset;
+	}
+
+	if (FirstRun < Count)
+	{
+		Offset = FindFirstDivergentInSlots(State, 0, Count - FirstRun);
+		if (Offset != INDEX_NONE)
+		{
+			return First + FirstRun + Offset;
+		}
+	}
+
+	return INDEX_NONE;
+}
+
+int32 FNTMoveHistory::FindFirstDivergentInSlots(const FCubeState& State, uint32 FirstSlot, uint32 Count) const
+{
+	// Same thresholds as FCubeState::Compare
+	const float Threshold = FMath::Square(0.1f);
+	const float LocationThreshold = Threshold * Threshold;
+
+	const VectorRegister LocationLimit = VectorSetFloat1(LocationThreshold);
+	const VectorRegister RotationLimit = VectorSetFloat1(Threshold);
+
+	const VectorRegister PX = VectorSetFloat1(State.Position.X);
+	const VectorRegister PY = VectorSetFloat1(State.Position.Y);
+	const VectorRegister PZ = VectorSetFloat1(State.Position.Z);
+	const VectorRegister QX = VectorSetFloat1(State.Rotation.X);
+	const VectorRegister QY = VectorSetFloat1(State.Rotation.Y);
+	const VectorRegister QZ = VectorSetFloat1(State.Rotation.Z);
+	const VectorRegister QW = VectorSetFloat1(State.Rotation.W);
+
+	uint32 i = 0;
+	for (; i + 4 <= Count; i += 4)
+	{
+		const uint32 Slot = FirstSlot + i;
+
+		const VectorRegister DX = VectorSubtract(VectorLoad(&PositionX[Slot]), PX);
+		const VectorRegister DY = VectorSubtract(VectorLoad(&PositionY[Slot]), PY);
+		const VectorRegister DZ = VectorSubtract(VectorLoad(&PositionZ[Slot]), PZ);
+		const VectorRegister LocSize = VectorMultiplyAdd(DZ, DZ, VectorMultiplyAdd(DY, DY, VectorMultiply(DX, DX)));
+
+		const VectorRegister RX = VectorSubtract(VectorLoad(&RotationX[Slot]), QX);
+		const VectorRegister RY = VectorSubtract(VectorLoad(&RotationY[Slot]), QY);
+		const VectorRegister RZ = VectorSubtract(VectorLoad(&RotationZ[Slot]), QZ);
+		const VectorRegister RW = VectorSubtract(VectorLoad(&RotationW[Slot]), QW);
+		const VectorRegister RotNorm = VectorMultiplyAdd(RW, RW, VectorMultiplyAdd(RZ, RZ, VectorMultiplyAdd(RY, RY, VectorMultiply(RX, RX))));
+
+		const VectorRegister Divergent = VectorBitwiseOr(VectorCompareGT(LocSize, LocationLimit), VectorCompareGT(RotNorm, RotationLimit));
+		const int32 Mask = VectorMaskBits(Divergent);
+		if (Mask != 0)
+		{
+			return i + FMath::CountTrailingZeros(Mask);
+		}
+	}
+
+	for (; i < Count; i++)
+	{
+		const uint32 Slot = FirstSlot + i;
+
+		const float LocSize = FMath::Square(PositionX[Slot] - State.Position.X) + FMath::Square(PositionY[Slot] - State.Position.Y) + FMath::Square(PositionZ[Slot] - State.Position.Z);
+		const float RotNorm = FMath::Square(RotationX[Slot] - State.Rotation.X) + FMath::Square(RotationY[Slot] - State.Rotation.Y)
+			+ FMath::Square(RotationZ[Slot] - State.Rotation.Z) + FMath::Square(RotationW[Slot] - State.Rotation.W);
+
+		if (LocSize > LocationThreshold || RotNorm > Threshold)
+		{
+			return i;
+		}
+	}
+
+	return INDEX_NONE;
+}
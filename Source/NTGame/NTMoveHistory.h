@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+struct FCubeMove;
+struct FCubeState;
+struct FCubeInput;
+
+/**
+ * Local move history, stored as a structure of arrays. Scanning ticks or comparing positions only touches the columns
+ * it needs, rather than pulling whole FCubeMove records through the cache.
+ *
+ * Same ring layout as TNTRingBuffer - power of two capacity, free-running Head and Tail, logical indices from the oldest.
+ */
+struct NTGAME_API FNTMoveHistory
+{
+	FNTMoveHistory();
+
+	// Sets the capacity, rounded up to a power of two, and empties the history
+	void Resize(uint32 MinCapacity);
+	void Reset();
+
+	uint32 Num() const { return Head - Tail; }
+	uint32 Capacity() const { return IndexMask + 1; }
+	bool IsEmpty() const { return Head == Tail; }
+	bool IsFull() const { return Num() == Capacity(); }
+
+	// Adds to the newest end. If full, the oldest move is dropped.
+	void Add(const FCubeMove& Move);
+
+	void Remove();
+	void RemoveOldest(uint32 Count);
+
+	// Reassembles a full move. Prefer the column accessors in hot loops.
+	FCubeMove GetMove(uint32 Index) const;
+	FCubeState GetState(uint32 Index) const;
+	FCubeInput GetInput(uint32 Index) const;
+	void SetState(uint32 Index, const FCubeState& State);
+
+	int32 GetTick(uint32 Index) const { return Ticks[ToSlot(Index)]; }
+	int32 GetTimeStamp(uint32 Index) const { return TimeStamps[ToSlot(Index)]; }
+	uint8 GetInputBits(uint32 Index) const { return InputBits[ToSlot(Index)]; }
+	float GetDeltaTime(uint32 Index) const { return DeltaTimes[ToSlot(Index)]; }
+	int32 GetStateHash(uint32 Index) const { return StateHashes[ToSlot(Index)]; }
+	void SetStateHash(uint32 Index, int32 Hash) { StateHashes[ToSlot(Index)] = Hash; }
+	FVector GetPosition(uint32 Index) const;
+	FQuat GetRotation(uint32 Index) const;
+
+	uint32 GetNewestIndex() const { return Num() - 1; }
+
+	// Binary search for the first move whose tick / timestamp is not less than Key. Returns Num() if there isn't one.
+	uint32 LowerBoundTick(int32 Key) const;
+	uint32 LowerBoundTimeStamp(int32 Key) const;
+
+	/**
+	 * Checks State against the moves [First, First + Count) with the same thresholds as FCubeState::Compare, four moves at a time.
+	 * Returns the index of the first move that differs significantly, or INDEX_NONE.
+	 */
+	int32 FindFirstDivergent(const FCubeState& State, uint32 First, uint32 Count) const;
+
+private:
+	uint32 ToSlot(uint32 Index) const
+	{
+		checkSlow(Index < Num());
+		return (Tail + Index) & IndexMask;
+	}
+
+	uint32 LowerBound(const TArray<int32>& Keys, int32 Key) const;
+
+	// Compares a run of slots that doesn't wrap. Returns the offset of the first divergent slot, or INDEX_NONE.
+	int32 FindFirstDivergentInSlots(const FCubeState& State, uint32 FirstSlot, uint32 Count) const;
+
+	TArray<int32> TimeStamps;
+	TArray<int32> Ticks;
+	TArray<uint8> InputBits;
+	TArray<float> DeltaTimes;
+	TArray<int32> StateHashes;
+
+	TArray<float> PositionX;
+	TArray<float> PositionY;
+	TArray<float> PositionZ;
+
+	TArray<float> RotationX;
+	TArray<float> RotationY;
+	TArray<float> RotationZ;
+	TArray<float> RotationW;
+
+	TArray<float> VelocityX;
+	TArray<float> VelocityY;
+	TArray<float> VelocityZ;
+
+	TArray<float> AngularVelocityX;
+	TArray<float> AngularVelocityY;
+	TArray<float> AngularVelocityZ;
+
+	uint32 Head;
+	uint32 Tail;
+	uint32 IndexMask;
+};
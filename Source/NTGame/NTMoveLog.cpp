@@ -0,0 +1,388 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NTGame.h"
+#include "NTCubeIntegrator.h"
+#include "NTMoveLog.h"
+
+#if PLATFORM_LINUX || PLATFORM_MAC
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define NT_MOVELOG_MMAP 1
+#else
+#define NT_MOVELOG_MMAP 0
+#endif
+
+DEFINE_LOG_CATEGORY_STATIC(LogNTMoveLog, Log, All);
+
+namespace
+{
+	// Payload sizes, not counting the type byte
+	const int32 StateBytes = 13 * sizeof(float);
+	const int32 StateRecordBytes = sizeof(int32) + sizeof(uint8) + sizeof(float) + StateBytes;
+	const int32 CorrectionRecordBytes = sizeof(int32) + sizeof(int32) + StateBytes;
+
+	// Big enough that the file sees a handful of writes a second at most
+	const int32 WriteBufferBytes = 64 * 1024;
+
+	// Most moves a crash can lose, in seconds
+	const double FlushInterval = 1.0;
+}
+
+FNTMoveLogHeader::FNTMoveLogHeader()
+	: Role(ENTMoveLogRole::Server)
+	, TickRate(60.0f)
+	, StartTime(0)
+{
+	SetSimParams(FCubeSimParams());
+}
+
+void FNTMoveLogHeader::SetSimParams(const FCubeSimParams& Params)
+{
+	ForceStrength = Params.ForceStrength;
+	LinearDamping = Params.LinearDamping;
+	AngularDamping = Params.AngularDamping;
+	GravityZ = Params.GravityZ;
+}
+
+FCubeSimParams FNTMoveLogHeader::GetSimParams() const
+{
+	FCubeSimParams Params;
+	Params.ForceStrength = ForceStrength;
+	Params.LinearDamping = LinearDamping;
+	Params.AngularDamping = AngularDamping;
+	Params.GravityZ = GravityZ;
+	return Params;
+}
+
+FNTMoveLogRecord::FNTMoveLogRecord()
+	: Type(ENTMoveLogRecordType::State)
+	, Tick(0)
+	, ServerTick(0)
+	, InputBits(0)
+	, DeltaTime(0.f)
+	, Position(FVector::ZeroVector)
+	, Velocity(FVector::ZeroVector)
+	, AngularVelocity(FVector::ZeroVector)
+	, Rotation(FQuat::Identity)
+{}
+
+FCubeState FNTMoveLogRecord::ToState() const
+{
+	FCubeState State;
+	State.Position = Position;
+	State.Velocity = Velocity;
+	State.AngularVelocity = AngularVelocity;
+	State.Rotation = Rotation;
+	return State;
+}
+
+///////////////////
+///// WRITING /////
+///////////////////
+
+FNTMoveLogWriter::FNTMoveLogWriter()
+	: Archive(nullptr)
+	, LastFlushTime(0.0)
+{}
+
+FNTMoveLogWriter::~FNTMoveLogWriter()
+{
+	Close();
+}
+
+bool FNTMoveLogWriter::IsEnabled()
+{
+	return FParse::Param(FCommandLine::Get(), TEXT("NTMoveLog"));
+}
+
+FString FNTMoveLogWriter::MakePath(const FString& Name)
+{
+	FString Directory = FPaths::GameSavedDir() / TEXT("MoveLogs");
+	FParse::Value(FCommandLine::Get(), TEXT("NTMoveLogDir="), Directory);
+
+	return Directory / FString::Printf(TEXT("%s_%u_%s.ntlog"), *Name, FPlatformProcess::GetCurrentProcessId(), *FDateTime::Now().ToString());
+}
+
+bool FNTMoveLogWriter::Open(const FString& Path, const FNTMoveLogHeader& Header)
+{
+	Close();
+
+	Archive = IFileManager::Get().CreateFileWriter(*Path, FILEWRITE_AllowRead);
+	if (!Archive)
+	{
+		UE_LOG(LogNTMoveLog, Error, TEXT("Couldn't open %s for writing"), *Path);
+		return false;
+	}
+
+	Buffer.Reset(WriteBufferBytes);
+
+	Put<uint32>(FNTMoveLogHeader::Magic);
+	Put<uint16>(FNTMoveLogHeader::Version);
+	Put<uint8>((uint8)Header.Role);
+	Put<uint8>(0);
+	Put<float>(Header.TickRate);
+	Put<float>(Header.ForceStrength);
+	Put<float>(Header.LinearDamping);
+	Put<float>(Header.AngularDamping);
+	Put<float>(Header.GravityZ);
+	Put<int64>(Header.StartTime);
+	check(Buffer.Num() == FNTMoveLogHeader::Size);
+
+	// A log that dies before its first flush should still be readable
+	Flush();
+
+	UE_LOG(LogNTMoveLog, Log, TEXT("Recording moves to %s"), *Path);
+	return true;
+}
+
+void FNTMoveLogWriter::Close()
+{
+	if (Archive)
+	{
+		Flush();
+		Archive->Close();
+		delete Archive;
+		Archive = nullptr;
+	}
+}
+
+void FNTMoveLogWriter::WriteState(int32 Tick, uint8 InputBits, float DeltaTime, const FCubeState& State)
+{
+	if (!Archive)
+	{
+		return;
+	}
+
+	Put<uint8>((uint8)ENTMoveLogRecordType::State);
+	Put<int32>(Tick);
+	Put<uint8>(InputBits);
+	Put<float>(DeltaTime);
+	PutState(State);
+	FlushIfDue();
+}
+
+void FNTMoveLogWriter::WriteCorrection(int32 Tick, int32 ServerTick, const FCubeState& State)
+{
+	if (!Archive)
+	{
+		return;
+	}
+
+	Put<uint8>((uint8)ENTMoveLogRecordType::Correction);
+	Put<int32>(Tick);
+	Put<int32>(ServerTick);
+	PutState(State);
+	FlushIfDue();
+}
+
+void FNTMoveLogWriter::PutState(const FCubeState& State)
+{
+	Put<float>(State.Position.X);
+	Put<float>(State.Position.Y);
+	Put<float>(State.Position.Z);
+	Put<float>(State.Velocity.X);
+	Put<float>(State.Velocity.Y);
+	Put<float>(State.Velocity.Z);
+	Put<float>(State.AngularVelocity.X);
+	Put<float>(State.AngularVelocity.Y);
+	Put<float>(State.AngularVelocity.Z);
+	Put<float>(State.Rotation.X);
+	Put<float>(State.Rotation.Y);
+	Put<float>(State.Rotation.Z);
+	Put<float>(State.Rotation.W);
+}
+
+void FNTMoveLogWriter::FlushIfDue()
+{
+	if (Buffer.Num() >= WriteBufferBytes || FPlatformTime::Seconds() - LastFlushTime >= FlushInterval)
+	{
+		Flush();
+	}
+}
+
+void FNTMoveLogWriter::Flush()
+{
+	if (!Archive)
+	{
+		return;
+	}
+
+	if (Buffer.Num() > 0)
+	{
+		Archive->Serialize(Buffer.GetData(), Buffer.Num());
+		Buffer.Reset(WriteBufferBytes);
+	}
+
+	// The archive buffers too - Hand it all to the OS, so it survives the process going down
+	Archive->Flush();
+	LastFlushTime = FPlatformTime::Seconds();
+}
+
+///////////////////
+///// READING /////
+///////////////////
+
+FNTMoveLogReader::FNTMoveLogReader()
+	: Data(nullptr)
+	, Size(0)
+	, Offset(0)
+	, bMapped(false)
+{}
+
+FNTMoveLogReader::~FNTMoveLogReader()
+{
+	Close();
+}
+
+bool FNTMoveLogReader::Open(const FString& Path)
+{
+	Close();
+
+#if NT_MOVELOG_MMAP
+	const FString FullPath = FPaths::ConvertRelativePathToFull(Path);
+	const int File = open(TCHAR_TO_UTF8(*FullPath), O_RDONLY);
+	if (File >= 0)
+	{
+		struct stat FileInfo;
+		if (fstat(File, &FileInfo) == 0 && FileInfo.st_size > 0)
+		{
+			void* Mapping = mmap(nullptr, FileInfo.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+			if (Mapping != MAP_FAILED)
+			{
+				// Read straight through, once
+				madvise(Mapping, FileInfo.st_size, MADV_SEQUENTIAL);
+				Data = (const uint8*)Mapping;
+				Size = FileInfo.st_size;
+				bMapped = true;
+			}
+		}
+		close(File);
+	}
+#endif
+
+	if (!bMapped)
+	{
+		if (!FFileHelper::LoadFileToArray(LoadedData, *Path))
+		{
+			UE_LOG(LogNTMoveLog, Error, TEXT("Couldn't read %s"), *Path);
+			return false;
+		}
+
+		Data = LoadedData.GetData();
+		Size = LoadedData.Num();
+	}
+
+	if (Size < FNTMoveLogHeader::Size || Get<uint32>() != FNTMoveLogHeader::Magic)
+	{
+		UE_LOG(LogNTMoveLog, Error, TEXT("%s isn't a move log"), *Path);
+		Close();
+		return false;
+	}
+
+	const uint16 Version = Get<uint16>();
+	if (Version != FNTMoveLogHeader::Version)
+	{
+		UE_LOG(LogNTMoveLog, Error, TEXT("%s is move log version %u, expected %u"), *Path, Version, (uint32)FNTMoveLogHeader::Version);
+		Close();
+		return false;
+	}
+
+	Header.Role = (ENTMoveLogRole)Get<uint8>();
+	Get<uint8>();
+	Header.TickRate = Get<float>();
+	Header.ForceStrength = Get<float>();
+	Header.LinearDamping = Get<float>();
+	Header.AngularDamping = Get<float>();
+	Header.GravityZ = Get<float>();
+	Header.StartTime = Get<int64>();
+	check(Offset == FNTMoveLogHeader::Size);
+
+	return true;
+}
+
+void FNTMoveLogReader::Close()
+{
+#if NT_MOVELOG_MMAP
+	if (bMapped)
+	{
+		munmap((void*)Data, Size);
+	}
+#endif
+
+	LoadedData.Empty();
+	Data = nullptr;
+	Size = 0;
+	Offset = 0;
+	bMapped = false;
+}
+
+bool FNTMoveLogReader::Next(FNTMoveLogRecord& OutRecord)
+{
+	if (!Data || Offset >= Size)
+	{
+		return false;
+	}
+
+	const ENTMoveLogRecordType Type = (ENTMoveLogRecordType)Data[Offset];
+	const int64 Remaining = Size - Offset - 1;
+
+	switch (Type)
+	{
+	case ENTMoveLogRecordType::State:
+		if (Remaining < StateRecordBytes)
+		{
+			return false;
+		}
+		Offset++;
+		OutRecord.Type = Type;
+		OutRecord.Tick = Get<int32>();
+		OutRecord.ServerTick = 0;
+		OutRecord.InputBits = Get<uint8>();
+		OutRecord.DeltaTime = Get<float>();
+		break;
+
+	case ENTMoveLogRecordType::Correction:
+		if (Remaining < CorrectionRecordBytes)
+		{
+			return false;
+		}
+		Offset++;
+		OutRecord.Type = Type;
+		OutRecord.Tick = Get<int32>();
+		OutRecord.ServerTick = Get<int32>();
+		OutRecord.InputBits = 0;
+		OutRecord.DeltaTime = 0.f;
+		break;
+
+	default:
+		UE_LOG(LogNTMoveLog, Warning, TEXT("Unknown record type %u at offset %lld, stopping"), (uint32)Type, Offset);
+		return false;
+	}
+
+	OutRecord.Position = GetVector();
+	OutRecord.Velocity = GetVector();
+	OutRecord.AngularVelocity = GetVector();
+	OutRecord.Rotation = GetQuat();
+	return true;
+}
+
+FVector FNTMoveLogReader::GetVector()
+{
+	FVector Value;
+	Value.X = Get<float>();
+	Value.Y = Get<float>();
+	Value.Z = Get<float>();
+	return Value;
+}
+
+FQuat FNTMoveLogReader::GetQuat()
+{
+	FQuat Value;
+	Value.X = Get<float>();
+	Value.Y = Get<float>();
+	Value.Z = Get<float>();
+	Value.W = Get<float>();
+	return Value;
+}
@@ -0,0 +1,164 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+struct FCubeState;
+struct FCubeSimParams;
+
+/**
+ * Binary move log, for looking into rubber-banding after the fact. One file per cube per process:
+ *
+ *   Header  - Magic, version, who wrote it, tick rate and the sim params needed to re-simulate offline
+ *   Records - A type byte, then a fixed size payload for that type. Little endian, no padding.
+ *
+ * State records are written every tick - predicted on the Client, authoritative on the Server.
+ * Correction records are written on the Client for every ServerMoveData that arrives.
+ *
+ * Command line:
+ *   -NTMoveLog               Record the local cube on Clients, and every player's cube on the Server
+ *   -NTMoveLogDir=<path>     Where logs go. Defaults to Saved/MoveLogs/.
+ */
+
+enum class ENTMoveLogRole : uint8
+{
+	Server,
+	Client,
+};
+
+enum class ENTMoveLogRecordType : uint8
+{
+	State = 1,
+	Correction = 2,
+};
+
+struct NTGAME_API FNTMoveLogHeader
+{
+	enum { Magic = 0x4C4D544E }; // "NTML"
+	enum { Version = 1 };
+	enum { Size = 36 };
+
+	ENTMoveLogRole Role;
+	float TickRate;
+	float ForceStrength;
+	float LinearDamping;
+	float AngularDamping;
+	float GravityZ;
+	int64 StartTime;
+
+	FNTMoveLogHeader();
+
+	void SetSimParams(const FCubeSimParams& Params);
+	FCubeSimParams GetSimParams() const;
+};
+
+/* One decoded record. Fields a type doesn't carry are left at zero. */
+struct NTGAME_API FNTMoveLogRecord
+{
+	ENTMoveLogRecordType Type;
+
+	/* Client tick - Predicted on the Client, the one being answered for Corrections, the one consumed on the Server */
+	int32 Tick;
+	/* Corrections only - Server tick it was sent on */
+	int32 ServerTick;
+	/* States only */
+	uint8 InputBits;
+	float DeltaTime;
+
+	FVector Position;
+	FVector Velocity;
+	FVector AngularVelocity;
+	FQuat Rotation;
+
+	FNTMoveLogRecord();
+
+	FCubeState ToState() const;
+};
+
+/**
+ * Append-only writer. Records are gathered in memory and handed to the file in large blocks, or once a second if that's sooner.
+ */
+struct NTGAME_API FNTMoveLogWriter
+{
+	FNTMoveLogWriter();
+	~FNTMoveLogWriter();
+
+	/* True if -NTMoveLog is on the command line */
+	static bool IsEnabled();
+
+	/* A new file in -NTMoveLogDir, named after Name, this process and the time */
+	static FString MakePath(const FString& Name);
+
+	bool Open(const FString& Path, const FNTMoveLogHeader& Header);
+	void Close();
+	bool IsOpen() const { return Archive != nullptr; }
+
+	void WriteState(int32 Tick, uint8 InputBits, float DeltaTime, const FCubeState& State);
+	void WriteCorrection(int32 Tick, int32 ServerTick, const FCubeState& State);
+
+	/* Hands everything buffered to the file. Happens at least once a second while writing, so a crash loses little. */
+	void Flush();
+
+private:
+	FNTMoveLogWriter(const FNTMoveLogWriter&);
+	FNTMoveLogWriter& operator=(const FNTMoveLogWriter&);
+
+	template<typename T>
+	void Put(const T& Value)
+	{
+		const int32 Offset = Buffer.AddUninitialized(sizeof(T));
+		FMemory::Memcpy(Buffer.GetData() + Offset, &Value, sizeof(T));
+	}
+
+	void PutState(const FCubeState& State);
+	void FlushIfDue();
+
+	FArchive* Archive;
+	TArray<uint8> Buffer;
+	double LastFlushTime;
+};
+
+/**
+ * Reads a move log in place. The file is memory mapped where the platform allows it, and read into memory otherwise.
+ */
+struct NTGAME_API FNTMoveLogReader
+{
+	FNTMoveLogReader();
+	~FNTMoveLogReader();
+
+	/* Maps the file and checks the header. Returns false if it can't be read, or isn't a move log. */
+	bool Open(const FString& Path);
+	void Close();
+
+	const FNTMoveLogHeader& GetHeader() const { return Header; }
+
+	/* Decodes the next record. Returns false at the end, or at a record cut short by a crash. */
+	bool Next(FNTMoveLogRecord& OutRecord);
+
+	int64 GetSize() const { return Size; }
+	bool IsMapped() const { return bMapped; }
+
+private:
+	FNTMoveLogReader(const FNTMoveLogReader&);
+	FNTMoveLogReader& operator=(const FNTMoveLogReader&);
+
+	template<typename T>
+	T Get()
+	{
+		T Value;
+		FMemory::Memcpy(&Value, Data + Offset, sizeof(T));
+		Offset += sizeof(T);
+		return Value;
+	}
+
+	FVector GetVector();
+	FQuat GetQuat();
+
+	FNTMoveLogHeader Header;
+
+	const uint8* Data;
+	int64 Size;
+	int64 Offset;
+
+	bool bMapped;
+	TArray<uint8> LoadedData;
+};
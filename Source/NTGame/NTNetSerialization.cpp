@@ -0,0 +1,673 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NTGame.h"
+#include "NTNetSettings.h"
+#include "NTNetSerialization.h"
+#include "NTPawn.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Move Bytes Sent"), STAT_NTMoveBytesSent, STATGROUP_NTNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Move Bytes Saved By Delta"), STAT_NTMoveBytesSaved, STATGROUP_NTNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Full Moves Sent"), STAT_NTFullMovesSent, STATGROUP_NTNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Delta Moves Sent"), STAT_NTDeltaMovesSent, STATGROUP_NTNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ack Moves Sent"), STAT_NTAckMovesSent, STATGROUP_NTNet);
+
+static const float QuatComponentRange = 1.414213562f; // sqrt(2). The smallest three are always within +/- 1/sqrt(2)
+
+////////////////////////
+///// QUANTIZATION /////
+////////////////////////
+
+uint32 FNTQuantize::GetNumSteps(float Bound, float Precision)
+{
+	return (uint32)FMath::Max(FMath::FloorToInt(Bound / Precision), 1);
+}
+
+int32 FNTQuantize::QuantizeFloat(float Value, float Bound, float Precision)
+{
+	const int32 NumSteps = (int32)GetNumSteps(Bound, Precision);
+	return FMath::Clamp(FMath::RoundToInt(Value / Precision), -NumSteps, NumSteps);
+}
+
+float FNTQuantize::DequantizeFloat(int32 Quantized, float Precision)
+{
+	return (float)Quantized * Precision;
+}
+
+void FNTQuantize::SerializeQuantized(FArchive& Ar, int32& Quantized, float Bound, float Precision)
+{
+	const uint32 NumSteps = GetNumSteps(Bound, Precision);
+
+	uint32 Encoded = 0;
+	if (Ar.IsSaving())
+	{
+		Encoded = (uint32)(FMath::Clamp(Quantized, -(int32)NumSteps, (int32)NumSteps) + (int32)NumSteps);
+	}
+
+	Ar.SerializeInt(Encoded, NumSteps * 2 + 1);
+
+	if (Ar.IsLoading())
+	{
+		Quantized = (int32)FMath::Min(Encoded, NumSteps * 2) - (int32)NumSteps;
+	}
+}
+
+void FNTQuantize::SerializeSignedPacked(FArchive& Ar, int32& Value)
+{
+	// Zig-Zag encode so small negative numbers stay small
+	uint32 Encoded = 0;
+	if (Ar.IsSaving())
+	{
+		Encoded = ((uint32)Value << 1) ^ (uint32)(Value >> 31);
+	}
+
+	Ar.SerializeIntPacked(Encoded);
+
+	if (Ar.IsLoading())
+	{
+		Value = (int32)(Encoded >> 1) ^ -(int32)(Encoded & 1);
+	}
+}
+
+void FNTQuantize::SerializeDelta(FArchive& Ar, int32& Delta)
+{
+	uint32 Encoded = 0;
+	if (Ar.IsSaving())
+	{
+		Encoded = ((uint32)Delta << 1) ^ (uint32)(Delta >> 31);
+	}
+
+	uint8 bSmall = (Ar.IsSaving() && Encoded < 32) ? 1 : 0;
+	Ar.SerializeBits(&bSmall, 1);
+
+	if (bSmall)
+	{
+		Ar.SerializeInt(Encoded, 32);
+	}
+	else
+	{
+		uint8 bMedium = (Ar.IsSaving() && Encoded < 2048) ? 1 : 0;
+		Ar.SerializeBits(&bMedium, 1);
+
+		if (bMedium)
+		{
+			Ar.SerializeInt(Encoded, 2048);
+		}
+		else
+		{
+			Ar.SerializeIntPacked(Encoded);
+		}
+	}
+
+	if (Ar.IsLoading())
+	{
+		Delta = (int32)(Encoded >> 1) ^ -(int32)(Encoded & 1);
+	}
+}
+
+void FNTQuantize::EncodeSmallestThree(const FQuat& Value, int32 ComponentBits, uint32& OutLargest, uint32 OutComponents[3])
+{
+	const FQuat Normalized = Value.GetNormalized();
+	const float Comps[4] = { Normalized.X, Normalized.Y, Normalized.Z, Normalized.W };
+
+	OutLargest = 0;
+	for (uint32 i = 1; i < 4; i++)
+	{
+		if (FMath::Abs(Comps[i]) > FMath::Abs(Comps[OutLargest]))
+		{
+			OutLargest = i;
+		}
+	}
+
+	// Q and -Q are the same rotation, so flip to make the dropped component positive
+	const float Sign = Comps[OutLargest] < 0.f ? -1.f : 1.f;
+	const float Scale = (float)((1 << ComponentBits) - 1);
+
+	int32 Out = 0;
+	for (uint32 i = 0; i < 4; i++)
+	{
+		if (i != OutLargest)
+		{
+			const float Unit = FMath::Clamp((Comps[i] * Sign * QuatComponentRange + 1.f) * 0.5f, 0.f, 1.f);
+			OutComponents[Out++] = (uint32)FMath::RoundToInt(Unit * Scale);
+		}
+	}
+}
+
+FQuat FNTQuantize::DecodeSmallestThree(uint32 Largest, const uint32 Components[3], int32 ComponentBits)
+{
+	const float Scale = (float)((1 << ComponentBits) - 1);
+
+	float Comps[4];
+	float SumSquares = 0.f;
+	int32 In = 0;
+	for (uint32 i = 0; i < 4; i++)
+	{
+		if (i != (Largest & 3))
+		{
+			Comps[i] = ((float)Components[In++] / Scale * 2.f - 1.f) / QuatComponentRange;
+			SumSquares += FMath::Square(Comps[i]);
+		}
+	}
+
+	Comps[Largest & 3] = FMath::Sqrt(FMath::Max(0.f, 1.f - SumSquares));
+
+	FQuat Result(Comps[0], Comps[1], Comps[2], Comps[3]);
+	Result.Normalize();
+	return Result;
+}
+
+///////////////////////////
+///// QUANTIZED STATE /////
+///////////////////////////
+
+void FCubeQuantizedState::FromState(const FCubeState& State)
+{
+	const UNTNetSettings* Settings = GetDefault<UNTNetSettings>();
+
+	for (int32 i = 0; i < 3; i++)
+	{
+		Position[i] = FNTQuantize::QuantizeFloat(State.Position[i], Settings->PositionBound, Settings->PositionPrecision);
+		Velocity[i] = FNTQuantize::QuantizeFloat(State.Velocity[i], Settings->LinearVelocityBound, Settings->LinearVelocityPrecision);
+		AngularVelocity[i] = FNTQuantize::QuantizeFloat(State.AngularVelocity[i], Settings->AngularVelocityBound, Settings->AngularVelocityPrecision);
+	}
+
+	FNTQuantize::EncodeSmallestThree(State.Rotation, Settings->RotationComponentBits, RotationLargest, Rotation);
+}
+
+FCubeState FCubeQuantizedState::ToState() const
+{
+	const UNTNetSettings* Settings = GetDefault<UNTNetSettings>();
+
+	FCubeState Result;
+	for (int32 i = 0; i < 3; i++)
+	{
+		Result.Position[i] = FNTQuantize::DequantizeFloat(Position[i], Settings->PositionPrecision);
+		Result.Velocity[i] = FNTQuantize::DequantizeFloat(Velocity[i], Settings->LinearVelocityPrecision);
+		Result.AngularVelocity[i] = FNTQuantize::DequantizeFloat(AngularVelocity[i], Settings->AngularVelocityPrecision);
+	}
+
+	Result.Rotation = FNTQuantize::DecodeSmallestThree(RotationLargest, Rotation, Settings->RotationComponentBits);
+	return Result;
+}
+
+static void SerializeQuantizedVector(FArchive& Ar, int32 Value[3], float Bound, float Precision)
+{
+	// Resting cubes have zero velocities, so those get a single bit
+	uint8 bIsZero = (Ar.IsSaving() && Value[0] == 0 && Value[1] == 0 && Value[2] == 0) ? 1 : 0;
+	Ar.SerializeBits(&bIsZero, 1);
+
+	for (int32 i = 0; i < 3; i++)
+	{
+		if (bIsZero)
+		{
+			Value[i] = 0;
+		}
+		else
+		{
+			FNTQuantize::SerializeQuantized(Ar, Value[i], Bound, Precision);
+		}
+	}
+}
+
+void FCubeQuantizedState::Serialize(FArchive& Ar)
+{
+	const UNTNetSettings* Settings = GetDefault<UNTNetSettings>();
+
+	for (int32 i = 0; i < 3; i++)
+	{
+		FNTQuantize::SerializeQuantized(Ar, Position[i], Settings->PositionBound, Settings->PositionPrecision);
+	}
+
+	Ar.SerializeInt(RotationLargest, 4);
+	for (int32 i = 0; i < 3; i++)
+	{
+		Ar.SerializeInt(Rotation[i], 1 << Settings->RotationComponentBits);
+	}
+
+	SerializeQuantizedVector(Ar, Velocity, Settings->LinearVelocityBound, Settings->LinearVelocityPrecision);
+	SerializeQuantizedVector(Ar, AngularVelocity, Settings->AngularVelocityBound, Settings->AngularVelocityPrecision);
+}
+
+uint8 FCubeQuantizedState::MakeDelta(const FCubeQuantizedState& Current, const FCubeQuantizedState& Baseline, FCubeQuantizedState& OutDelta)
+{
+	uint8 Flags = 0;
+
+	for (int32 i = 0; i < 3; i++)
+	{
+		OutDelta.Position[i] = Current.Position[i] - Baseline.Position[i];
+		OutDelta.Velocity[i] = Current.Velocity[i] - Baseline.Velocity[i];
+		OutDelta.AngularVelocity[i] = Current.AngularVelocity[i] - Baseline.AngularVelocity[i];
+
+		Flags |= OutDelta.Position[i] != 0 ? DELTA_Position : 0;
+		Flags |= OutDelta.Velocity[i] != 0 ? DELTA_Velocity : 0;
+		Flags |= OutDelta.AngularVelocity[i] != 0 ? DELTA_AngularVelocity : 0;
+	}
+
+	// Smallest-three components are only comparable if the same component was dropped
+	if (Current.RotationLargest != Baseline.RotationLargest)
+	{
+		Flags |= DELTA_Rotation | DELTA_RotationFull;
+		OutDelta.RotationLargest = Current.RotationLargest;
+		for (int32 i = 0; i < 3; i++)
+		{
+			OutDelta.Rotation[i] = Current.Rotation[i];
+		}
+	}
+	else
+	{
+		OutDelta.RotationLargest = 0;
+		for (int32 i = 0; i < 3; i++)
+		{
+			OutDelta.Rotation[i] = (uint32)((int32)Current.Rotation[i] - (int32)Baseline.Rotation[i]);
+			Flags |= OutDelta.Rotation[i] != 0 ? DELTA_Rotation : 0;
+		}
+	}
+
+	return Flags;
+}
+
+FCubeQuantizedState FCubeQuantizedState::ApplyDelta(const FCubeQuantizedState& Baseline, uint8 DeltaFlags, const FCubeQuantizedState& Delta)
+{
+	FCubeQuantizedState Result = Baseline;
+
+	for (int32 i = 0; i < 3; i++)
+	{
+		if (DeltaFlags & DELTA_Position)
+		{
+			Result.Position[i] += Delta.Position[i];
+		}
+		if (DeltaFlags & DELTA_Velocity)
+		{
+			Result.Velocity[i] += Delta.Velocity[i];
+		}
+		if (DeltaFlags & DELTA_AngularVelocity)
+		{
+			Result.AngularVelocity[i] += Delta.AngularVelocity[i];
+		}
+	}
+
+	if (DeltaFlags & DELTA_RotationFull)
+	{
+		Result.RotationLargest = Delta.RotationLargest;
+		for (int32 i = 0; i < 3; i++)
+		{
+			Result.Rotation[i] = Delta.Rotation[i];
+		}
+	}
+	else if (DeltaFlags & DELTA_Rotation)
+	{
+		for (int32 i = 0; i < 3; i++)
+		{
+			Result.Rotation[i] = (uint32)((int32)Result.Rotation[i] + (int32)Delta.Rotation[i]);
+		}
+	}
+
+	return Result;
+}
+
+void FCubeQuantizedState::SerializeDelta(FArchive& Ar, uint8& DeltaFlags, FCubeQuantizedState& Delta)
+{
+	const UNTNetSettings* Settings = GetDefault<UNTNetSettings>();
+
+	Ar.SerializeBits(&DeltaFlags, 5);
+
+	if (DeltaFlags & DELTA_Position)
+	{
+		for (int32 i = 0; i < 3; i++)
+		{
+			FNTQuantize::SerializeDelta(Ar, Delta.Position[i]);
+		}
+	}
+
+	if (DeltaFlags & DELTA_RotationFull)
+	{
+		Ar.SerializeInt(Delta.RotationLargest, 4);
+		for (int32 i = 0; i < 3; i++)
+		{
+			Ar.SerializeInt(Delta.Rotation[i], 1 << Settings->RotationComponentBits);
+		}
+	}
+	else if (DeltaFlags & DELTA_Rotation)
+	{
+		for (int32 i = 0; i < 3; i++)
+		{
+			int32 Component = (int32)Delta.Rotation[i];
+			FNTQuantize::SerializeDelta(Ar, Component);
+			Delta.Rotation[i] = (uint32)Component;
+		}
+	}
+
+	if (DeltaFlags & DELTA_Velocity)
+	{
+		for (int32 i = 0; i < 3; i++)
+		{
+			FNTQuantize::SerializeDelta(Ar, Delta.Velocity[i]);
+		}
+	}
+
+	if (DeltaFlags & DELTA_AngularVelocity)
+	{
+		for (int32 i = 0; i < 3; i++)
+		{
+			FNTQuantize::SerializeDelta(Ar, Delta.AngularVelocity[i]);
+		}
+	}
+}
+
+void FCubeBaselineBuffer::Reset()
+{
+	for (int32 i = 0; i < NumBaselines; i++)
+	{
+		Ticks[i] = INDEX_NONE;
+	}
+}
+
+void FCubeBaselineBuffer::Add(int32 Tick, const FCubeQuantizedState& State)
+{
+	const int32 Index = Tick & (NumBaselines - 1);
+	Ticks[Index] = Tick;
+	States[Index] = State;
+}
+
+const FCubeQuantizedState* FCubeBaselineBuffer::Find(int32 Tick) const
+{
+	if (Tick == INDEX_NONE)
+	{
+		return nullptr;
+	}
+
+	const int32 Index = Tick & (NumBaselines - 1);
+	return Ticks[Index] == Tick ? &States[Index] : nullptr;
+}
+
+void FCubeStateHashBuffer::Reset()
+{
+	for (int32 i = 0; i < NumHashes; i++)
+	{
+		Ticks[i] = INDEX_NONE;
+	}
+}
+
+void FCubeStateHashBuffer::Add(int32 Tick, uint32 Hash)
+{
+	const int32 Index = Tick & (NumHashes - 1);
+	Ticks[Index] = Tick;
+	Hashes[Index] = Hash;
+}
+
+bool FCubeStateHashBuffer::Find(int32 Tick, uint32& OutHash) const
+{
+	const int32 Index = Tick & (NumHashes - 1);
+	if (Tick == INDEX_NONE || Ticks[Index] != Tick)
+	{
+		return false;
+	}
+
+	OutHash = Hashes[Index];
+	return true;
+}
+
+//////////////////////////////////
+///// CUBE NET SERIALIZATION /////
+//////////////////////////////////
+
+void FCubeState::Quantize()
+{
+	FCubeQuantizedState Quantized;
+	Quantized.FromState(*this);
+	*this = Quantized.ToState();
+}
+
+bool FCubeState::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	FCubeQuantizedState Quantized;
+	if (Ar.IsSaving())
+	{
+		Quantized.FromState(*this);
+	}
+
+	Quantized.Serialize(Ar);
+
+	if (Ar.IsLoading())
+	{
+		*this = Quantized.ToState();
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
+
+bool FCubeInput::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	uint8 Bits = Ar.IsSaving() ? ToBits() : 0;
+	Ar.SerializeBits(&Bits, 4);
+
+	if (Ar.IsLoading())
+	{
+		FromBits(Bits);
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
+
+void FCubeMove::NetSerializeHeader(FArchive& Ar)
+{
+	FNTQuantize::SerializeSignedPacked(Ar, TimeStamp);
+	FNTQuantize::SerializeSignedPacked(Ar, TickNumber);
+
+	uint8 bHasHash = (Ar.IsSaving() && RandHash != 0) ? 1 : 0;
+	Ar.SerializeBits(&bHasHash, 1);
+	if (bHasHash)
+	{
+		Ar << RandHash;
+	}
+	else if (Ar.IsLoading())
+	{
+		RandHash = 0;
+	}
+
+	bool bInputSuccess = true;
+	CubeInput.NetSerialize(Ar, nullptr, bInputSuccess);
+}
+
+bool FCubeMove::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	NetSerializeHeader(Ar);
+
+	bool bStateSuccess = true;
+	CubeState.NetSerialize(Ar, Map, bStateSuccess);
+
+	bOutSuccess = bStateSuccess && !Ar.IsError();
+	return true;
+}
+
+bool FCubeInputBatch::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	AckHeader.Serialize(Ar);
+	FNTQuantize::SerializeSignedPacked(Ar, BaseTick);
+	FNTQuantize::SerializeSignedPacked(Ar, AckedServerTick);
+
+	uint32 NumInputs = (uint32)FMath::Min(Inputs.Num(), (int32)MaxInputs);
+	Ar.SerializeInt(NumInputs, MaxInputs + 1);
+
+	if (Ar.IsLoading())
+	{
+		Inputs.SetNumZeroed(NumInputs);
+	}
+
+	// Run-length encoded - 4 bits of input, then the run length. Runs of up to 8 take 4 bits, longer runs take 1 + 7.
+	uint32 Index = 0;
+	while (Index < NumInputs && !Ar.IsError())
+	{
+		uint8 Value = 0;
+		uint32 RunLength = 1;
+
+		if (Ar.IsSaving())
+		{
+			Value = Inputs[Index] & 0x0F;
+			while (Index + RunLength < NumInputs && (Inputs[Index + RunLength] & 0x0F) == Value)
+			{
+				RunLength++;
+			}
+		}
+
+		Ar.SerializeBits(&Value, 4);
+
+		uint32 EncodedLength = RunLength - 1;
+		uint8 bLongRun = (Ar.IsSaving() && EncodedLength >= 8) ? 1 : 0;
+		Ar.SerializeBits(&bLongRun, 1);
+		Ar.SerializeInt(EncodedLength, bLongRun ? MaxInputs : 8);
+
+		RunLength = FMath::Min(EncodedLength + 1, NumInputs - Index);
+		if (Ar.IsLoading())
+		{
+			for (uint32 i = 0; i < RunLength; i++)
+			{
+				Inputs[Index + i] = Value;
+			}
+		}
+
+		Index += RunLength;
+	}
+
+	uint32 NumHashes = (uint32)FMath::Min(StateHashes.Num(), (int32)MaxStateHashes);
+	Ar.SerializeInt(NumHashes, MaxStateHashes + 1);
+
+	if (Ar.IsLoading())
+	{
+		StateHashes.SetNumZeroed(NumHashes);
+	}
+
+	for (uint32 i = 0; i < NumHashes; i++)
+	{
+		Ar << StateHashes[i];
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
+
+void FCubeServerMove::SetState(const FCubeMove& NewMove, int32 NewServerTick, const FCubeBaselineBuffer& SentBaselines, int32 AckedServerTick)
+{
+	Move = NewMove;
+	ServerTick = NewServerTick;
+	Quantized.FromState(NewMove.CubeState);
+	Move.CubeState = Quantized.ToState();
+
+	// Delta against the newest baseline the Client has told us it has. If we no longer have it, send the full state.
+	const FCubeQuantizedState* Baseline = SentBaselines.Find(AckedServerTick);
+	if (Baseline && AckedServerTick < NewServerTick)
+	{
+		BaselineTick = AckedServerTick;
+		DeltaFlags = FCubeQuantizedState::MakeDelta(Quantized, *Baseline, Delta);
+	}
+	else
+	{
+		BaselineTick = INDEX_NONE;
+		DeltaFlags = 0;
+	}
+}
+
+bool FCubeServerMove::ResolveBaseline(const FCubeBaselineBuffer& ReceivedBaselines)
+{
+	if (BaselineTick != INDEX_NONE)
+	{
+		const FCubeQuantizedState* Baseline = ReceivedBaselines.Find(BaselineTick);
+		if (!Baseline)
+		{
+			return false;
+		}
+
+		Quantized = FCubeQuantizedState::ApplyDelta(*Baseline, DeltaFlags, Delta);
+	}
+
+	Move.CubeState = Quantized.ToState();
+	return true;
+}
+
+void FCubeServerMove::SerializePayload(FArchive& Ar)
+{
+	AckHeader.Serialize(Ar);
+	FNTQuantize::SerializeSignedPacked(Ar, ServerTick);
+	FNTQuantize::SerializeSignedPacked(Ar, InputBufferSlack);
+	Move.NetSerializeHeader(Ar);
+
+	// A matched prediction needs no state at all
+	uint8 bMatched = (Ar.IsSaving() && bPredictionMatched) ? 1 : 0;
+	Ar.SerializeBits(&bMatched, 1);
+	bPredictionMatched = bMatched != 0;
+
+	if (bPredictionMatched)
+	{
+		BaselineTick = INDEX_NONE;
+		return;
+	}
+
+	uint8 bHasBaseline = (Ar.IsSaving() && BaselineTick != INDEX_NONE) ? 1 : 0;
+	Ar.SerializeBits(&bHasBaseline, 1);
+
+	if (bHasBaseline)
+	{
+		// Baselines are always recent, so send how far back it is rather than the tick itself
+		int32 BaselineAge = ServerTick - BaselineTick;
+		FNTQuantize::SerializeSignedPacked(Ar, BaselineAge);
+		BaselineTick = ServerTick - BaselineAge;
+
+		FCubeQuantizedState::SerializeDelta(Ar, DeltaFlags, Delta);
+	}
+	else
+	{
+		BaselineTick = INDEX_NONE;
+		Quantized.Serialize(Ar);
+	}
+}
+
+bool FCubeServerMove::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	if (Ar.IsSaving())
+	{
+		FBitWriter Writer(0, true);
+		SerializePayload(Writer);
+		Ar.SerializeBits(Writer.GetData(), Writer.GetNumBits());
+
+		const uint32 SentBytes = (uint32)((Writer.GetNumBits() + 7) >> 3);
+		INC_DWORD_STAT_BY(STAT_NTMoveBytesSent, SentBytes);
+
+#if STATS
+		if (BaselineTick != INDEX_NONE || bPredictionMatched)
+		{
+			// Measure what the full state would have cost, so we can see what the delta or ack saved
+			FCubeServerMove FullMove = *this;
+			FullMove.BaselineTick = INDEX_NONE;
+			FullMove.bPredictionMatched = false;
+
+			FBitWriter FullWriter(0, true);
+			FullMove.SerializePayload(FullWriter);
+
+			const uint32 FullBytes = (uint32)((FullWriter.GetNumBits() + 7) >> 3);
+			INC_DWORD_STAT_BY(STAT_NTMoveBytesSaved, FullBytes > SentBytes ? FullBytes - SentBytes : 0);
+
+			if (bPredictionMatched)
+			{
+				INC_DWORD_STAT(STAT_NTAckMovesSent);
+			}
+			else
+			{
+				INC_DWORD_STAT(STAT_NTDeltaMovesSent);
+			}
+		}
+		else
+		{
+			INC_DWORD_STAT(STAT_NTFullMovesSent);
+		}
+#endif
+	}
+	else
+	{
+		SerializePayload(Ar);
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+struct FCubeState;
+
+/**
+ * Quantization helpers shared by the net serializers. Everything that goes over the wire is quantized through these,
+ * and the same functions are used to quantize local state, so Client and Server see bit-identical values.
+ */
+struct NTGAME_API FNTQuantize
+{
+	/* Number of steps either side of zero for a bounded value */
+	static uint32 GetNumSteps(float Bound, float Precision);
+
+	/* Rounds a value to the nearest step, clamped to +/- Bound */
+	static int32 QuantizeFloat(float Value, float Bound, float Precision);
+	static float DequantizeFloat(int32 Quantized, float Precision);
+
+	/* Serializes a quantized value as a fixed-point integer, using only as many bits as the range needs */
+	static void SerializeQuantized(FArchive& Ar, int32& Quantized, float Bound, float Precision);
+
+	/* Smallest-three rotation compression - Index of the largest component, then the other three */
+	static void EncodeSmallestThree(const FQuat& Value, int32 ComponentBits, uint32& OutLargest, uint32 OutComponents[3]);
+	static FQuat DecodeSmallestThree(uint32 Largest, const uint32 Components[3], int32 ComponentBits);
+
+	/* Variable length signed integer, small magnitudes take fewer bytes */
+	static void SerializeSignedPacked(FArchive& Ar, int32& Value);
+
+	/* Signed integer tuned for small deltas. 6 bits up to +/- 16, 13 bits up to +/- 1024, packed beyond that */
+	static void SerializeDelta(FArchive& Ar, int32& Delta);
+};
+
+/**
+ * FCubeState in its quantized, integer form. This is what actually goes over the wire, and what baselines are stored as.
+ */
+struct NTGAME_API FCubeQuantizedState
+{
+	int32 Position[3];
+	uint32 RotationLargest;
+	uint32 Rotation[3];
+	int32 Velocity[3];
+	int32 AngularVelocity[3];
+
+	// Flags for which parts of the state changed against a baseline
+	enum EDeltaFlags
+	{
+		DELTA_Position = 1 << 0,
+		DELTA_Rotation = 1 << 1,
+		DELTA_Velocity = 1 << 2,
+		DELTA_AngularVelocity = 1 << 3,
+		DELTA_RotationFull = 1 << 4, // Largest component changed, so the rotation is sent in full rather than as a delta
+	};
+
+	FCubeQuantizedState()
+	{
+		FMemory::Memzero(this, sizeof(FCubeQuantizedState));
+	}
+
+	void FromState(const FCubeState& State);
+	FCubeState ToState() const;
+
+	bool operator==(const FCubeQuantizedState& Other) const
+	{
+		return FMemory::Memcmp(this, &Other, sizeof(FCubeQuantizedState)) == 0;
+	}
+
+	/* CRC of the quantized fields. Equal states hash equal on Client and Server, so a hash can stand in for the state. */
+	uint32 GetHash() const
+	{
+		return FCrc::MemCrc32(this, sizeof(FCubeQuantizedState));
+	}
+
+	/* Full state */
+	void Serialize(FArchive& Ar);
+
+	/* Builds the field-wise difference against a baseline and returns which fields changed */
+	static uint8 MakeDelta(const FCubeQuantizedState& Current, const FCubeQuantizedState& Baseline, FCubeQuantizedState& OutDelta);
+	static FCubeQuantizedState ApplyDelta(const FCubeQuantizedState& Baseline, uint8 DeltaFlags, const FCubeQuantizedState& Delta);
+	static void SerializeDelta(FArchive& Ar, uint8& DeltaFlags, FCubeQuantizedState& Delta);
+};
+
+/**
+ * Ring of quantized states keyed by Server tick. The Server keeps the states it sent, the Client the states it received,
+ * so either side can look up the baseline a delta refers to.
+ */
+struct NTGAME_API FCubeBaselineBuffer
+{
+	enum { NumBaselines = 64 };
+
+	FCubeBaselineBuffer()
+	{
+		Reset();
+	}
+
+	void Reset();
+	void Add(int32 Tick, const FCubeQuantizedState& State);
+
+	/* Returns the baseline for a tick, or null if it's been overwritten or never existed */
+	const FCubeQuantizedState* Find(int32 Tick) const;
+
+private:
+	FCubeQuantizedState States[NumBaselines];
+	int32 Ticks[NumBaselines];
+};
+
+/**
+ * Ring of state hashes keyed by Client tick. The Server keeps the hashes of the Client's predicted states here until it
+ * simulates the same ticks.
+ */
+struct NTGAME_API FCubeStateHashBuffer
+{
+	enum { NumHashes = 128 };
+
+	FCubeStateHashBuffer()
+	{
+		Reset();
+	}
+
+	void Reset();
+	void Add(int32 Tick, uint32 Hash);
+
+	/* Returns false if the hash for a tick has been overwritten or never arrived */
+	bool Find(int32 Tick, uint32& OutHash) const;
+
+private:
+	uint32 Hashes[NumHashes];
+	int32 Ticks[NumHashes];
+};
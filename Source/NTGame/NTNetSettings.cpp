@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NTGame.h"
+#include "NTNetSettings.h"
+
+UNTNetSettings::UNTNetSettings(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	// Quantization
+	PositionBound = 16384.0f;
+	PositionPrecision = 0.05f;
+	LinearVelocityBound = 4096.0f;
+	LinearVelocityPrecision = 0.1f;
+	AngularVelocityBound = 2048.0f;
+	AngularVelocityPrecision = 0.5f;
+	RotationComponentBits = 10;
+
+	// Input Jitter Buffer
+	MinInputBufferDepth = 2;
+	MaxInputBufferDepth = 16;
+	InputJitterMultiplier = 2.0f;
+	MissingInputPolicy = ENTMissingInputPolicy::RepeatLast;
+
+	// Snapshots
+	SnapshotRate = 20.0f;
+	SnapshotByteBudget = 1000;
+	SnapshotSpeedScale = 500.0f;
+	SnapshotDistanceScale = 3000.0f;
+	SnapshotInteractionBoost = 4.0f;
+	SnapshotInteractionTime = 1.0f;
+	SnapshotRestRepeats = 3;
+
+	// Relevancy
+	bUseRelevancyGrid = true;
+	RelevancyCellSize = 2500.0f;
+	RelevancyDistance = 15000.0f;
+	RelevancyUpdateInterval = 0.1f;
+
+	// Interpolation
+	InterpolationJitterMultiplier = 2.0f;
+	InterpolationExtraDelay = 0.01f;
+	InterpolationMaxExtrapolation = 0.25f;
+
+	// Clock Sync
+	ClockSyncInterval = 1.0f;
+	ClockSyncWarmupInterval = 0.1f;
+	ClockSyncWindow = 16;
+	ClockSyncBestFraction = 0.25f;
+	ClockSyncMaxSlewRate = 0.01f;
+	ClockSyncSnapThreshold = 0.25f;
+	ClockSyncMaxDrift = 0.01f;
+
+	// Time Dilation
+	TimeDilationMaxAdjust = 0.03f;
+	TimeDilationProportionalGain = 0.01f;
+	TimeDilationIntegralGain = 0.002f;
+	TimeDilationSlackSmoothing = 0.1f;
+
+	// Congestion Control
+	CongestionBadRTT = 250.0f;
+	CongestionBadRTTVariance = 50.0f;
+	CongestionBadLoss = 0.05f;
+	CongestionBadRateScale = 0.5f;
+	CongestionBadBudgetScale = 0.5f;
+	CongestionBadInputIntervalScale = 2;
+	CongestionInitialPenaltyTime = 4.0f;
+	CongestionMinPenaltyTime = 1.0f;
+	CongestionMaxPenaltyTime = 60.0f;
+	CongestionPenaltyRelaxTime = 10.0f;
+}
@@ -0,0 +1,215 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Engine/DeveloperSettings.h"
+#include "NTNetSettings.generated.h"
+
+/* What the Server simulates when the input for a tick hasn't arrived */
+UENUM()
+enum class ENTMissingInputPolicy : uint8
+{
+	/* Keep simulating the last input we had. The Client is most likely still holding the same keys. */
+	RepeatLast,
+	/* Simulate no input */
+	Neutral,
+};
+
+/**
+ * Project-wide Networked Physics settings. Read from DefaultGame.ini, so Client and Server always agree.
+ */
+UCLASS(config = Game, defaultconfig, meta = (DisplayName = "Networked Physics"))
+class NTGAME_API UNTNetSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UNTNetSettings(const FObjectInitializer& ObjectInitializer);
+
+	// --- QUANTIZATION ----------------------------------------------------------------
+	/* Positions are clamped to +/- this on each axis */
+	UPROPERTY(config, EditAnywhere, Category = "Quantization", meta = (ClampMin = "1.0"))
+	float PositionBound;
+
+	/* Smallest representable change in position */
+	UPROPERTY(config, EditAnywhere, Category = "Quantization", meta = (ClampMin = "0.001"))
+	float PositionPrecision;
+
+	/* Linear velocity is clamped to +/- this on each axis */
+	UPROPERTY(config, EditAnywhere, Category = "Quantization", meta = (ClampMin = "1.0"))
+	float LinearVelocityBound;
+
+	UPROPERTY(config, EditAnywhere, Category = "Quantization", meta = (ClampMin = "0.001"))
+	float LinearVelocityPrecision;
+
+	/* Angular velocity is clamped to +/- this on each axis, in degrees */
+	UPROPERTY(config, EditAnywhere, Category = "Quantization", meta = (ClampMin = "1.0"))
+	float AngularVelocityBound;
+
+	UPROPERTY(config, EditAnywhere, Category = "Quantization", meta = (ClampMin = "0.001"))
+	float AngularVelocityPrecision;
+
+	/* Bits per component for smallest-three rotation compression */
+	UPROPERTY(config, EditAnywhere, Category = "Quantization", meta = (ClampMin = "4", ClampMax = "16"))
+	int32 RotationComponentBits;
+
+	// --- INPUT JITTER BUFFER ----------------------------------------------------------
+	/* Inputs the Server buffers before playing, with no jitter */
+	UPROPERTY(config, EditAnywhere, Category = "Input Buffer", meta = (ClampMin = "1"))
+	int32 MinInputBufferDepth;
+
+	/* Upper limit on the adaptive buffer depth, however bad the jitter gets */
+	UPROPERTY(config, EditAnywhere, Category = "Input Buffer", meta = (ClampMin = "1"))
+	int32 MaxInputBufferDepth;
+
+	/* How many multiples of the measured jitter to buffer */
+	UPROPERTY(config, EditAnywhere, Category = "Input Buffer", meta = (ClampMin = "0.0"))
+	float InputJitterMultiplier;
+
+	UPROPERTY(config, EditAnywhere, Category = "Input Buffer")
+	ENTMissingInputPolicy MissingInputPolicy;
+
+	// --- SNAPSHOTS -------------------------------------------------------------------
+	/* Snapshots sent to each Client per second */
+	UPROPERTY(config, EditAnywhere, Category = "Snapshots", meta = (ClampMin = "1.0"))
+	float SnapshotRate;
+
+	/* Hard cap on the size of a single snapshot, in bytes */
+	UPROPERTY(config, EditAnywhere, Category = "Snapshots", meta = (ClampMin = "64"))
+	int32 SnapshotByteBudget;
+
+	/* Speed at which a cube's priority doubles */
+	UPROPERTY(config, EditAnywhere, Category = "Snapshots", meta = (ClampMin = "1.0"))
+	float SnapshotSpeedScale;
+
+	/* Distance from the viewer at which a cube's priority halves */
+	UPROPERTY(config, EditAnywhere, Category = "Snapshots", meta = (ClampMin = "1.0"))
+	float SnapshotDistanceScale;
+
+	/* Priority multiplier for cubes that have recently hit something */
+	UPROPERTY(config, EditAnywhere, Category = "Snapshots", meta = (ClampMin = "1.0"))
+	float SnapshotInteractionBoost;
+
+	/* How long a hit keeps a cube boosted, in seconds */
+	UPROPERTY(config, EditAnywhere, Category = "Snapshots", meta = (ClampMin = "0.0"))
+	float SnapshotInteractionTime;
+
+	/* Times a cube's resting state goes to each Client before it's left out of snapshots. More than one covers loss. */
+	UPROPERTY(config, EditAnywhere, Category = "Snapshots", meta = (ClampMin = "1"))
+	int32 SnapshotRestRepeats;
+
+	// --- RELEVANCY -------------------------------------------------------------------
+	/* If true, the Server decides which cubes each Client can see from a grid around its pawn, instead of per-actor distance checks */
+	UPROPERTY(config, EditAnywhere, Category = "Relevancy")
+	bool bUseRelevancyGrid;
+
+	/* Size of a grid cell, in cm. Around the relevancy distance divided by a small number keeps queries to a few dozen cells. */
+	UPROPERTY(config, EditAnywhere, Category = "Relevancy", meta = (ClampMin = "100.0"))
+	float RelevancyCellSize;
+
+	/* Cubes in any cell within this distance of a Client's pawn are relevant to it, in cm */
+	UPROPERTY(config, EditAnywhere, Category = "Relevancy", meta = (ClampMin = "0.0"))
+	float RelevancyDistance;
+
+	/* Seconds between requerying the grid for each Client */
+	UPROPERTY(config, EditAnywhere, Category = "Relevancy", meta = (ClampMin = "0.0"))
+	float RelevancyUpdateInterval;
+
+	// --- INTERPOLATION ---------------------------------------------------------------
+	/* Remote cubes play back this many times the snapshot jitter behind the newest snapshot, on top of the interval */
+	UPROPERTY(config, EditAnywhere, Category = "Interpolation", meta = (ClampMin = "0.0"))
+	float InterpolationJitterMultiplier;
+
+	/* Fixed extra playout delay, in seconds */
+	UPROPERTY(config, EditAnywhere, Category = "Interpolation", meta = (ClampMin = "0.0"))
+	float InterpolationExtraDelay;
+
+	/* Longest we'll carry a remote cube on past its newest snapshot before holding it still, in seconds */
+	UPROPERTY(config, EditAnywhere, Category = "Interpolation", meta = (ClampMin = "0.0"))
+	float InterpolationMaxExtrapolation;
+
+	// --- CLOCK SYNC ------------------------------------------------------------------
+	/* Seconds between timestamp requests once the window is full */
+	UPROPERTY(config, EditAnywhere, Category = "Clock Sync", meta = (ClampMin = "0.1"))
+	float ClockSyncInterval;
+
+	/* Seconds between timestamp requests until the window is full */
+	UPROPERTY(config, EditAnywhere, Category = "Clock Sync", meta = (ClampMin = "0.01"))
+	float ClockSyncWarmupInterval;
+
+	/* Samples kept, rounded up to a power of two */
+	UPROPERTY(config, EditAnywhere, Category = "Clock Sync", meta = (ClampMin = "1", ClampMax = "32"))
+	int32 ClockSyncWindow;
+
+	/* Fraction of the window, lowest RTT first, averaged for the offset */
+	UPROPERTY(config, EditAnywhere, Category = "Clock Sync", meta = (ClampMin = "0.01", ClampMax = "1.0"))
+	float ClockSyncBestFraction;
+
+	/* Fastest the offset in use can change, in seconds per second */
+	UPROPERTY(config, EditAnywhere, Category = "Clock Sync", meta = (ClampMin = "0.0"))
+	float ClockSyncMaxSlewRate;
+
+	/* Errors bigger than this, in seconds, are jumped rather than slewed */
+	UPROPERTY(config, EditAnywhere, Category = "Clock Sync", meta = (ClampMin = "0.0"))
+	float ClockSyncSnapThreshold;
+
+	/* Largest drift we believe, in seconds per second */
+	UPROPERTY(config, EditAnywhere, Category = "Clock Sync", meta = (ClampMin = "0.0"))
+	float ClockSyncMaxDrift;
+
+	// --- TIME DILATION ---------------------------------------------------------------
+	/* Most the Client will speed up or slow down its simulation, as a fraction of real time */
+	UPROPERTY(config, EditAnywhere, Category = "Time Dilation", meta = (ClampMin = "0.0", ClampMax = "0.1"))
+	float TimeDilationMaxAdjust;
+
+	/* Time scale change per tick of input buffer slack */
+	UPROPERTY(config, EditAnywhere, Category = "Time Dilation", meta = (ClampMin = "0.0"))
+	float TimeDilationProportionalGain;
+
+	/* Time scale change per tick-second of accumulated slack */
+	UPROPERTY(config, EditAnywhere, Category = "Time Dilation", meta = (ClampMin = "0.0"))
+	float TimeDilationIntegralGain;
+
+	/* Weight of each new slack report */
+	UPROPERTY(config, EditAnywhere, Category = "Time Dilation", meta = (ClampMin = "0.01", ClampMax = "1.0"))
+	float TimeDilationSlackSmoothing;
+
+	// --- CONGESTION CONTROL ------------------------------------------------------------
+	/* Round trip time above which a connection goes to Bad mode, in ms */
+	UPROPERTY(config, EditAnywhere, Category = "Congestion Control", meta = (ClampMin = "1.0"))
+	float CongestionBadRTT;
+
+	/* Round trip time deviation above which a connection goes to Bad mode, in ms */
+	UPROPERTY(config, EditAnywhere, Category = "Congestion Control", meta = (ClampMin = "1.0"))
+	float CongestionBadRTTVariance;
+
+	/* Packet loss above which a connection goes to Bad mode, 0 - 1 */
+	UPROPERTY(config, EditAnywhere, Category = "Congestion Control", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float CongestionBadLoss;
+
+	/* Snapshot rate and ServerMoveData update frequency are scaled by this in Bad mode */
+	UPROPERTY(config, EditAnywhere, Category = "Congestion Control", meta = (ClampMin = "0.05", ClampMax = "1.0"))
+	float CongestionBadRateScale;
+
+	/* Snapshot byte budget is scaled by this in Bad mode */
+	UPROPERTY(config, EditAnywhere, Category = "Congestion Control", meta = (ClampMin = "0.05", ClampMax = "1.0"))
+	float CongestionBadBudgetScale;
+
+	/* Client input batches are sent this many times less often in Bad mode. Redundancy covers the gaps. */
+	UPROPERTY(config, EditAnywhere, Category = "Congestion Control", meta = (ClampMin = "1"))
+	int32 CongestionBadInputIntervalScale;
+
+	/* Seconds conditions must stay good before leaving Bad mode, to start with */
+	UPROPERTY(config, EditAnywhere, Category = "Congestion Control", meta = (ClampMin = "0.0"))
+	float CongestionInitialPenaltyTime;
+
+	UPROPERTY(config, EditAnywhere, Category = "Congestion Control", meta = (ClampMin = "0.0"))
+	float CongestionMinPenaltyTime;
+
+	UPROPERTY(config, EditAnywhere, Category = "Congestion Control", meta = (ClampMin = "0.0"))
+	float CongestionMaxPenaltyTime;
+
+	/* Dropping back to Bad within this many seconds doubles the penalty. Staying Good this long halves it. */
+	UPROPERTY(config, EditAnywhere, Category = "Congestion Control", meta = (ClampMin = "0.1"))
+	float CongestionPenaltyRelaxTime;
+};
@@ -2,14 +2,55 @@
 
 #include "NTGame.h"
 #include "NTPlayerController.h"
+#include "NTCubeIntegrator.h"
+#include "NTCubeManager.h"
+#include "NTSoakMonitor.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "NTPawn.h"
 
+DECLARE_DWORD_COUNTER_STAT(TEXT("Input Batches Sent"), STAT_NTInputBatchesSent, STATGROUP_NTNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Important Moves Acked"), STAT_NTImportantMovesAcked, STATGROUP_NTNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Redundant Inputs Received"), STAT_NTRedundantInputs, STATGROUP_NTNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Input Late Drops"), STAT_NTInputLateDrops, STATGROUP_NTNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Input Underruns"), STAT_NTInputUnderruns, STATGROUP_NTNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Input Skipped"), STAT_NTInputSkipped, STATGROUP_NTNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Input Buffer Depth (All Connections)"), STAT_NTInputBufferDepth, STATGROUP_NTNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Input Buffer Target (All Connections)"), STAT_NTInputBufferTarget, STATGROUP_NTNet);
+
+DECLARE_CYCLE_STAT(TEXT("Calculate Accel"), STAT_NTCalculateAccel, STATGROUP_NTPrediction);
+DECLARE_CYCLE_STAT(TEXT("Visual Smoothing"), STAT_NTVisualSmoothing, STATGROUP_NTPrediction);
+DECLARE_CYCLE_STAT(TEXT("History Correction - Discard"), STAT_NTCorrectionDiscard, STATGROUP_NTPrediction);
+DECLARE_CYCLE_STAT(TEXT("History Correction - Replay"), STAT_NTCorrectionReplay, STATGROUP_NTPrediction);
+DECLARE_CYCLE_STAT(TEXT("Send Input Batch"), STAT_NTSendInputBatch, STATGROUP_NTPrediction);
+DECLARE_CYCLE_STAT(TEXT("Send Server Move"), STAT_NTSendServerMove, STATGROUP_NTPrediction);
+DECLARE_CYCLE_STAT(TEXT("Receive Input Batch"), STAT_NTReceiveInputBatch, STATGROUP_NTPrediction);
+DECLARE_CYCLE_STAT(TEXT("OnRep ServerMoveData"), STAT_NTOnRepServerMoveData, STATGROUP_NTPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Corrections Received"), STAT_NTCorrectionsReceived, STATGROUP_NTPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Correction Key Mismatches"), STAT_NTCorrectionKeyMismatches, STATGROUP_NTPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Correction Key Mismatches Skipped"), STAT_NTCorrectionMismatchesSkipped, STATGROUP_NTPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Predictions Acked"), STAT_NTPredictionsAcked, STATGROUP_NTPrediction);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Prediction Hash Mismatches"), STAT_NTPredictionHashMismatches, STATGROUP_NTPrediction);
+
+static TAutoConsoleVariable<int32> CVarShowMoveHistory(
+	TEXT("nt.ShowMoveHistory"),
+	0,
+	TEXT("Draws the local cube's move history. Green moves were predicted cleanly, replayed moves go from yellow to red with the size of the correction."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarShowMoveHistoryMax(
+	TEXT("nt.ShowMoveHistoryMax"),
+	32,
+	TEXT("Most moves nt.ShowMoveHistory draws per cube, newest first."),
+	ECVF_Default);
+
 ANTPawn::ANTPawn(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
 	RootCollision = ObjectInitializer.CreateDefaultSubobject<UBoxComponent>(this, TEXT("RootCollision"));
-	RootCollision->SetSimulatePhysics(true);
+	// Kinematic - Every step goes through FCubeIntegrator, the same as a replay, so client and server integrate identically.
+	// PhysX doesn't move the body at all, so there's no engine gravity or contact solver - MoveBody sweeps instead.
+	RootCollision->SetSimulatePhysics(false);
 	RootCollision->SetCollisionResponseToAllChannels(ECR_Block);
+	RootCollision->SetNotifyRigidBodyCollision(true);
 	RootComponent = RootCollision;
 
 	RootMesh = ObjectInitializer.CreateDefaultSubobject<UStaticMeshComponent>(this, TEXT("RootMesh"));
@@ -44,11 +85,55 @@ ANTPawn::ANTPawn(const FObjectInitializer& ObjectInitializer) : Super(ObjectInit
 	PreviousPhysState = FCubeState();
 	CurrentPhysState = FCubeState();
 
-	SmoothAlpha = 0.f;
-	StartSmoothAlpha = 0.1f;
-	DefaultSmoothAlpha = 0.25f;
+	VisualPositionOffset = FVector::ZeroVector;
+	VisualRotationOffset = FQuat::Identity;
+	VisualErrorSmallDistance = 25.0f;
+	VisualErrorLargeDistance = 100.0f;
+	VisualErrorSmallHalfLife = 0.1f;
+	VisualErrorLargeHalfLife = 0.04f;
+	VisualErrorSnapDistance = 500.0f;
+
+	LastCorrectionKey = INDEX_NONE;
+	LastCorrectionError = 0.f;
 
 	MaxHistoryStates = 100;
+
+	bUseFixedTimestep = true;
+	FixedTickRate = 60.0f;
+	MaxCatchUpSteps = 5;
+	TickAccumulator = 0.f;
+	SimulationTimeScale = 1.f;
+	SimulationTick = 0;
+	ConsumedClientTick = 0;
+	bConsumedClientInput = false;
+
+	bUseImportantMoves = true;
+	InputRedundancy = 8;
+	InputSendInterval = 2;
+	LastInputSendTick = 0;
+
+	bAckMatchingPredictions = true;
+	LastAckedServerTick = INDEX_NONE;
+	LastReceivedServerTick = INDEX_NONE;
+
+	bUseCubeManager = true;
+	CubeManager = nullptr;
+	CubeIndex = INDEX_NONE;
+	CubeId = INDEX_NONE;
+	LastInteractionTime = -BIG_NUMBER;
+	CachedController = nullptr;
+
+	bInterpolateSnapshots = true;
+	bWasInterpolatingSnapshots = false;
+	PendingPush = FVector::ZeroVector;
+
+	bAllowRest = true;
+	RestLinearSpeed = 1.0f;
+	RestAngularSpeed = 1.0f;
+	RestTicks = 30;
+	bAtRest = false;
+	StillTicks = 0;
+	RestTick = INDEX_NONE;
 }
 
 void ANTPawn::PostInitializeComponents()
@@ -56,6 +141,104 @@ void ANTPawn::PostInitializeComponents()
 	Super::PostInitializeComponents();
 	StoredMoves.Resize(MaxHistoryStates);
 	ImportantMoves.Resize(MaxHistoryStates);
+	SentInputBatches.Resize(64); // A couple of seconds of batches, longer than the ack system waits for one
+	MeshBaseTransform = RootMesh->GetRelativeTransform();
+	InputBuffer.Reset(GetFixedDeltaTime());
+}
+
+void ANTPawn::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// The manager only runs fixed steps, anything else keeps ticking itself
+	if (bUseCubeManager && bUseFixedTimestep)
+	{
+		CubeManager = ANTCubeManager::Get(GetWorld());
+		if (CubeManager)
+		{
+			CubeManager->RegisterCube(this);
+			SetActorTickEnabled(false);
+		}
+	}
+
+	UpdateSnapshotInterpolation();
+}
+
+void ANTPawn::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (CubeManager)
+	{
+		CubeManager->UnregisterCube(this);
+		CubeManager = nullptr;
+	}
+
+	MoveLog.Close();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ANTPawn::OnRep_CubeId()
+{
+	if (CubeManager)
+	{
+		CubeManager->UpdateCubeId(this);
+	}
+}
+
+bool ANTPawn::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	// Our owner always needs us, and anything the grid doesn't know about is left to the engine
+	const ANTPlayerController* Viewer = Cast<ANTPlayerController>(RealViewer);
+	if (!Viewer || !Viewer->Relevancy.IsValid() || !CubeManager || CubeId == INDEX_NONE || bAlwaysRelevant || IsOwnedBy(ViewTarget) || IsOwnedBy(RealViewer) || this == ViewTarget)
+	{
+		return Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+	}
+
+	return Viewer->Relevancy.IsRelevant(CubeId);
+}
+
+void ANTPawn::NotifyHit(class UPrimitiveComponent* MyComp, AActor* Other, class UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit)
+{
+	Super::NotifyHit(MyComp, Other, OtherComp, bSelfMoved, HitLocation, HitNormal, NormalImpulse, Hit);
+	LastInteractionTime = GetWorld()->GetTimeSeconds();
+	WakeFromRest();
+}
+
+void ANTPawn::ApplySnapshotState(const FCubeState& State, int32 ServerTick)
+{
+	// We predict our own cube, ServerMoveData corrects it
+	if (IsLocallyControlled())
+	{
+		return;
+	}
+
+	if (IsInterpolatingSnapshots())
+	{
+		SnapshotInterpolator.AddSample(ServerTick * GetFixedDeltaTime(), State, GetWorld()->GetTimeSeconds());
+		return;
+	}
+
+	const FCubeState OriginalState = CurrentPhysState;
+	Snap(State);
+	BeginSmoothing(OriginalState);
+}
+
+void ANTPawn::UpdateSnapshotInterpolation()
+{
+	const bool bInterpolating = IsInterpolatingSnapshots();
+	if (bInterpolating == bWasInterpolatingSnapshots)
+	{
+		return;
+	}
+
+	bWasInterpolatingSnapshots = bInterpolating;
+	SnapshotInterpolator.Reset();
+}
+
+void ANTPawn::PostNetReceiveRole()
+{
+	Super::PostNetReceiveRole();
+	UpdateSnapshotInterpolation();
 }
 
 void ANTPawn::Tick(float DeltaSeconds)
@@ -64,44 +247,283 @@ void ANTPawn::Tick(float DeltaSeconds)
 
 	Super::Tick(DeltaSeconds);
 
+	if (bUseFixedTimestep)
+	{
+		// Run as many fixed steps as we have time banked for, up to the catch-up limit
+		const float FixedDeltaTime = GetFixedDeltaTime();
+		int32 NumSteps = 0;
+
+		TickAccumulator += DeltaSeconds * SimulationTimeScale;
+		while (TickAccumulator >= FixedDeltaTime && NumSteps < MaxCatchUpSteps)
+		{
+			SimulateStep(FixedDeltaTime);
+			TickAccumulator -= FixedDeltaTime;
+			NumSteps++;
+		}
+
+		// If we hit the limit, drop the backlog rather than carrying it into the next frame
+		if (TickAccumulator >= FixedDeltaTime)
+		{
+			TickAccumulator = FMath::Fmod(TickAccumulator, FixedDeltaTime);
+		}
+	}
+	else
+	{
+		SimulateStep(DeltaSeconds);
+	}
+
+	PostSimulate(DeltaSeconds);
+}
+
+void ANTPawn::PostSimulate(float DeltaSeconds)
+{
+	// Simulated proxies just show the snapshot playback - Nothing to smooth, and no history
+	if (IsInterpolatingSnapshots())
+	{
+		FCubeState RenderState;
+		if (SnapshotInterpolator.Sample(GetWorld()->GetTimeSeconds(), DeltaSeconds, RenderState))
+		{
+			CurrentPhysState = RenderState;
+			Interpolate(RenderState, RenderState, 1.f);
+		}
+		return;
+	}
+
+	UpdateVisualOffset(DeltaSeconds);
+	NT_DEBUG_MESSAGE(DeltaSeconds, FColor::Green, TEXT("Client Visual Error: %f"), VisualPositionOffset.Size());
+
+	VisualizeMoveHistory();
+}
+
+float ANTPawn::GetFixedDeltaTime() const
+{
+	return 1.f / FMath::Max(FixedTickRate, 1.f);
+}
+
+void ANTPawn::SimulateStep(float StepDeltaTime)
+{
+	BeginStep();
+
+	// Resting cubes only keep their tick and input playout moving, and so do cubes waiting on their Client's input
+	if (bAtRest || IsHoldingForInput())
+	{
+		return;
+	}
+
+	CalculateAccel(StepDeltaTime, InputStates);
+	EndStep(StepDeltaTime);
+}
+
+void ANTPawn::BeginStep()
+{
+	SimulationTick++;
+
+	// Server simulates exactly one of the Client's inputs per tick, in order
+	if (Role == ROLE_Authority && !IsLocallyControlled())
+	{
+		ConsumeBufferedInput();
+	}
+
+	// Applied here rather than when we were hit, so the result doesn't depend on which cube stepped first
+	if (!PendingPush.IsZero())
+	{
+		CurrentPhysState.Velocity += PendingPush;
+		PendingPush = FVector::ZeroVector;
+	}
+
+	if (bAtRest && InputStates.ToBits() != 0)
+	{
+		WakeFromRest();
+	}
+}
+
+void ANTPawn::EndStep(float StepDeltaTime)
+{
+	// Round the state to what the network carries before anything records, hashes or sends it. Every step then starts from
+	// a state both sides can reproduce exactly - ReplayHistory rounds its steps the same way.
+	CurrentPhysState.Quantize();
+
+	// If Server, Send State Back
+	// Steps the input buffer held for aren't any Client tick, so there's nothing for the Client to check them against
+	if (Role == ROLE_Authority && !IsLocallyControlled() && bConsumedClientInput)
+	{
+		SendServerMove();
+		MoveLog.WriteState(ConsumedClientTick, InputStates.ToBits(), StepDeltaTime, CurrentPhysState);
+	}
+
 	if (IsLocallyControlled())
- 	{
- 		// Store the Move in History.
- 		// The moves are stored at the time we *think* they'll be when they reach the server.
- 		UpdateHistoryBuffer(GetTimeFromController(true));
- 
- 		if (Role < ROLE_Authority)
- 		{
- 			Server_SimulateInput(InputStates);
- 		}
- 	}
- 
- 	CalculateAccel(DeltaSeconds, InputStates);
- 
-   	if (!bReplayingMoves)
-   	{
-   		SmoothToState(CurrentPhysState, SmoothAlpha);
-   	}
- 
- 	SmoothAlpha += (DefaultSmoothAlpha - SmoothAlpha) * DeltaSeconds;
- 	GEngine->AddOnScreenDebugMessage(-1, GetWorld()->GetDeltaSeconds(), FColor::Green, FString::Printf(TEXT("Client Smooth: %f"), SmoothAlpha));
- 
- 	VisualizeMoveHistory();
+	{
+		// Store the Move in History. State is recorded after the input is applied, which matches what the Server sends back.
+		// The moves are stored at the time we *think* they'll be when they reach the server.
+		const bool bInputChanged = StoredMoves.IsEmpty() || StoredMoves.GetInputBits(StoredMoves.GetNewestIndex()) != InputStates.ToBits();
+		UpdateHistoryBuffer(GetTimeFromController(true), StepDeltaTime);
+		MoveLog.WriteState(SimulationTick, InputStates.ToBits(), StepDeltaTime, CurrentPhysState);
+
+		if (Role < ROLE_Authority && (bInputChanged || SimulationTick - LastInputSendTick >= InputSendInterval))
+		{
+			SendInputBatch();
+		}
+	}
+
+	UpdateRestState();
+}
+
+void ANTPawn::UpdateRestState()
+{
+	// A player's cube never rests - Its owner needs a ServerMoveData every step for acks, hashes and input buffer slack,
+	// and the Server's input buffer would lose its place
+	if (!bAllowRest || Role != ROLE_Authority || IsPlayerControlled())
+	{
+		StillTicks = 0;
+		return;
+	}
+
+	const bool bStill = InputStates.ToBits() == 0
+		&& CurrentPhysState.Velocity.SizeSquared() < FMath::Square(RestLinearSpeed)
+		&& CurrentPhysState.AngularVelocity.SizeSquared() < FMath::Square(RestAngularSpeed);
+
+	StillTicks = bStill ? StillTicks + 1 : 0;
+	if (StillTicks >= RestTicks)
+	{
+		EnterRest();
+	}
+}
+
+void ANTPawn::EnterRest()
+{
+	bAtRest = true;
+	RestTick = SimulationTick;
+
+	// Nobody sends this cube input, so there's nothing left to replicate or tick for until it's hit.
+	// A cube that runs into us reports the hit to us as well as itself, and the hit wakes us.
+	SetNetDormancy(DORM_DormantAll);
+
+	if (!CubeManager)
+	{
+		SetActorTickEnabled(false);
+	}
+}
+
+void ANTPawn::WakeFromRest()
+{
+	StillTicks = 0;
+
+	if (!bAtRest)
+	{
+		return;
+	}
 
-	// Update Visual Mesh Before Rendering
-	Interpolate(PreviousPhysState, PreviousPhysState, 1.f);
+	bAtRest = false;
+
+	if (NetDormancy != DORM_Awake)
+	{
+		SetNetDormancy(DORM_Awake);
+	}
+
+	if (!CubeManager)
+	{
+		SetActorTickEnabled(true);
+	}
+}
+
+void ANTPawn::SendInputBatch()
+{
+	SCOPE_CYCLE_COUNTER(STAT_NTSendInputBatch);
+
+	if (StoredMoves.IsEmpty())
+	{
+		return;
+	}
+
+	// Always resend the last few inputs. Also reach back to the oldest transition the Server hasn't simulated yet.
+	const int32 NewestTick = StoredMoves.GetTick(StoredMoves.GetNewestIndex());
+	int32 FirstTick = NewestTick - InputRedundancy + 1;
+	if (bUseImportantMoves && !ImportantMoves.IsEmpty())
+	{
+		FirstTick = FMath::Min(FirstTick, ImportantMoves.Oldest().TickNumber);
+	}
+	FirstTick = FMath::Max3(FirstTick, StoredMoves.GetTick(0), NewestTick - FCubeInputBatch::MaxInputs + 1);
+
+	FCubeInputBatch Batch;
+	Batch.BaseTick = FirstTick;
+	Batch.AckedServerTick = LastReceivedServerTick;
+	Batch.Inputs.Reserve(NewestTick - FirstTick + 1);
+
+	for (uint32 i = StoredMoves.LowerBoundTick(FirstTick); i < StoredMoves.Num(); i++)
+	{
+		Batch.Inputs.Add(StoredMoves.GetInputBits(i));
+	}
+
+	// Hashes for the ticks predicted since the last batch, so the Server can tell us when there's nothing to correct
+	if (bAckMatchingPredictions)
+	{
+		const uint32 NumHashes = (uint32)FMath::Clamp(NewestTick - LastInputSendTick, 1, (int32)FCubeInputBatch::MaxStateHashes);
+		for (uint32 i = StoredMoves.Num() - FMath::Min(NumHashes, StoredMoves.Num()); i < StoredMoves.Num(); i++)
+		{
+			Batch.StateHashes.Add((uint32)StoredMoves.GetStateHash(i));
+		}
+	}
+
+	if (CachedController)
+	{
+		Batch.AckHeader = CachedController->AckSystem.WriteHeader(FPlatformTime::Seconds());
+
+		FCubeSentInputBatch SentBatch;
+		SentBatch.Sequence = Batch.AckHeader.Sequence;
+		SentBatch.BaseTick = Batch.BaseTick;
+		SentBatch.NewestTick = Batch.GetNewestTick();
+		SentInputBatches.Add(SentBatch);
+	}
+
+	LastInputSendTick = SimulationTick;
+	Server_SimulateInputBatch(Batch);
+	INC_DWORD_STAT(STAT_NTInputBatchesSent);
+}
+
+void ANTPawn::OnInputBatchesAcked(const TArray<uint16>& Sequences)
+{
+	int32 NewestAcked = INDEX_NONE;
+
+	for (const uint16 Sequence : Sequences)
+	{
+		for (uint32 i = 0; i < SentInputBatches.Num(); i++)
+		{
+			const FCubeSentInputBatch& SentBatch = SentInputBatches[i];
+			if (SentBatch.Sequence != Sequence)
+			{
+				continue;
+			}
+
+			// Batches reach back to the oldest transition, so the ones this carried are always the oldest we have
+			while (!ImportantMoves.IsEmpty() && ImportantMoves.Oldest().TickNumber >= SentBatch.BaseTick && ImportantMoves.Oldest().TickNumber <= SentBatch.NewestTick)
+			{
+				ImportantMoves.Remove();
+				INC_DWORD_STAT(STAT_NTImportantMovesAcked);
+			}
+
+			if (NewestAcked == INDEX_NONE || FNTAckSystem::IsNewer(Sequence, (uint16)NewestAcked))
+			{
+				NewestAcked = Sequence;
+			}
+			break;
+		}
+	}
+
+	// Anything sent before the newest acked batch is covered by it, whether or not its own ack ever turns up
+	while (NewestAcked != INDEX_NONE && !SentInputBatches.IsEmpty() && !FNTAckSystem::IsNewer(SentInputBatches.Oldest().Sequence, (uint16)NewestAcked))
+	{
+		SentInputBatches.Remove();
+	}
 }
 
 void ANTPawn::Interpolate(const FCubeState& FromState, const FCubeState& ToState, float Alpha /*= 1.f*/)
 {
 	const FVector NewPos = UKismetMathLibrary::VLerp(FromState.Position, ToState.Position, Alpha);
-	const FVector NewVel = UKismetMathLibrary::VLerp(FromState.Velocity, ToState.Velocity, Alpha);
-	const FVector NewAngVel = UKismetMathLibrary::VLerp(FromState.AngularVelocity, ToState.AngularVelocity, Alpha);
-	const FQuat NewOrienation = FQuat::Slerp(FromState.Rotation, ToState.Rotation, Alpha);
+	const FQuat NewOrientation = FQuat::Slerp(FromState.Rotation, ToState.Rotation, Alpha);
 
-	RootCollision->SetPhysicsLinearVelocity(NewVel);
-	RootCollision->SetPhysicsAngularVelocity(NewAngVel);
-	RootCollision->SetWorldLocationAndRotationNoPhysics(NewPos, NewOrienation.Rotator());
+	// The body is kinematic, so there's no velocity to give it - Only the transform matters. Teleport the body with it, so
+	// the cubes we predict sweep against where this one is drawn.
+	RootCollision->SetWorldLocationAndRotation(NewPos, NewOrientation);
 }
 
 void ANTPawn::SetupPlayerInputComponent(class UInputComponent* InputComponent)
@@ -121,78 +543,191 @@ void ANTPawn::SetupPlayerInputComponent(class UInputComponent* InputComponent)
  	InputComponent->BindAction("Right", EInputEvent::IE_Released, this, &ANTPawn::OnStopRight);
 }
 
-void ANTPawn::StartCorrection(const FCubeMove& TargetMove, const FCubeMove& SavedMove)
+void ANTPawn::OnRep_ServerMoveData()
 {
-	// Time different between current time and server time. AKA, how long we have to blend in MS
-	const uint32 TimeToMakeMove = GetTimeFromController(false) - TargetMove.TimeStamp;
+	SCOPE_CYCLE_COUNTER(STAT_NTOnRepServerMoveData);
 
-	// TODO - Use Acceleration Instead!
-	// Difference between the Clients' Velocity and the Target Velocity at that timestamp
-	const FVector CorrectiveVelocity = TargetMove.CubeState.Velocity - SavedMove.CubeState.Velocity;
-	const FVector CorrectiveAngVelocity = TargetMove.CubeState.AngularVelocity - SavedMove.CubeState.AngularVelocity;
-}
+	if (CachedController)
+	{
+		CachedController->TimeDilation.OnInputBufferReport(ServerMoveData.InputBufferSlack);
 
-void ANTPawn::OnRep_ServerMoveData()
-{
-	const FCubeState OriginalState = CurrentPhysState;
-	HistoryCorrection(this, ServerMoveData);
+		// Acks are good whatever else this move holds, even a baseline we've lost
+		TArray<uint16> AckedBatches;
+		CachedController->AckSystem.ReadHeader(ServerMoveData.AckHeader, FPlatformTime::Seconds(), AckedBatches);
+		if (AckedBatches.Num() > 0)
+		{
+			OnInputBatchesAcked(AckedBatches);
+		}
+	}
+
+	// The Server got the same state we predicted. Any correction still waiting is older, so it's moot too.
+	if (ServerMoveData.bPredictionMatched)
+	{
+		INC_DWORD_STAT(STAT_NTPredictionsAcked);
+
+		if (CubeManager)
+		{
+			CubeManager->CancelCorrection(this);
+		}
+
+		AcknowledgeMove(ServerMoveData.Move);
+		return;
+	}
+
+	// If the baseline this was compressed against has gone, wait for the Server to fall back to a full state
+	if (!ServerMoveData.ResolveBaseline(ReceivedBaselines))
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_NTCorrectionsReceived);
+	MoveLog.WriteCorrection(ServerMoveData.Move.TickNumber, ServerMoveData.ServerTick, ServerMoveData.Move.CubeState);
+
+	ServerMoveData.Move.RandHash = (int32)ServerMoveData.Quantized.GetHash();
+
+	// Only full states are baselines - Acks don't carry one
+	ReceivedBaselines.Add(ServerMoveData.ServerTick, ServerMoveData.Quantized);
+	LastReceivedServerTick = FMath::Max(LastReceivedServerTick, ServerMoveData.ServerTick);
 
-	if (OriginalState.Compare(CurrentPhysState))
+	// The manager collects this frame's corrections and replays them together
+	if (CubeManager)
 	{
-		BeginSmoothing();
+		CubeManager->QueueCorrection(this, ServerMoveData.Move);
+		return;
 	}
+
+	const FCubeState OriginalState = CurrentPhysState;
+	HistoryCorrection(this, ServerMoveData.Move);
+	BeginSmoothing(OriginalState);
 }
 
-void ANTPawn::UpdateHistoryBuffer(int32 ForTime)
+void ANTPawn::UpdateHistoryBuffer(int32 ForTime, float DeltaTime)
 {
 	FCubeMove NewMove;
 	NewMove.TimeStamp = ForTime;
+	NewMove.DeltaTime = DeltaTime;
+	NewMove.TickNumber = SimulationTick;
 	NewMove.CubeInput = InputStates;
-	NewMove.CubeState = CurrentPhysState;
+
+	// Same precision the Server sends corrections with, and hashed the same way it hashes its own state
+	FCubeQuantizedState Quantized;
+	Quantized.FromState(CurrentPhysState);
+	NewMove.CubeState = Quantized.ToState();
+	NewMove.RandHash = (int32)Quantized.GetHash();
 	AddMoveToHistory(NewMove);
 }
 
 void ANTPawn::CalculateAccel(float DeltaSeconds, const FCubeInput& FromInput)
 {
-	Accel = FVector::ZeroVector;
+	SCOPE_CYCLE_COUNTER(STAT_NTCalculateAccel);
+
+	Accel = FCubeIntegrator::GetInputAccel(FromInput, ForceStrength);
 	Alpha = FVector::ZeroVector;
 
-	/* Calculate Local Movement */
-	if (FromInput.Left) { Accel.X -= ForceStrength; }
-	if (FromInput.Right) { Accel.X += ForceStrength; }
-	if (FromInput.Forward) { Accel.Y -= ForceStrength; }
-	if (FromInput.Backward) { Accel.Y += ForceStrength; }
+	FCubeState NewState = CurrentPhysState;
+	FCubeIntegrator::Step(NewState, FromInput, DeltaSeconds, GetSimParams());
+	MoveBody(NewState);
+}
+
+void ANTPawn::MoveBody(const FCubeState& NewState)
+{
+	// The interpolator places these
+	if (IsInterpolatingSnapshots())
+	{
+		return;
+	}
+
+	CurrentPhysState = NewState;
 
-	FVector Veloc = RootCollision->GetPhysicsLinearVelocity();
-	FVector Omega = RootCollision->GetPhysicsAngularVelocity();
+	FHitResult Hit;
+	RootCollision->SetWorldLocationAndRotation(NewState.Position, NewState.Rotation, true, &Hit);
+	if (!Hit.bBlockingHit)
+	{
+		return;
+	}
 
-	Veloc += Accel * DeltaSeconds;
-	Omega += Alpha * DeltaSeconds;
+	// Already overlapping something, like a cube that was pushed into us - A sweep from here can't move at all, and moving
+	// without one could carry us through it. Push out along the hit normal first, then sweep the rest of the way.
+	if (Hit.bStartPenetrating)
+	{
+		// A little past the surface, so the sweep doesn't start touching it again
+		const FVector Depenetration = Hit.Normal * (Hit.PenetrationDepth + 0.125f);
+		RootCollision->SetWorldLocation(RootCollision->GetComponentLocation() + Depenetration);
 
-	RootCollision->SetPhysicsLinearVelocity(Accel * DeltaSeconds, true);
-	RootCollision->SetPhysicsAngularVelocity(Alpha * DeltaSeconds, true);
+		Hit.Reset();
+		RootCollision->SetWorldLocationAndRotation(NewState.Position, NewState.Rotation, true, &Hit);
+		if (!Hit.bBlockingHit)
+		{
+			return;
+		}
+	}
 
-	// Update Current Physics State
-	CurrentPhysState.Velocity = RootCollision->GetPhysicsLinearVelocity();
-	CurrentPhysState.AngularVelocity = RootCollision->GetPhysicsAngularVelocity();
+	// Contacts aren't part of the replay model - Stop where we hit, lose the velocity into the surface, and let corrections
+	// settle the rest. A cube we run into takes that velocity on at its next step, as an equal mass would.
 	CurrentPhysState.Position = RootCollision->GetComponentLocation();
-	CurrentPhysState.Rotation = RootCollision->GetComponentQuat();
 
-	// If Server, Send State Back
- 	if (Role == ROLE_Authority && !IsLocallyControlled())
- 	{
- 		FCubeMove NewMove = FCubeMove();
- 		NewMove.CubeInput = FromInput;
- 		NewMove.CubeState = CurrentPhysState;
- 		NewMove.TimeStamp = GetTimeFromController(false);
- 
- 		ServerMoveData = NewMove;
- 	}
+	const float IntoSurface = FVector::DotProduct(CurrentPhysState.Velocity, Hit.Normal);
+	if (IntoSurface < 0.f)
+	{
+		const FVector Transferred = Hit.Normal * IntoSurface;
+		CurrentPhysState.Velocity -= Transferred;
+
+		// Only the Server pushes other cubes. Clients get their new state from the Server.
+		ANTPawn* OtherCube = Cast<ANTPawn>(Hit.GetActor());
+		if (OtherCube && Role == ROLE_Authority)
+		{
+			OtherCube->PendingPush += Transferred;
+		}
+	}
+}
+
+void ANTPawn::SendServerMove()
+{
+	SCOPE_CYCLE_COUNTER(STAT_NTSendServerMove);
+
+	FCubeMove NewMove = FCubeMove();
+	NewMove.CubeInput = InputStates;
+	NewMove.CubeState = CurrentPhysState;
+	NewMove.TimeStamp = GetTimeFromController(false);
+	NewMove.TickNumber = ConsumedClientTick;
+
+	// Quantizes the state and delta compresses it against what the Client last acknowledged
+	ServerMoveData.SetState(NewMove, SimulationTick, SentBaselines, LastAckedServerTick);
+	ServerMoveData.InputBufferSlack = InputBuffer.GetDepth() - InputBuffer.GetTargetDepth();
+	ServerMoveData.AckHeader = CachedController ? CachedController->AckSystem.WriteAcks() : FNTAckHeader();
+
+	// If the Client predicted this exact state there's nothing to correct, so just ack it
+	uint32 ClientHash = 0;
+	const bool bHaveClientHash = bAckMatchingPredictions && ClientStateHashes.Find(ConsumedClientTick, ClientHash);
+	ServerMoveData.bPredictionMatched = bHaveClientHash && ClientHash == ServerMoveData.Quantized.GetHash();
+	INC_DWORD_STAT_BY(STAT_NTPredictionHashMismatches, (bHaveClientHash && !ServerMoveData.bPredictionMatched) ? 1 : 0);
+
+	// An ack carries no state, so the Client can't use it as a baseline
+	if (!ServerMoveData.bPredictionMatched)
+	{
+		SentBaselines.Add(SimulationTick, ServerMoveData.Quantized);
+	}
+}
+
+FCubeSimParams ANTPawn::GetSimParams() const
+{
+	FCubeSimParams Params;
+	Params.ForceStrength = ForceStrength;
+
+	const FBodyInstance* Body = RootCollision->GetBodyInstance();
+	if (Body)
+	{
+		Params.LinearDamping = Body->LinearDamping;
+		Params.AngularDamping = Body->AngularDamping;
+	}
+
+	return Params;
 }
 
 void ANTPawn::OnRep_ReplicatedMovement()
 {
-	if (GetNetMode() == NM_Client && IsLocallyControlled())
+	// Predicted or interpolated, either way we don't want the engine moving us
+	if (GetNetMode() == NM_Client && (IsLocallyControlled() || IsInterpolatingSnapshots()))
 	{
 		return;
 	}
@@ -202,81 +737,191 @@ void ANTPawn::OnRep_ReplicatedMovement()
 	}
 }
 
-void ANTPawn::Server_SimulateInput_Implementation(const FCubeInput& FromInput)
+void ANTPawn::Server_SimulateInputBatch_Implementation(const FCubeInputBatch& Batch)
+{
+	SCOPE_CYCLE_COUNTER(STAT_NTReceiveInputBatch);
+
+	if (Batch.AckedServerTick <= SimulationTick)
+	{
+		LastAckedServerTick = FMath::Max(LastAckedServerTick, Batch.AckedServerTick);
+	}
+
+	// Acks for our snapshots. They're sent unreliably on purpose, so the acks only go towards RTT and loss.
+	if (CachedController)
+	{
+		TArray<uint16> AckedSnapshots;
+		CachedController->AckSystem.ReadHeader(Batch.AckHeader, FPlatformTime::Seconds(), AckedSnapshots);
+	}
+
+	if (Batch.Inputs.Num() == 0)
+	{
+		return;
+	}
+
+	InputBuffer.OnBatchReceived(Batch.GetNewestTick(), FPlatformTime::Seconds());
+
+	const int32 FirstHashTick = Batch.GetNewestTick() - Batch.StateHashes.Num() + 1;
+	for (int32 i = 0; i < Batch.StateHashes.Num(); i++)
+	{
+		ClientStateHashes.Add(FirstHashTick + i, Batch.StateHashes[i]);
+	}
+
+	// Batches overlap and can arrive out of order, the buffer throws away anything it already has or is too late
+	const uint32 LateDropsBefore = InputBuffer.NumLateDrops;
+	int32 NumRejected = 0;
+
+	for (int32 i = 0; i < Batch.Inputs.Num(); i++)
+	{
+		if (!InputBuffer.Insert(Batch.BaseTick + i, Batch.Inputs[i]))
+		{
+			NumRejected++;
+		}
+	}
+
+	const uint32 NumLate = InputBuffer.NumLateDrops - LateDropsBefore;
+	INC_DWORD_STAT_BY(STAT_NTInputLateDrops, NumLate);
+	INC_DWORD_STAT_BY(STAT_NTRedundantInputs, NumRejected - NumLate);
+}
+
+void ANTPawn::ConsumeBufferedInput()
 {
-	InputStates = FromInput;
+	const uint32 UnderrunsBefore = InputBuffer.NumUnderruns;
+	const uint32 SkippedBefore = InputBuffer.NumSkipped;
+
+	int32 InputTick = INDEX_NONE;
+	InputStates.FromBits(InputBuffer.Consume(InputTick));
+
+	bConsumedClientInput = InputTick != INDEX_NONE;
+	if (bConsumedClientInput)
+	{
+		ConsumedClientTick = InputTick;
+	}
+
+	INC_DWORD_STAT_BY(STAT_NTInputUnderruns, InputBuffer.NumUnderruns - UnderrunsBefore);
+	INC_DWORD_STAT_BY(STAT_NTInputSkipped, InputBuffer.NumSkipped - SkippedBefore);
+	INC_DWORD_STAT_BY(STAT_NTInputBufferDepth, InputBuffer.GetDepth());
+	INC_DWORD_STAT_BY(STAT_NTInputBufferTarget, InputBuffer.GetTargetDepth());
 }
 
-bool ANTPawn::Server_SimulateInput_Validate(const FCubeInput& FromInput)
+bool ANTPawn::Server_SimulateInputBatch_Validate(const FCubeInputBatch& Batch)
 {
-	return true;
+	return Batch.Inputs.Num() <= FCubeInputBatch::MaxInputs && Batch.StateHashes.Num() <= FCubeInputBatch::MaxStateHashes;
 }
 
 void ANTPawn::VisualizeMoveHistory()
 {
-	if (IsLocallyControlled())
+#if ENABLE_DRAW_DEBUG
+	ULineBatchComponent* LineBatcher = GetWorld()->LineBatcher;
+	if (!LineBatcher || !IsLocallyControlled() || CVarShowMoveHistory.GetValueOnGameThread() == 0 || StoredMoves.IsEmpty())
+	{
+		return;
+	}
+
+	const uint32 NumToDraw = FMath::Min(StoredMoves.Num(), (uint32)FMath::Max(CVarShowMoveHistoryMax.GetValueOnGameThread(), 0));
+	const uint32 FirstIndex = StoredMoves.Num() - NumToDraw;
+
+	const FLinearColor CleanColour = FLinearColor::Green;
+	const float ErrorAlpha = FMath::Clamp(LastCorrectionError / FMath::Max(VisualErrorLargeDistance, 1.f), 0.f, 1.f);
+	const FLinearColor ReplayedColour = FMath::Lerp(FLinearColor::Yellow, FLinearColor::Red, ErrorAlpha);
+
+	// Unit cube corners, bit 0/1/2 picks the sign on X/Y/Z. Each edge joins two corners one bit apart.
+	static const uint8 Edges[12][2] = { { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 }, { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 }, { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 } };
+	const float HalfSize = 25.f;
+
+	TArray<FBatchedLine> Lines;
+	Lines.Reserve(NumToDraw * ARRAY_COUNT(Edges));
+
+	for (uint32 i = FirstIndex; i < StoredMoves.Num(); i++)
 	{
-		const FColor NewColour = FLinearColor(1.f, 1.f, 1.f, 0.5f).ToFColor(false);
-		for (uint32 i = 0; i < StoredMoves.GetArraySize(); i++)
+		const FVector Position = StoredMoves.GetPosition(i);
+		const FQuat Rotation = StoredMoves.GetRotation(i);
+		const FLinearColor& Colour = GetHistoryKey(i) <= LastCorrectionKey ? ReplayedColour : CleanColour;
+
+		FVector Corners[8];
+		for (int32 Corner = 0; Corner < 8; Corner++)
+		{
+			const FVector Local((Corner & 1) ? HalfSize : -HalfSize, (Corner & 2) ? HalfSize : -HalfSize, (Corner & 4) ? HalfSize : -HalfSize);
+			Corners[Corner] = Position + Rotation.RotateVector(Local);
+		}
+
+		for (const auto& Edge : Edges)
 		{
-			FCubeMove BufferedMove = StoredMoves[i];
-			DrawDebugBox(GetWorld(), BufferedMove.CubeState.Position, FVector(25.f, 25.f, 25.f), BufferedMove.CubeState.Rotation, NewColour, false, GetWorld()->GetDeltaSeconds() + 0.01f, 1);
+			Lines.Emplace(Corners[Edge[0]], Corners[Edge[1]], Colour, LineBatcher->DefaultLifeTime, 1.f, SDPG_World);
 		}
 	}
+
+	// One render state update for the whole history, rather than one per line
+	LineBatcher->DrawLines(Lines);
+#endif
 }
 
 /////////////////////////////////////////////
 ///// CLIENT RECIEVES SERVER CORRECTION /////
 /////////////////////////////////////////////
 
-void ANTPawn::Client_SendCorrection_Implementation(const FCubeMove& CorrectedMove)
+void ANTPawn::BeginSmoothing(const FCubeState& FromState)
 {
-	GEngine->AddOnScreenDebugMessage(-1, 1.f, FColor::Red, FString::Printf(TEXT("Client Recieved Correction: T %i Pos %f %f %f"), CorrectedMove.TimeStamp, CorrectedMove.CubeState.Position.X, CorrectedMove.CubeState.Position.Y, CorrectedMove.CubeState.Position.Z));
+	// Where the mesh was actually shown, offset included
+	const FVector ShownPosition = FromState.Position + VisualPositionOffset;
+	const FQuat ShownRotation = VisualRotationOffset * FromState.Rotation;
 
-	const FCubeState OriginalState = CurrentPhysState;
-	HistoryCorrection(this, CorrectedMove);
+	LastCorrectionError = (FromState.Position - CurrentPhysState.Position).Size();
+	LastCorrectionKey = StoredMoves.IsEmpty() ? INDEX_NONE : GetHistoryKey(StoredMoves.GetNewestIndex());
 
-	// Smooth to our actual physics state from what we currently are.
-	//if (OriginalState.Compare(CurrentPhysState))
-	//{
-//		BeginSmoothing();
-//	}
-}
+	if (CachedController && CachedController->SoakMonitor && IsLocallyControlled())
+	{
+		CachedController->SoakMonitor->RecordCorrection(LastCorrectionError);
+	}
 
-void ANTPawn::BeginSmoothing()
-{
-	SmoothAlpha = StartSmoothAlpha;
+	VisualPositionOffset = ShownPosition - CurrentPhysState.Position;
+	VisualRotationOffset = ShownRotation * CurrentPhysState.Rotation.Inverse();
+	VisualRotationOffset.Normalize();
+
+	if (VisualPositionOffset.SizeSquared() > FMath::Square(VisualErrorSnapDistance))
+	{
+		VisualPositionOffset = FVector::ZeroVector;
+		VisualRotationOffset = FQuat::Identity;
+	}
 }
 
-void ANTPawn::SmoothToState(const FCubeState& TargetState, float Alpha)
+void ANTPawn::UpdateVisualOffset(float DeltaSeconds)
 {
-	PreviousPhysState = CurrentPhysState;
-	CurrentPhysState = TargetState;
+	SCOPE_CYCLE_COUNTER(STAT_NTVisualSmoothing);
 
-	CurrentPhysState.Position = PreviousPhysState.Position + (TargetState.Position - PreviousPhysState.Position) * Alpha;
-	CurrentPhysState.Rotation = FQuat::Slerp(PreviousPhysState.Rotation, TargetState.Rotation, Alpha);
-	CurrentPhysState.Velocity = PreviousPhysState.Velocity + (TargetState.Velocity - PreviousPhysState.Velocity) * Alpha;
-	CurrentPhysState.AngularVelocity = PreviousPhysState.AngularVelocity + (TargetState.AngularVelocity - PreviousPhysState.AngularVelocity) * Alpha;
+	if (VisualPositionOffset.IsZero() && VisualRotationOffset.Equals(FQuat::Identity, 0.f))
+	{
+		return;
+	}
 
-	// TODO - Collision Check First!
-	//GetWorld()->EncroachingBlockingGeometry()
+	// Exponential decay, quicker for bigger errors
+	const float Error = VisualPositionOffset.Size();
+	const float LargeAlpha = FMath::Clamp(FMath::GetRangePct(VisualErrorSmallDistance, VisualErrorLargeDistance, Error), 0.f, 1.f);
+	const float HalfLife = FMath::Lerp(VisualErrorSmallHalfLife, VisualErrorLargeHalfLife, LargeAlpha);
+	const float Remaining = HalfLife > 0.f ? FMath::Exp2(-DeltaSeconds / HalfLife) : 0.f;
+
+	VisualPositionOffset *= Remaining;
+	VisualRotationOffset = FQuat::Slerp(FQuat::Identity, VisualRotationOffset, Remaining);
+
+	if (VisualPositionOffset.IsNearlyZero(0.01f) && VisualRotationOffset.Equals(FQuat::Identity, 1.e-4f))
+	{
+		VisualPositionOffset = FVector::ZeroVector;
+		VisualRotationOffset = FQuat::Identity;
+		RootMesh->SetRelativeTransform(MeshBaseTransform);
+		return;
+	}
 
-	// TODO - Location Blending would be better as opposed to a hard set!
-	RootCollision->SetWorldLocation(CurrentPhysState.Position);
-	RootCollision->SetWorldRotation(CurrentPhysState.Rotation.Rotator());
-	RootCollision->SetPhysicsLinearVelocity(CurrentPhysState.Velocity);
-	RootCollision->SetPhysicsAngularVelocity(CurrentPhysState.AngularVelocity);
+	// Offsets are in world space, on top of wherever the mesh normally sits on the body
+	const FTransform BaseWorldTransform = MeshBaseTransform * RootCollision->GetComponentTransform();
+	RootMesh->SetWorldLocationAndRotation(BaseWorldTransform.GetLocation() + VisualPositionOffset, VisualRotationOffset * BaseWorldTransform.GetRotation());
 }
 
 void ANTPawn::Snap(const FCubeState& NewState)
 {
+	WakeFromRest();
 	CurrentPhysState = NewState;
 
-	/* TODO - Commenting this out effectively stops the snapping, but shows the history in the right place. */
-	RootCollision->SetWorldLocation(NewState.Position);
-	RootCollision->SetWorldRotation(NewState.Rotation.Rotator());
-	RootCollision->SetPhysicsLinearVelocity(NewState.Velocity);
-	RootCollision->SetPhysicsAngularVelocity(NewState.AngularVelocity);
+	// One teleport for both, rather than one each. Velocities live in CurrentPhysState, the body is kinematic.
+	RootCollision->SetWorldLocationAndRotation(NewState.Position, NewState.Rotation);
 }
 
 //////////////////
@@ -371,9 +1016,58 @@ void ANTPawn::OnStopRight()
 	}
 }
 
+void ANTPawn::PossessedBy(AController* NewController)
+{
+	Super::PossessedBy(NewController);
+	CachedController = Cast<ANTPlayerController>(Controller);
+
+	// Resting cubes can be dormant, and a player needs a live channel
+	WakeFromRest();
+	UpdateMoveLog();
+}
+
+void ANTPawn::UnPossessed()
+{
+	Super::UnPossessed();
+	CachedController = nullptr;
+	UpdateMoveLog();
+}
+
+void ANTPawn::OnRep_Controller()
+{
+	Super::OnRep_Controller();
+	CachedController = Cast<ANTPlayerController>(Controller);
+	UpdateMoveLog();
+}
+
+void ANTPawn::UpdateMoveLog()
+{
+	const bool bShouldRecord = FNTMoveLogWriter::IsEnabled() && (IsLocallyControlled() || (Role == ROLE_Authority && IsPlayerControlled()));
+	if (bShouldRecord == MoveLog.IsOpen())
+	{
+		return;
+	}
+
+	if (!bShouldRecord)
+	{
+		MoveLog.Close();
+		return;
+	}
+
+	FNTMoveLogHeader Header;
+	Header.Role = Role == ROLE_Authority ? ENTMoveLogRole::Server : ENTMoveLogRole::Client;
+	Header.TickRate = FixedTickRate;
+	Header.SetSimParams(GetSimParams());
+	Header.StartTime = FDateTime::UtcNow().GetTicks();
+
+	const TCHAR* RoleName = Role == ROLE_Authority ? TEXT("Server") : TEXT("Client");
+	MoveLog.Open(FNTMoveLogWriter::MakePath(FString::Printf(TEXT("%s_Cube%i"), RoleName, CubeId)), Header);
+}
+
 int32 ANTPawn::GetTimeFromController(bool bNetworkTime)
 {
-	ANTPlayerController* LocalPC = Cast<ANTPlayerController>(GetController());
+	// Cast once when the Controller changes rather than every step
+	ANTPlayerController* LocalPC = CachedController;
 	if (LocalPC)
 	{
 		if (bNetworkTime)
@@ -398,10 +1092,7 @@ void ANTPawn::AddMoveToHistory(const FCubeMove& NewMove)
 	bool bImportant = true;
 	if (!StoredMoves.IsEmpty())
 	{
-		const FCubeMove& PreviousMove = StoredMoves.Newest();
-
-		// TODO: Could just Override the Operator in the struct for this!
-		bImportant = (NewMove.CubeInput.Forward != PreviousMove.CubeInput.Forward) || (NewMove.CubeInput.Backward != PreviousMove.CubeInput.Backward) || (NewMove.CubeInput.Left != PreviousMove.CubeInput.Left) || (NewMove.CubeInput.Right != PreviousMove.CubeInput.Right);
+		bImportant = NewMove.CubeInput.ToBits() != StoredMoves.GetInputBits(StoredMoves.GetNewestIndex());
 	}
 
 	if (bImportant)
@@ -412,98 +1103,92 @@ void ANTPawn::AddMoveToHistory(const FCubeMove& NewMove)
 	StoredMoves.Add(NewMove);
 }
 
-void ANTPawn::HistoryCorrection(ANTPawn* InActor, const FCubeMove& MoveData)
+int32 ANTPawn::GetMoveKey(const FCubeMove& Move) const
 {
-	const int32 Time = MoveData.TimeStamp;
+	// With a fixed timestep both sides agree on tick numbers, which are exact. Otherwise fall back to timestamps.
+	return bUseFixedTimestep ? Move.TickNumber : Move.TimeStamp;
+}
 
-	// Discard Out of Date Moves
-	while (ImportantMoves.Oldest().TimeStamp < Time && !ImportantMoves.IsEmpty())
-	{
-		ImportantMoves.Remove();
-	}
-	while (StoredMoves.Oldest().TimeStamp < Time && !StoredMoves.IsEmpty())
+int32 ANTPawn::GetHistoryKey(uint32 Index) const
+{
+	return bUseFixedTimestep ? StoredMoves.GetTick(Index) : StoredMoves.GetTimeStamp(Index);
+}
+
+void ANTPawn::HistoryCorrection(ANTPawn* InActor, const FCubeMove& MoveData)
+{
+	if (!PrepareCorrection(MoveData))
 	{
-		StoredMoves.Remove();
+		return;
 	}
 
+	// Rewind to Correction, and replay moves on plain data. The body is only touched once we're done.
+	const FCubeSimParams Params = InActor->GetSimParams();
+	InActor->bReplayingMoves = true;
+
+	const FCubeState ReplayState = ReplayHistory(MoveData.CubeState, Params);
+
+	InActor->Snap(ReplayState);
+	InActor->bReplayingMoves = false;
+}
+
+bool ANTPawn::PrepareCorrection(const FCubeMove& MoveData)
+{
+	SCOPE_CYCLE_COUNTER(STAT_NTCorrectionDiscard);
+
+	const int32 Time = GetMoveKey(MoveData);
+
+	// Discard Out of Date Moves
+	DiscardMovesBefore(Time);
+
 	// If we have no stored moves, then we want to exit out of here
 	if (StoredMoves.IsEmpty())
 	{
-		return;
+		return false;
 	}
 
-	FColor TextColor;
-
 	// Check if Timestamps are Equal - Which they may not be! We only really want to correct the right moves!
-	if (MoveData.TimeStamp != StoredMoves.Oldest().TimeStamp)
+	const bool bKeyMismatch = Time != GetHistoryKey(0);
+	INC_DWORD_STAT_BY(STAT_NTCorrectionKeyMismatches, bKeyMismatch ? 1 : 0);
+	NT_DEBUG_MESSAGE(5.0f, bKeyMismatch ? FColor::Red : FColor::Blue, TEXT("Recieved = %i - Stored = %i"), Time, GetHistoryKey(0));
+
+	// There's no move of ours at the correction's key, so no hash to check it against. If every move we'd replay is still
+	// within FCubeState::Compare's thresholds of it, we haven't gone anywhere the Server disagrees with - Nothing to replay.
+	if (bKeyMismatch)
 	{
-		TextColor = FColor::Red;
+		const bool bDiverged = StoredMoves.FindFirstDivergent(MoveData.CubeState, 0, StoredMoves.Num()) != INDEX_NONE;
+		INC_DWORD_STAT_BY(STAT_NTCorrectionMismatchesSkipped, bDiverged ? 0 : 1);
+		return bDiverged;
 	}
-	else
+
+	// Compare correction State with move history state. Both are quantized, so their hashes are enough when we have them.
+	if (MoveData.RandHash != 0)
 	{
-		TextColor = FColor::Blue;
-	}
-	
-	GEngine->AddOnScreenDebugMessage(-1, 5.0f, TextColor, FString::Printf(TEXT("Recieved = %i - Stored = %i"), MoveData.TimeStamp, StoredMoves.Oldest().TimeStamp));
-
-	// Compare the Moves at current time, to see if they are equal
-// 	if (MoveData.CubeState.Compare(StoredMoves.Oldest().CubeState))
-// 	{
-// 		// Discard Corrected Move
-// 		StoredMoves.Remove();
-// 
-// 		// Save Current Scene Data
-// 		FCubeInput SavedInput = InActor->InputStates;
-// 
-// 		// Rewind to Correction, and Replay Moves After the Corrected Move
-// 		InActor->bReplayingMoves = true;
-// 		InActor->InputStates = MoveData.CubeInput;
-// 
-// 		FVector AvgVelocity
-// 
-// 
-// 
-// 	}
-	
- 	// Compare correction State with move history state
- 	if (MoveData.CubeState != StoredMoves.Oldest().CubeState)
- 	{
- 		// Discard Corrected Move
- 		StoredMoves.Remove();
- 
- 		// Saved Current Scene Data
- 		int32 SavedTimeStamp = InActor->GetTimeFromController(true);
- 		FCubeInput SavedInput = InActor->InputStates;
- 
- 		// Rewind to Correction, and replay moves
- 		InActor->InputStates = MoveData.CubeInput;
- 
- 		// Dummy Current State
- 		//FCubePhysState
- 		InActor->Snap(MoveData.CubeState);
- 		InActor->bReplayingMoves = true;
- 
- 		uint32 i = StoredMoves.Tail;
- 
- 		while (i != StoredMoves.Head)
- 		{
- 			const int32 SceneTime = InActor->GetTimeFromController(true);
- 
- 			while (SceneTime < StoredMoves[i].TimeStamp)
- 			{
- 				InActor->UpdateHistoryBuffer(SceneTime);
- 			}
- 
- 			InActor->InputStates = StoredMoves[i].CubeInput;
- 			StoredMoves[i].CubeState = InActor->CurrentPhysState;
- 			StoredMoves.Next(i);
- 		}
- 
- 		InActor->UpdateHistoryBuffer(InActor->GetTimeFromController(true));
- 
- 		InActor->bReplayingMoves = false;
- 		InActor->InputStates = SavedInput;
- 	}
+		return MoveData.RandHash != StoredMoves.GetStateHash(0);
+	}
+
+	return MoveData.CubeState != StoredMoves.GetState(0);
+}
+
+void ANTPawn::AcknowledgeMove(const FCubeMove& MoveData)
+{
+	SCOPE_CYCLE_COUNTER(STAT_NTCorrectionDiscard);
+
+	// The acked move stays as the oldest, so a later correction still finds its key
+	DiscardMovesBefore(GetMoveKey(MoveData));
+}
+
+void ANTPawn::DiscardMovesBefore(int32 Key)
+{
+	auto MoveKey = [this](const FCubeMove& Move) { return GetMoveKey(Move); };
+	ImportantMoves.RemoveBefore(Key, MoveKey);
+	StoredMoves.RemoveOldest(bUseFixedTimestep ? StoredMoves.LowerBoundTick(Key) : StoredMoves.LowerBoundTimeStamp(Key));
+}
+
+FCubeState ANTPawn::ReplayHistory(const FCubeState& CorrectedState, const FCubeSimParams& Params)
+{
+	SCOPE_CYCLE_COUNTER(STAT_NTCorrectionReplay);
+
+	return FCubeIntegrator::ReplayHistory(StoredMoves, CorrectedState, Params);
 }
 
 ///////////////////////
@@ -515,4 +1200,5 @@ void ANTPawn::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeP
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
 	DOREPLIFETIME_CONDITION(ANTPawn, ServerMoveData, COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(ANTPawn, CubeId, COND_InitialOnly);
 }
\ No newline at end of file
@@ -3,8 +3,19 @@
 #pragma once
 
 #include "GameFramework/Pawn.h"
+#include "NTNetSerialization.h"
+#include "NTInputBuffer.h"
+#include "NTRingBuffer.h"
+#include "NTMoveHistory.h"
+#include "NTSnapshotInterpolator.h"
+#include "NTMoveLog.h"
+#include "NTAckSystem.h"
 #include "NTPawn.generated.h"
 
+struct FCubeSimParams;
+class ANTCubeManager;
+class ANTPlayerController;
+
 USTRUCT()
 struct FCubeState
 {
@@ -45,6 +56,13 @@ struct FCubeState
 		return false;
 	}
 
+	// Rounds the state the same way NetSerialize does, so local and replicated states can be compared exactly. Cubes do
+	// this at the end of every step, live and replayed, so Client and Server carry on from the same bits.
+	void Quantize();
+
+	// Bounded fixed-point position, smallest-three rotation and clamped velocities. See UNTNetSettings for precision.
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
 	FCubeState()
 		: Position(ForceInitToZero)
 		, Rotation(ForceInitToZero)
@@ -53,6 +71,15 @@ struct FCubeState
 	{}
 };
 
+template<>
+struct TStructOpsTypeTraits<FCubeState> : public TStructOpsTypeTraitsBase
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
 USTRUCT()
 struct FCubeInput
 {
@@ -67,6 +94,32 @@ struct FCubeInput
 	UPROPERTY()
 	bool Right;
 
+	// Packs the input into the low 4 bits
+	uint8 ToBits() const
+	{
+		return (Forward ? 1 : 0) | (Backward ? 2 : 0) | (Left ? 4 : 0) | (Right ? 8 : 0);
+	}
+
+	void FromBits(uint8 Bits)
+	{
+		Forward = (Bits & 1) != 0;
+		Backward = (Bits & 2) != 0;
+		Left = (Bits & 4) != 0;
+		Right = (Bits & 8) != 0;
+	}
+
+	bool operator==(const FCubeInput& Other) const
+	{
+		return ToBits() == Other.ToBits();
+	}
+
+	bool operator!=(const FCubeInput& Other) const
+	{
+		return !(*this == Other);
+	}
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
 	FCubeInput()
 		: Forward(false)
 		, Backward(false)
@@ -75,6 +128,15 @@ struct FCubeInput
 	{}
 };
 
+template<>
+struct TStructOpsTypeTraits<FCubeInput> : public TStructOpsTypeTraitsBase
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
 USTRUCT()
 struct FCubeMove
 {
@@ -83,126 +145,174 @@ struct FCubeMove
 	UPROPERTY()
 	int32 TimeStamp;
 	UPROPERTY()
-	int32 RandHash;
+	int32 TickNumber; // Fixed-step simulation tick this move was made on
+	UPROPERTY()
+	int32 RandHash; // FCubeQuantizedState::GetHash() of CubeState, or 0 if not known. Compared instead of the state.
 	UPROPERTY()
 	FCubeState CubeState;
 	UPROPERTY()
 	FCubeInput CubeInput;
 
+	// Length of the step this move was simulated over. Local only, used when replaying.
+	float DeltaTime;
+
 	FCubeMove()
 		: TimeStamp(0)
+		, TickNumber(0)
 		, RandHash(0)
 		, CubeState(FCubeState())
 		, CubeInput(FCubeInput())
+		, DeltaTime(0.f)
 	{}
+
+	// Compact tick / timestamp, 4 bit input and a quantized state
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+	void NetSerializeHeader(FArchive& Ar);
+};
+
+template<>
+struct TStructOpsTypeTraits<FCubeMove> : public TStructOpsTypeTraitsBase
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
 };
 
+/**
+ * Recent Client inputs, sent redundantly so a lost packet doesn't lose input. One entry per tick from BaseTick onwards,
+ * run-length encoded on the wire as 4 bit inputs.
+ */
 USTRUCT()
-struct FCubeMoveBuffer
+struct FCubeInputBatch
 {
 	GENERATED_USTRUCT_BODY()
 
-	uint32 Head;
-	uint32 Tail;
+	enum { MaxInputs = 128 };
+	enum { MaxStateHashes = 16 };
+
+	// Client tick of the first input
+	UPROPERTY()
+	int32 BaseTick;
+
+	// Newest ServerTick the Client has received, so the Server can pick a delta baseline
+	UPROPERTY()
+	int32 AckedServerTick;
+
+	// Sequence for the Server to ack, and the Client's acks for the Server's snapshots
+	FNTAckHeader AckHeader;
 
-	FCubeMoveBuffer()
-		: Head(0)
-		, Tail(0)
+	// Input bits, see FCubeInput::ToBits()
+	UPROPERTY()
+	TArray<uint8> Inputs;
+
+	// Hashes of the predicted state for the newest ticks, ending at GetNewestTick(). Only ticks new since the last batch.
+	UPROPERTY()
+	TArray<uint32> StateHashes;
+
+	FCubeInputBatch()
+		: BaseTick(0)
+		, AckedServerTick(INDEX_NONE)
 	{}
 
-	// Re-sizes the Move Buffer
-	void Resize(uint32 NewSize)
+	int32 GetNewestTick() const
 	{
-		Head = 0;
-		Tail = 0;
-		MoveArray.SetNumUninitialized(NewSize);
+		return BaseTick + Inputs.Num() - 1;
 	}
 
-	// Gets current size of Move Buffer
-	uint32 GetSize()
-	{
-		uint32 Count = Head - Tail;
-		if (Count < 0)
-		{
-			Count += MoveArray.Num();
-		}
-		return Count;
-	}
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
 
-	uint32 GetArraySize()
+template<>
+struct TStructOpsTypeTraits<FCubeInputBatch> : public TStructOpsTypeTraitsBase
+{
+	enum
 	{
-		return (uint32)MoveArray.Num();
-	}
+		WithNetSerializer = true,
+	};
+};
 
-	// Adds Move to Move Buffer
-	void Add(const FCubeMove& NewMove)
-	{
-		MoveArray[Head] = NewMove;
-		Next(Head);
-	}
+/**
+ * State sent from the Server to the owning Client. Delta compressed against the newest state the Client has acknowledged,
+ * or sent in full when there's no valid baseline.
+ */
+USTRUCT()
+struct FCubeServerMove
+{
+	GENERATED_USTRUCT_BODY()
 
-	// Removes Oldest Move from Buffer
-	void Remove()
-	{
-		ensure(!IsEmpty());
-		Next(Tail);
-	}
+	UPROPERTY()
+	FCubeMove Move;
 
-	// Returns Oldest Move
-	FCubeMove& Oldest()
-	{
-		//check(!IsEmpty());
-		return MoveArray[Tail];
-	}
+	// Server simulation tick this was sent on. The Client acknowledges these to make them baselines.
+	UPROPERTY()
+	int32 ServerTick;
 
-	// Returns the latest move
-	FCubeMove& Newest()
-	{
-		//check(!IsEmpty());
-		int32 Index = Head - 1;
-		if (Index == -1)
-		{
-			Index = MoveArray.Num() - 1;
-		}
-		return MoveArray[Index];
-	}
+	// Server tick of the baseline this is a delta against, or INDEX_NONE for a full state
+	UPROPERTY()
+	int32 BaselineTick;
 
-	// Determines if we have any saved moves or not
-	bool IsEmpty() const
-	{
-		return Head == Tail;
-	}
+	// Server input buffer depth minus its target, in ticks. The Client adjusts its simulation rate to bring this to zero.
+	UPROPERTY()
+	int32 InputBufferSlack;
 
-	// Finds next Array Index
-	void Next(uint32& Index)
-	{
-		Index++;
-		if (Index >= (uint32)MoveArray.Num())
-		{
-			Index -= MoveArray.Num();
-		}
-	}
+	// The Client's predicted state for Move.TickNumber hashed the same as ours. Sent as a plain ack, with no state.
+	UPROPERTY()
+	bool bPredictionMatched;
+
+	// The Server's acks for the Client's input batches, so they come back every step rather than at the snapshot rate.
+	// Carries no sequence of its own - See FNTAckSystem::WriteAcks.
+	FNTAckHeader AckHeader;
+
+	uint8 DeltaFlags;
+	FCubeQuantizedState Quantized;
+	FCubeQuantizedState Delta;
+
+	FCubeServerMove()
+		: Move(FCubeMove())
+		, ServerTick(0)
+		, BaselineTick(INDEX_NONE)
+		, InputBufferSlack(0)
+		, bPredictionMatched(false)
+		, DeltaFlags(0)
+	{}
 
-	// Finds Previous Array Index
-	void Previous(uint32& Index)
-	{
-		Index--;
-		if (Index < 0)
-		{
-			Index += MoveArray.Num();
-		}
-	}
+	// Server - Quantizes the move and picks a baseline for it
+	void SetState(const FCubeMove& NewMove, int32 NewServerTick, const FCubeBaselineBuffer& SentBaselines, int32 AckedServerTick);
 
-	// Operator Overload to extract a certain move
-	FCubeMove& operator[](uint32 Index)
-	{
-		ensure(Index >= 0);
-		ensure(Index < (uint32)MoveArray.Num());
-		return MoveArray[Index];
-	}
+	// Client - Rebuilds the full state from the baseline. Returns false if we no longer have it.
+	bool ResolveBaseline(const FCubeBaselineBuffer& ReceivedBaselines);
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
 
 private:
-	TArray<FCubeMove> MoveArray;
+	void SerializePayload(FArchive& Ar);
+};
+
+template<>
+struct TStructOpsTypeTraits<FCubeServerMove> : public TStructOpsTypeTraitsBase
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/* Moves, oldest first. Keyed by GetMoveKey(), which only ever increases. */
+typedef TNTRingBuffer<FCubeMove> FCubeMoveBuffer;
+
+/* Client - The ticks an input batch carried. Once its sequence is acked, the Server has every input in the range. */
+struct FCubeSentInputBatch
+{
+	uint16 Sequence;
+	int32 BaseTick;
+	int32 NewestTick;
+
+	FCubeSentInputBatch()
+		: Sequence(0)
+		, BaseTick(0)
+		, NewestTick(0)
+	{}
 };
 
 UCLASS()
@@ -211,19 +321,25 @@ class NTGAME_API ANTPawn : public APawn
 	GENERATED_BODY()
 
 public:
-	FCubeMoveBuffer StoredMoves;
+	FNTMoveHistory StoredMoves;
 	FCubeMoveBuffer ImportantMoves;
 
 	ANTPawn(const FObjectInitializer& ObjectInitializer);
 	virtual void PostInitializeComponents() override;
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void Tick(float DeltaSeconds) override;
+	virtual void PossessedBy(AController* NewController) override;
+	virtual void UnPossessed() override;
+	virtual void OnRep_Controller() override;
+	virtual void PostNetReceiveRole() override;
 	virtual void SetupPlayerInputComponent(class UInputComponent* InputComponent) override;
 
 	// Current / Previous Physics States
 	FCubeState CurrentPhysState;
 	FCubeState PreviousPhysState;
 
-	/* If true, server will send important moves to get around Packet Loss */
+	/* If true, input transitions are resent in every batch until the Server acks a batch that carried them, to get around Packet Loss */
 	bool bUseImportantMoves;
 
 	UPROPERTY()
@@ -236,50 +352,277 @@ public:
 
 	bool bReplayingMoves;
 
-	float StartSmoothAlpha;
-	float DefaultSmoothAlpha;
-	float SmoothAlpha;
+	// --- VISUAL SMOOTHING ------------------------------------------------------------
+	/* Corrections snap the body once. The jump is kept here and applied to RootMesh only, decaying towards zero. */
+	FVector VisualPositionOffset;
+	FQuat VisualRotationOffset;
+
+	/* Moves up to this key were replayed by the last correction, which moved the body this far. Colours the history visualizer. */
+	int32 LastCorrectionKey;
+	float LastCorrectionError;
+
+	/* Rest state, see bAllowRest */
+	bool bAtRest;
+	int32 StillTicks;
+	int32 RestTick;
+
+	/* After each step - Counts still ticks and puts the cube to rest once there are enough */
+	void UpdateRestState();
+	void EnterRest();
+
+	/* RootMesh's relative transform with no offset applied */
+	FTransform MeshBaseTransform;
+
+	/* Errors up to this size decay with the small half-life */
+	UPROPERTY(EditDefaultsOnly, Category = "Smoothing")
+	float VisualErrorSmallDistance;
+
+	/* Errors from this size up decay with the large half-life. In between, the half-life is blended. */
+	UPROPERTY(EditDefaultsOnly, Category = "Smoothing")
+	float VisualErrorLargeDistance;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Smoothing")
+	float VisualErrorSmallHalfLife;
+
+	/* Shorter than the small half-life, so big errors don't hang around */
+	UPROPERTY(EditDefaultsOnly, Category = "Smoothing")
+	float VisualErrorLargeHalfLife;
+
+	/* Errors bigger than this aren't worth hiding - Just let the mesh jump */
+	UPROPERTY(EditDefaultsOnly, Category = "Smoothing")
+	float VisualErrorSnapDistance;
 
 	UPROPERTY(EditDefaultsOnly, Category = "Network")
 	uint32 MaxHistoryStates;
 
-	void StartCorrection(const FCubeMove& TargetMove, const FCubeMove& SavedMove);
+	// --- FIXED TIMESTEP --------------------------------------------------------------
+	/* If true, the simulation runs in fixed steps of 1 / FixedTickRate rather than the frame delta */
+	UPROPERTY(EditDefaultsOnly, Category = "Network")
+	bool bUseFixedTimestep;
+
+	/* Simulation rate in Hz when using a fixed timestep. Must match between Client and Server */
+	UPROPERTY(EditDefaultsOnly, Category = "Network")
+	float FixedTickRate;
+
+	/* Maximum number of fixed steps run in a single frame, so a hitch can't spiral */
+	UPROPERTY(EditDefaultsOnly, Category = "Network")
+	int32 MaxCatchUpSteps;
+
+	/* Unsimulated time carried over to the next frame */
+	float TickAccumulator;
+
+	/* Client - Rate the local simulation runs at, set by ANTPlayerController's time dilation. 1 is real time. */
+	float SimulationTimeScale;
+
+	/* Number of the latest simulation step. Local moves are tagged with this */
+	int32 SimulationTick;
+
+	/* On the Server, the Client tick of the input we're currently simulating */
+	int32 ConsumedClientTick;
+
+	/* On the Server, false while the input buffer is holding - The cube doesn't step, and gets no ServerMoveData. See IsHoldingForInput. */
+	bool bConsumedClientInput;
+
+	/* Length of a single simulation step */
+	float GetFixedDeltaTime() const;
+
+	/* Runs a single simulation step - Records History, Sends Input and Integrates Forces */
+	void SimulateStep(float StepDeltaTime);
+
+	/* Start of a step - Advances the tick and picks up this tick's input */
+	void BeginStep();
+	/* End of a step, once forces are applied - Sends State to the Client, or Records History and Sends Input */
+	void EndStep(float StepDeltaTime);
+	/* Once per frame after simulating - Visual Smoothing, Debug and Visuals */
+	void PostSimulate(float DeltaSeconds);
+
+	// --- CUBE MANAGER ----------------------------------------------------------------
+	/* If true, this cube is stepped by the world's ANTCubeManager along with every other cube, instead of ticking itself */
+	UPROPERTY(EditDefaultsOnly, Category = "Network")
+	bool bUseCubeManager;
+
+	UPROPERTY(Transient)
+	ANTCubeManager* CubeManager;
+
+	/* Our slot in the manager's arrays, or INDEX_NONE */
+	int32 CubeIndex;
+
+	/* Network-wide id, handed out by the Server's manager. Snapshots refer to cubes by this. */
+	UPROPERTY(ReplicatedUsing = "OnRep_CubeId")
+	int32 CubeId;
+
+	UFUNCTION()
+	void OnRep_CubeId();
+
+	/* Other Clients see us if we're in their controller's relevancy cache. Falls back to the engine's distance check without one. */
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
+	// --- SNAPSHOTS -------------------------------------------------------------------
+	/* Server - World time we last hit something. Recently hit cubes are prioritised in snapshots. */
+	float LastInteractionTime;
+
+	virtual void NotifyHit(class UPrimitiveComponent* MyComp, AActor* Other, class UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit) override;
+
+	/* Client - Authoritative state for a cube we don't control, from a snapshot */
+	void ApplySnapshotState(const FCubeState& State, int32 ServerTick);
+
+	// --- INTERPOLATION ---------------------------------------------------------------
+	/* If true, cubes we don't control play back snapshots through SnapshotInterpolator instead of snapping to them */
+	UPROPERTY(EditDefaultsOnly, Category = "Network")
+	bool bInterpolateSnapshots;
+
+	/* Client - Snapshot states for a simulated proxy, waiting to be shown */
+	FNTSnapshotInterpolator SnapshotInterpolator;
+
+	bool IsInterpolatingSnapshots() const { return bInterpolateSnapshots && Role == ROLE_SimulatedProxy; }
+
+	/* Starts playback afresh when we start or stop interpolating. Called when our Role might have changed. */
+	void UpdateSnapshotInterpolation();
+	bool bWasInterpolatingSnapshots;
+
+	// --- REST ------------------------------------------------------------------------
+	/* Server - Unpossessed cubes that sit still with no input stop stepping, recording history and replicating until input, contact or a correction wakes them */
+	UPROPERTY(EditDefaultsOnly, Category = "Rest")
+	bool bAllowRest;
+
+	/* Below this speed, in cm/s, a cube counts as still */
+	UPROPERTY(EditDefaultsOnly, Category = "Rest")
+	float RestLinearSpeed;
+
+	/* Below this angular speed, in degrees/s, a cube counts as still */
+	UPROPERTY(EditDefaultsOnly, Category = "Rest")
+	float RestAngularSpeed;
+
+	/* Ticks in a row a cube has to be still, with no input, before it rests */
+	UPROPERTY(EditDefaultsOnly, Category = "Rest")
+	int32 RestTicks;
+
+	bool IsAtRest() const { return bAtRest; }
+
+	/* Server - The input buffer had nothing from the Client for this step. The cube holds where it is rather than stepping on
+	 * a guess, so when the input does arrive the Server simulates it from the same state the Client did. */
+	bool IsHoldingForInput() const { return Role == ROLE_Authority && Controller && !IsLocallyControlled() && !bConsumedClientInput; }
+
+	/* SimulationTick the cube last came to rest on. Tells one rest apart from the next. */
+	int32 GetRestTick() const { return RestTick; }
+
+	/* Goes back to stepping and replicating. Safe to call on a cube that isn't resting. */
+	void WakeFromRest();
+
+	// --- MOVE LOG --------------------------------------------------------------------
+	/* Every tick's state, and every correction, when run with -NTMoveLog. Read back with the NTReplayLog commandlet. */
+	FNTMoveLogWriter MoveLog;
+
+	/* Opens or closes the log as possession changes - Our own cube on a Client, every player's cube on the Server */
+	void UpdateMoveLog();
+
+	UBoxComponent* GetRootCollision() const { return RootCollision; }
+	float GetForceStrength() const { return ForceStrength; }
 
 	// Called on Client when we recieve new move data from the Server
 	UFUNCTION()
 	void OnRep_ServerMoveData();
 
 	UPROPERTY(ReplicatedUsing = "OnRep_ServerMoveData")
-	FCubeMove ServerMoveData;
+	FCubeServerMove ServerMoveData;
+
+	/* Server - States we've sent to the owning Client. ServerMoveData only goes to the owner, so this is per-connection. */
+	FCubeBaselineBuffer SentBaselines;
+	/* Client - States we've received, for resolving deltas against */
+	FCubeBaselineBuffer ReceivedBaselines;
+
+	/* If true, the Client sends hashes of its predicted states and the Server only sends a full correction when they don't match its own */
+	UPROPERTY(EditDefaultsOnly, Category = "Network")
+	bool bAckMatchingPredictions;
+
+	/* Server - Hashes of the Client's predicted states, by Client tick */
+	FCubeStateHashBuffer ClientStateHashes;
 
-	void UpdateHistoryBuffer(int32 ForTime);
+	/* Server - Newest ServerTick the Client has acknowledged */
+	int32 LastAckedServerTick;
+	/* Client - Newest ServerTick we've received and decoded */
+	int32 LastReceivedServerTick;
+
+	void UpdateHistoryBuffer(int32 ForTime, float DeltaTime);
 
 	void AddMoveToHistory(const FCubeMove& NewMove);
+	/* Key used to match moves against corrections - Tick Number or TimeStamp */
+	int32 GetMoveKey(const FCubeMove& Move) const;
+	/* GetMoveKey() for a move in StoredMoves */
+	int32 GetHistoryKey(uint32 Index) const;
 	void HistoryCorrection(ANTPawn* InActor, const FCubeMove& MoveData);
-
+	/* Game Thread - Discards moves older than the correction. Returns true if the rest need replaying. */
+	bool PrepareCorrection(const FCubeMove& MoveData);
+	/* The Server agreed with our prediction for this move - Discards older moves, with nothing to replay */
+	void AcknowledgeMove(const FCubeMove& MoveData);
+	/* Drops history and important moves keyed before Key */
+	void DiscardMovesBefore(int32 Key);
+	/* Replays history from the corrected state and returns where the body should be now. Only touches StoredMoves, so corrections for different cubes can replay in parallel. */
+	FCubeState ReplayHistory(const FCubeState& CorrectedState, const FCubeSimParams& Params);
+
+	/* One fixed step from CurrentPhysState through FCubeIntegrator, written to the body */
 	void CalculateAccel(float DeltaSeconds, const FCubeInput& FromInput);
-	void SmoothToState(const FCubeState& TargetState, float Alpha);
+	/* Sweeps the kinematic body to an integrated state. A blocking hit stops it short, and CurrentPhysState follows. */
+	void MoveBody(const FCubeState& NewState);
+	/* Server - Velocity from cubes that ran into us, added at the start of our next step */
+	FVector PendingPush;
+	/* Server - Quantizes the current state into ServerMoveData for the owning Client */
+	void SendServerMove();
+	/* Parameters for replaying moves through FCubeIntegrator */
+	FCubeSimParams GetSimParams() const;
+	/* Moves the body. Only for corrections and the like, never every frame - it's a teleport, with no sweep. */
 	void Snap(const FCubeState& NewState);
-	void BeginSmoothing();
+	/* After a Snap - Keeps the mesh where it was shown in FromState, to decay into the body over the next few frames */
+	void BeginSmoothing(const FCubeState& FromState);
+	/* Decays the visual offset and places RootMesh */
+	void UpdateVisualOffset(float DeltaSeconds);
 
 	// Updates Visual Elements
 	void Interpolate(const FCubeState& FromState, const FCubeState& ToState, float Alpha = 1.f);
 
 	virtual void OnRep_ReplicatedMovement() override;
 
+	// --- INPUT BATCHING ---------------------------------------------------------------
+	/* Number of recent inputs resent in every batch, so we survive packet loss without reliable RPCs */
+	UPROPERTY(EditDefaultsOnly, Category = "Network")
+	int32 InputRedundancy;
+
+	/* Send a batch every this many ticks. Input transitions are always sent straight away. */
+	UPROPERTY(EditDefaultsOnly, Category = "Network")
+	int32 InputSendInterval;
+
+	/* Client - Tick we last sent an input batch on */
+	int32 LastInputSendTick;
+
+	/* Client - Batches sent under a sequence and not yet acked, oldest first */
+	TNTRingBuffer<FCubeSentInputBatch> SentInputBatches;
+
+	/* Client - The Server has these batches. Important moves they carried don't need sending again. */
+	void OnInputBatchesAcked(const TArray<uint16>& Sequences);
+
+	/* Server - Inputs received but not yet simulated, played out one per tick */
+	FNTInputJitterBuffer InputBuffer;
+
+	/* Client - Builds a batch from history and sends it */
+	void SendInputBatch();
+
+	/* Server - Takes the input for this tick from the jitter buffer */
+	void ConsumeBufferedInput();
+
 	UFUNCTION(Server, Unreliable, WithValidation)
-	void Server_SimulateInput(const FCubeInput& FromInput);
-	virtual void Server_SimulateInput_Implementation(const FCubeInput& FromInput);
-	virtual bool Server_SimulateInput_Validate(const FCubeInput& FromInput);
+	void Server_SimulateInputBatch(const FCubeInputBatch& Batch);
+	virtual void Server_SimulateInputBatch_Implementation(const FCubeInputBatch& Batch);
+	virtual bool Server_SimulateInputBatch_Validate(const FCubeInputBatch& Batch);
 
+	/* nt.ShowMoveHistory - Draws the newest live moves as boxes through the world's line batcher, in one submission */
 	void VisualizeMoveHistory();
 	int32 GetTimeFromController(bool bNetworkTime);
 
-protected:
-	UFUNCTION(Client, Unreliable)
-	void Client_SendCorrection(const FCubeMove& CorrectedMove);
-	void Client_SendCorrection_Implementation(const FCubeMove& CorrectedMove);
+	/* Controller, already cast. Updated when possession changes. */
+	UPROPERTY(Transient)
+	ANTPlayerController* CachedController;
 
+protected:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "ForceCube")
 	float ForceStrength;
 
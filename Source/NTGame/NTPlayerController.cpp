@@ -2,20 +2,42 @@
 
 #include "NTGame.h"
 #include "NTPlayerState.h"
+#include "NTPawn.h"
+#include "NTCubeManager.h"
+#include "NTNetSettings.h"
+#include "NTSoakMonitor.h"
 #include "NTPlayerController.h"
 
+DECLARE_DWORD_COUNTER_STAT(TEXT("Connections In Bad Mode"), STAT_NTBadConnections, STATGROUP_NTNet);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Snapshot Rate (All Connections)"), STAT_NTSnapshotRate, STATGROUP_NTNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Snapshot Budget (All Connections)"), STAT_NTSnapshotBudget, STATGROUP_NTNet);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Client Time Dilation"), STAT_NTTimeDilation, STATGROUP_NTNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Relevant Cubes (All Connections)"), STAT_NTRelevantCubes, STATGROUP_NTNet);
+DECLARE_CYCLE_STAT(TEXT("Update Relevancy"), STAT_NTUpdateRelevancy, STATGROUP_NTNet);
+
 ANTPlayerController::ANTPlayerController(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
 	// Latency
-	T_ClientSentRequest = 0;
-	T_ServerOffsetTime = 0;
-
-	bHasValidTimestamp = false;
+	AccumulativeDeltaTime = 0.0;
 
 	PredictionFudgeFactor = 15.0f;
 	MaxPredictionPing = 0.f;
 	DesiredPredictionPing = 0.f;
 	ServerMaxPredictionPing = 160.0f;
+
+	// Snapshots
+	LastSnapshotTick = INDEX_NONE;
+	CubeManager = nullptr;
+
+	// Congestion Control
+	ReportedRTT = 0.f;
+	ReportedRTTVariance = 0.f;
+	ReportedLoss = 0.f;
+	ConnectionMode = ENTConnectionMode::Good;
+
+	// Soak Testing
+	bIsBot = false;
+	SoakMonitor = nullptr;
 }
 
 void ANTPlayerController::BeginPlay()
@@ -26,6 +48,17 @@ void ANTPlayerController::BeginPlay()
 	{
 		ServerNegotiatePredictionPing(DesiredPredictionPing);
 	}
+
+	if (ANTSoakMonitor::IsEnabled())
+	{
+		SoakMonitor = ANTSoakMonitor::Get(GetWorld());
+	}
+
+	if (IsLocalController() && FNTBotInput::IsEnabled())
+	{
+		bIsBot = true;
+		BotInput.InitFromCommandLine(FCommandLine::Get());
+	}
 }
 
 void ANTPlayerController::Tick(float DeltaSeconds)
@@ -34,23 +67,49 @@ void ANTPlayerController::Tick(float DeltaSeconds)
 
 	AccumulativeDeltaTime += DeltaSeconds;
 
+	ANTPawn* NTPawn = Cast<ANTPawn>(GetPawn());
+	if (bIsBot && NTPawn)
+	{
+		BotInput.Update(DeltaSeconds);
+		NTPawn->InputStates.FromBits(BotInput.GetInputBits());
+	}
+
+	if (GetNetMode() == NM_Client)
+	{
+		UpdateClockSync(DeltaSeconds);
+		UpdateTimeDilation(DeltaSeconds);
+	}
+
 	// If we're the Client and we haven't updated Ping in a while, try to get a ping update
 	const float LocTimeSec = GetWorld()->GetTimeSeconds();
 	if (((LocTimeSec - LastPingCalcTime) > 0.5f) && (GetNetMode() == NM_Client))
 	{
 		LastPingCalcTime = LocTimeSec;
 		ServerBouncePing(LocTimeSec);
+		ConnectionQuality.OnPingSent(LocTimeSec);
+	}
+
+	// Server side for remote Clients, or the Client itself. Nothing to control on a local connection.
+	if (!IsLocalController() || GetNetMode() == NM_Client)
+	{
+		UpdateCongestionControl(DeltaSeconds);
+	}
+
+	if (Role == ROLE_Authority && !IsLocalController())
+	{
+		UpdateRelevancy(DeltaSeconds);
+		UpdateSnapshots(DeltaSeconds);
 	}
 
 	if (PlayerState)
 	{
 		if (Role == ROLE_Authority && !IsLocalController())
 		{
-			GEngine->AddOnScreenDebugMessage(-1, DeltaSeconds, FColor::Blue, FString::Printf(TEXT("Server Ping %f - TimeStamp %i"), PlayerState->ExactPing, GetLocalTime()));
+			NT_DEBUG_MESSAGE(DeltaSeconds, FColor::Blue, TEXT("Server Ping %f - TimeStamp %i"), PlayerState->ExactPing, GetLocalTime());
 		}
 		else if (Role < ROLE_Authority)
 		{
-			GEngine->AddOnScreenDebugMessage(-1, DeltaSeconds, FColor::Green, FString::Printf(TEXT("Client Ping %f - TimeStamp %i"), PlayerState->ExactPing, GetNetworkTime()));
+			NT_DEBUG_MESSAGE(DeltaSeconds, FColor::Green, TEXT("Client Ping %f - TimeStamp %i"), PlayerState->ExactPing, GetNetworkTime());
 		}
 	}
 }
@@ -71,6 +130,9 @@ void ANTPlayerController::ClientReturnPing_Implementation(float TimeStamp)
 	{
 		NTPS->CalculatePing(GetWorld()->GetTimeSeconds() - TimeStamp);
 	}
+
+	ConnectionQuality.OnPingReturned(TimeStamp, GetWorld()->GetTimeSeconds());
+	ServerReportConnectionQuality(ConnectionQuality.SmoothedRTT, ConnectionQuality.RTTVariance, ConnectionQuality.Loss);
 }
 
 void ANTPlayerController::ServerUpdatePing_Implementation(float ExactPing)
@@ -82,6 +144,66 @@ void ANTPlayerController::ServerUpdatePing_Implementation(float ExactPing)
 	}
 }
 
+//////////////////////////////
+///// CONGESTION CONTROL /////
+//////////////////////////////
+
+void ANTPlayerController::ServerReportConnectionQuality_Implementation(float RTT, float RTTVariance, float Loss)
+{
+	ReportedRTT = RTT;
+	ReportedRTTVariance = RTTVariance;
+	ReportedLoss = Loss;
+}
+
+bool ANTPlayerController::ServerReportConnectionQuality_Validate(float RTT, float RTTVariance, float Loss)
+{
+	return RTT >= 0.f && RTTVariance >= 0.f && Loss >= 0.f && Loss <= 1.f;
+}
+
+void ANTPlayerController::UpdateCongestionControl(float DeltaSeconds)
+{
+	const UNTNetSettings* Settings = GetDefault<UNTNetSettings>();
+	ANTPawn* NTPawn = Cast<ANTPawn>(GetPawn());
+	const ANTPawn* DefaultPawn = NTPawn ? NTPawn->GetClass()->GetDefaultObject<ANTPawn>() : nullptr;
+
+	AckSystem.Update(FPlatformTime::Seconds());
+
+	if (Role < ROLE_Authority)
+	{
+		ConnectionQuality.Update(GetWorld()->GetTimeSeconds());
+
+		if (NTPawn)
+		{
+			const int32 IntervalScale = ConnectionMode == ENTConnectionMode::Bad ? Settings->CongestionBadInputIntervalScale : 1;
+			NTPawn->InputSendInterval = DefaultPawn->InputSendInterval * IntervalScale;
+		}
+		return;
+	}
+
+	// Every snapshot is a measurement once the Client acks them, rather than a ping every half second
+	if (AckSystem.HasRTTSample())
+	{
+		CongestionControl.Update(DeltaSeconds, AckSystem.GetSmoothedRTT(), AckSystem.GetRTTVariance(), AckSystem.GetLoss());
+	}
+	else
+	{
+		CongestionControl.Update(DeltaSeconds, ReportedRTT, ReportedRTTVariance, ReportedLoss);
+	}
+	ConnectionMode = CongestionControl.GetMode();
+
+	SnapshotSender.SendRate = Settings->SnapshotRate * CongestionControl.GetRateScale();
+	SnapshotSender.ByteBudget = FMath::Max(FMath::RoundToInt(Settings->SnapshotByteBudget * CongestionControl.GetBudgetScale()), 64);
+
+	if (NTPawn)
+	{
+		NTPawn->NetUpdateFrequency = DefaultPawn->NetUpdateFrequency * CongestionControl.GetRateScale();
+	}
+
+	INC_DWORD_STAT_BY(STAT_NTBadConnections, ConnectionMode == ENTConnectionMode::Bad ? 1 : 0);
+	INC_FLOAT_STAT_BY(STAT_NTSnapshotRate, SnapshotSender.SendRate);
+	INC_DWORD_STAT_BY(STAT_NTSnapshotBudget, SnapshotSender.ByteBudget);
+}
+
 ///////////////////////////////////////
 ///// PREDICTION PING CALCULATION /////
 ///////////////////////////////////////
@@ -96,56 +218,151 @@ float ANTPlayerController::GetPredictionTime()
 	return (PlayerState && (GetNetMode() != NM_Standalone)) ? (0.0005f * FMath::Clamp(PlayerState->ExactPing - PredictionFudgeFactor, 0.f, MaxPredictionPing)) : 0.f;
 }
 
+void ANTPlayerController::UpdateTimeDilation(float DeltaSeconds)
+{
+	ANTPawn* NTPawn = Cast<ANTPawn>(GetPawn());
+	if (!NTPawn)
+	{
+		TimeDilation.Reset();
+		return;
+	}
+
+	// Past the negotiated prediction ping, we don't run any further ahead of the Server. Zero means no limit.
+	const bool bAllowSpeedUp = MaxPredictionPing <= 0.f || ConnectionQuality.SmoothedRTT * 1000.0f < MaxPredictionPing;
+	TimeDilation.Update(DeltaSeconds, bAllowSpeedUp);
+
+	const float TimeScale = TimeDilation.GetTimeScale();
+	NTPawn->SimulationTimeScale = TimeScale;
+	if (NTPawn->CubeManager)
+	{
+		NTPawn->CubeManager->SimulationTimeScale = TimeScale;
+	}
+
+	SET_FLOAT_STAT(STAT_NTTimeDilation, TimeScale);
+}
+
 void ANTPlayerController::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
 	DOREPLIFETIME_CONDITION(ANTPlayerController, MaxPredictionPing, COND_OwnerOnly);
 	DOREPLIFETIME_CONDITION(ANTPlayerController, PredictionFudgeFactor, COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(ANTPlayerController, ConnectionMode, COND_OwnerOnly);
 }
 
-////////////////////////////////////
-///// OLD TIME STAMP FUNCTIONS /////
-////////////////////////////////////
+//////////////////////
+///// CLOCK SYNC /////
+//////////////////////
 
 int32 ANTPlayerController::GetLocalTime()
 {
-	return FMath::FloorToInt(AccumulativeDeltaTime * 1000.0f);
+	return FMath::FloorToInt(AccumulativeDeltaTime * 1000.0);
 }
 
 int32 ANTPlayerController::GetNetworkTime()
 {
-	return GetLocalTime() + T_ServerOffsetTime;
+	return FMath::FloorToInt(ClockSync.GetServerTime(AccumulativeDeltaTime) * 1000.0);
 }
 
-void ANTPlayerController::ClientRequestNewTimeStamp()
+void ANTPlayerController::UpdateClockSync(float DeltaSeconds)
 {
-	if (Role < ROLE_Authority)
+	if (ClockSync.ShouldSendRequest(AccumulativeDeltaTime))
 	{
-		bHasValidTimestamp = false;
-		T_ClientSentRequest = GetLocalTime();
-		Server_ClientRequestedTimeStamp();
+		ClockSync.OnRequestSent(AccumulativeDeltaTime);
+		ServerRequestClockSync(AccumulativeDeltaTime);
 	}
+
+	ClockSync.Update(AccumulativeDeltaTime, DeltaSeconds);
 }
 
-void ANTPlayerController::Server_ClientRequestedTimeStamp_Implementation()
+void ANTPlayerController::ServerRequestClockSync_Implementation(double ClientTime)
 {
-	// Send back with Stamp
-	Client_ServerSentTimeStamp(GetLocalTime());
+	ClientReceiveClockSync(ClientTime, AccumulativeDeltaTime);
 }
 
-bool ANTPlayerController::Server_ClientRequestedTimeStamp_Validate()
+bool ANTPlayerController::ServerRequestClockSync_Validate(double ClientTime)
 {
 	return true;
 }
 
-void ANTPlayerController::Client_ServerSentTimeStamp_Implementation(int32 ServerTimeStamp)
+void ANTPlayerController::ClientReceiveClockSync_Implementation(double ClientTime, double ServerTime)
 {
-	// Calculate Servers System Time at the moment we actually sent the request for it.
-	int32 RTT = GetLocalTime() - T_ClientSentRequest;
-	
-	// Difference between both values
-	T_ServerOffsetTime = (ServerTimeStamp - (RTT / 2)) - T_ClientSentRequest;
+	ClockSync.OnResponse(ClientTime, ServerTime, AccumulativeDeltaTime);
+}
+
+/////////////////////
+///// SNAPSHOTS /////
+/////////////////////
+
+ANTCubeManager* ANTPlayerController::GetCubeManager()
+{
+	if (!CubeManager)
+	{
+		CubeManager = ANTCubeManager::Get(GetWorld());
+	}
+
+	return CubeManager;
+}
+
+void ANTPlayerController::UpdateSnapshots(float DeltaSeconds)
+{
+	FCubeSnapshot Snapshot;
+	if (SnapshotSender.Update(DeltaSeconds, GetCubeManager(), GetPawn(), &Relevancy, Snapshot))
+	{
+		Snapshot.AckHeader = AckSystem.WriteHeader(FPlatformTime::Seconds());
+		Client_ReceiveSnapshot(Snapshot);
+	}
+}
 
-	bHasValidTimestamp = true;
-}
\ No newline at end of file
+void ANTPlayerController::UpdateRelevancy(float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_NTUpdateRelevancy);
+
+	ANTCubeManager* Manager = GetCubeManager();
+	const FNTSpatialGrid* Grid = Manager ? Manager->GetRelevancyGrid() : nullptr;
+	const APawn* ViewPawn = GetPawn();
+
+	if (!Grid || !ViewPawn)
+	{
+		Relevancy.Invalidate();
+		return;
+	}
+
+	Relevancy.Update(DeltaSeconds, *Grid, ViewPawn->GetActorLocation());
+	INC_DWORD_STAT_BY(STAT_NTRelevantCubes, Relevancy.GetRelevant().Num());
+}
+
+void ANTPlayerController::Client_ReceiveSnapshot_Implementation(const FCubeSnapshot& Snapshot)
+{
+	// Acks are good even on a snapshot that's too old to apply
+	TArray<uint16> AckedBatches;
+	AckSystem.ReadHeader(Snapshot.AckHeader, FPlatformTime::Seconds(), AckedBatches);
+
+	ANTPawn* NTPawn = Cast<ANTPawn>(GetPawn());
+	if (NTPawn && AckedBatches.Num() > 0)
+	{
+		NTPawn->OnInputBatchesAcked(AckedBatches);
+	}
+
+	if (Snapshot.ServerTick <= LastSnapshotTick)
+	{
+		return;
+	}
+
+	LastSnapshotTick = Snapshot.ServerTick;
+
+	ANTCubeManager* Manager = GetCubeManager();
+	if (!Manager)
+	{
+		return;
+	}
+
+	for (const FCubeSnapshotEntry& Entry : Snapshot.Entries)
+	{
+		ANTPawn* Cube = Manager->FindCube(Entry.CubeId);
+		if (Cube)
+		{
+			Cube->ApplySnapshotState(Entry.State.ToState(), Snapshot.ServerTick);
+		}
+	}
+}
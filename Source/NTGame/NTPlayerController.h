@@ -3,6 +3,13 @@
 #pragma once
 
 #include "GameFramework/PlayerController.h"
+#include "NTSnapshot.h"
+#include "NTSpatialGrid.h"
+#include "NTAckSystem.h"
+#include "NTCongestionControl.h"
+#include "NTClockSync.h"
+#include "NTTimeDilation.h"
+#include "NTBotInput.h"
 #include "NTPlayerController.generated.h"
 
 /**
@@ -18,7 +25,8 @@ public:
 	virtual void BeginPlay() override;
 	virtual void Tick(float DeltaSeconds) override;
 
-	float AccumulativeDeltaTime;
+	/* Local clock, in seconds. Double so TimeStamps keep their millisecond precision in long sessions. */
+	double AccumulativeDeltaTime;
 
 	// --- TIMESTAMP / PING FUNCTIONALITY ----------------------------------------------
 	UPROPERTY()
@@ -64,32 +72,96 @@ public:
 	/* Return amount of time to tick to make up for network latency */
 	virtual float GetPredictionTime();
 
+	/* Client - Speeds up or slows down our simulation to keep the Server's input buffer for us at its target */
+	FNTTimeDilation TimeDilation;
+
+	/* Client - Updates time dilation and applies it to our pawn, and the cube manager if it has one */
+	void UpdateTimeDilation(float DeltaSeconds);
+
 	// --- END TIMESTAMP FUNCTIONALITY ---------------------------------------------------
 
 
 	// --- TIMESTAMP FUNCTIONALITY -------------------------------------------------------
-	/* TimeStamp Vars. int32 Gives a Maximum of 596 Hours of Play-Time */
-	int32 T_ClientSentRequest; // Client System time when it asked for Server System Time.
-	int32 T_ServerOffsetTime; // How far behind / ahead of the server we are.
-
-	/* True when we have received a valid timestamp. Invalidated when we request a new one */
-	bool bHasValidTimestamp;
+	/* Client - Estimate of the Server's clock. Requests go out on a fixed cadence, independent of ping updates. */
+	FNTClockSync ClockSync;
 
 	/* Get System Time in MS as int32 */
 	int32 GetLocalTime();
 	/* Get Current Time on the Server */
 	int32 GetNetworkTime();
-	/* Invalidate Client TimeStamp and Resend the Request */
-	void ClientRequestNewTimeStamp();
-
-	/* Request that the server tell us to calculate time offset */
-	UFUNCTION(Server, Reliable, WithValidation)
-	void Server_ClientRequestedTimeStamp();
-	virtual void Server_ClientRequestedTimeStamp_Implementation();
-	virtual bool Server_ClientRequestedTimeStamp_Validate();
-
-	/* Called by Server on Client. We can use the time the function was called to work out what the latency is. */
-	UFUNCTION(Client, Reliable)
-	void Client_ServerSentTimeStamp(int32 ServerTimeStamp);
-	virtual void Client_ServerSentTimeStamp_Implementation(int32 ServerTimeStamp);
+
+	/* Client asks for the Server's time. Our own time is echoed back, so lost or reordered replies don't matter. */
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void ServerRequestClockSync(double ClientTime);
+	virtual void ServerRequestClockSync_Implementation(double ClientTime);
+	virtual bool ServerRequestClockSync_Validate(double ClientTime);
+
+	UFUNCTION(Client, Unreliable)
+	void ClientReceiveClockSync(double ClientTime, double ServerTime);
+	virtual void ClientReceiveClockSync_Implementation(double ClientTime, double ServerTime);
+
+	/* Client - Sends requests when due and slews the offset */
+	void UpdateClockSync(float DeltaSeconds);
+
+	// --- SNAPSHOTS ---------------------------------------------------------------------
+	/* Server - Picks which cubes go into each snapshot for this connection */
+	FNTSnapshotSender SnapshotSender;
+
+	/* Client - Newest snapshot applied. Older ones arriving out of order are dropped. */
+	int32 LastSnapshotTick;
+
+	UPROPERTY(Transient)
+	ANTCubeManager* CubeManager;
+
+	ANTCubeManager* GetCubeManager();
+
+	/* Server - Builds and sends a snapshot when one is due */
+	void UpdateSnapshots(float DeltaSeconds);
+
+	UFUNCTION(Client, Unreliable)
+	void Client_ReceiveSnapshot(const FCubeSnapshot& Snapshot);
+	virtual void Client_ReceiveSnapshot_Implementation(const FCubeSnapshot& Snapshot);
+
+	// --- RELEVANCY ---------------------------------------------------------------------
+	/* Server - Cubes near our pawn, from the manager's grid. ANTPawn::IsNetRelevantFor and snapshots both ask this. */
+	FNTRelevancyCache Relevancy;
+
+	/* Server - Requeries the grid when it's due. Invalid while we have no pawn, which falls back to the engine's checks. */
+	void UpdateRelevancy(float DeltaSeconds);
+
+	// --- CONGESTION CONTROL ------------------------------------------------------------
+	/* Client - RTT and Loss from our ping bounces */
+	FNTConnectionQuality ConnectionQuality;
+
+	/* Server - Mode switching, driven by what the Client reports */
+	FNTCongestionControl CongestionControl;
+
+	/* Server - Last connection quality reported by the Client. Only used until the ack system has measurements of its own. */
+	float ReportedRTT;
+	float ReportedRTTVariance;
+	float ReportedLoss;
+
+	/* Sequences and acks on input batches and snapshots. The Server's per-message RTT and loss drive congestion control. */
+	FNTAckSystem AckSystem;
+
+	/* Current mode, decided by the Server. The Client sends input less often in Bad mode. */
+	UPROPERTY(Replicated)
+	ENTConnectionMode ConnectionMode;
+
+	UFUNCTION(Unreliable, Server, WithValidation)
+	void ServerReportConnectionQuality(float RTT, float RTTVariance, float Loss);
+	virtual void ServerReportConnectionQuality_Implementation(float RTT, float RTTVariance, float Loss);
+	virtual bool ServerReportConnectionQuality_Validate(float RTT, float RTTVariance, float Loss);
+
+	/* Server - Updates the mode and scales snapshot and move rates to match. Client - Scales input send rate. */
+	void UpdateCongestionControl(float DeltaSeconds);
+
+	// --- SOAK TESTING ------------------------------------------------------------------
+	/* Drives our pawn when run with -NTBot */
+	FNTBotInput BotInput;
+	bool bIsBot;
+
+	/* Metrics for this world when run with -NTSoak, otherwise null */
+	UPROPERTY(Transient)
+	class ANTSoakMonitor* SoakMonitor;
 };
\ No newline at end of file
@@ -27,7 +27,6 @@ void ANTPlayerState::CalculatePing(float NewPing)
 		if (ExactPing != OldPing)
 		{
 			PC->ServerUpdatePing(ExactPing); // Tell the Server to Update our Ping
-			PC->ClientRequestNewTimeStamp(); // Update the Clients' Local TimeStamp
 		}
 	}
 }
\ No newline at end of file
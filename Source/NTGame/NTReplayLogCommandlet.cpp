@@ -0,0 +1,181 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NTGame.h"
+#include "NTBinarySearch.h"
+#include "NTCubeIntegrator.h"
+#include "NTMoveLog.h"
+#include "NTReplayLogCommandlet.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogNTReplayLog, Log, All);
+
+namespace
+{
+	/* First index whose tick is not less than Tick, or Ticks.Num() */
+	int32 LowerBoundTick(const TArray<int32>& Ticks, int32 Tick)
+	{
+		return FNTBinarySearch::LowerBound(Ticks.Num(), [&Ticks, Tick](int32 Index) { return Ticks[Index] < Tick; });
+	}
+}
+
+UNTReplayLogCommandlet::UNTReplayLogCommandlet(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+void UNTReplayLogCommandlet::FDivergenceTracker::AddSample(int32 Tick, float Error, float Threshold, TArray<FDivergencePoint>& Points)
+{
+	NumSamples++;
+	TotalError += Error;
+	MaxError = FMath::Max(MaxError, Error);
+
+	const bool bOverThreshold = Error > Threshold;
+	if (bOverThreshold && !bDiverged)
+	{
+		FDivergencePoint Point = { Kind, Tick, Error };
+		Points.Add(Point);
+	}
+
+	bDiverged = bOverThreshold;
+}
+
+int32 UNTReplayLogCommandlet::Main(const FString& Params)
+{
+	FString LogPath;
+	if (!FParse::Value(*Params, TEXT("Log="), LogPath))
+	{
+		UE_LOG(LogNTReplayLog, Error, TEXT("Usage: -run=NTReplayLog -Log=<path> [-Threshold=<cm>] [-MaxPoints=<n>] [-Csv=<path>]"));
+		return 1;
+	}
+
+	float Threshold = 2.0f;
+	int32 MaxPoints = 20;
+	FParse::Value(*Params, TEXT("Threshold="), Threshold);
+	FParse::Value(*Params, TEXT("MaxPoints="), MaxPoints);
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	FNTMoveLogReader Reader;
+	if (!Reader.Open(LogPath))
+	{
+		return 1;
+	}
+
+	const FNTMoveLogHeader& Header = Reader.GetHeader();
+	const FCubeSimParams SimParams = Header.GetSimParams();
+	const bool bClientLog = Header.Role == ENTMoveLogRole::Client;
+
+	FDivergenceTracker Simulation(TEXT("Simulation"));
+	FDivergenceTracker Correction(TEXT("Correction"));
+	TArray<FDivergencePoint> Points;
+
+	// Predicted positions, for the corrections to be checked against. Client ticks only ever go up.
+	TArray<int32> PredictedTicks;
+	TArray<FVector> PredictedPositions;
+
+	FNTMoveLogRecord Record;
+	FNTMoveLogRecord Previous;
+	bool bHasPrevious = false;
+	int64 NumRecords = 0;
+	int64 NumStates = 0;
+	int64 NumCorrections = 0;
+	int64 NumUnmatched = 0;
+
+	while (Reader.Next(Record))
+	{
+		NumRecords++;
+
+		if (Record.Type == ENTMoveLogRecordType::State)
+		{
+			NumStates++;
+
+			// Same model as a replay - Step the previous state on with this tick's input, then round it as the cubes do
+			if (bHasPrevious)
+			{
+				FCubeInput Input;
+				Input.FromBits(Record.InputBits);
+
+				FCubeState Simulated = Previous.ToState();
+				FCubeIntegrator::Step(Simulated, Input, Record.DeltaTime, SimParams);
+				Simulated.Quantize();
+
+				Simulation.AddSample(Record.Tick, FVector::Dist(Simulated.Position, Record.Position), Threshold, Points);
+			}
+
+			Previous = Record;
+			bHasPrevious = true;
+
+			if (bClientLog)
+			{
+				PredictedTicks.Add(Record.Tick);
+				PredictedPositions.Add(Record.Position);
+			}
+		}
+		else if (Record.Type == ENTMoveLogRecordType::Correction)
+		{
+			NumCorrections++;
+
+			const int32 Index = LowerBoundTick(PredictedTicks, Record.Tick);
+			if (Index < PredictedTicks.Num() && PredictedTicks[Index] == Record.Tick)
+			{
+				Correction.AddSample(Record.Tick, FVector::Dist(PredictedPositions[Index], Record.Position), Threshold, Points);
+			}
+			else
+			{
+				NumUnmatched++;
+			}
+		}
+	}
+
+	const double Elapsed = FPlatformTime::Seconds() - StartTime;
+	const float TickRate = FMath::Max(Header.TickRate, 1.f);
+
+	UE_LOG(LogNTReplayLog, Display, TEXT("%s log, %.1f MB %s, %lld records in %.3f s"),
+		bClientLog ? TEXT("Client") : TEXT("Server"), Reader.GetSize() / (1024.0 * 1024.0), Reader.IsMapped() ? TEXT("mapped") : TEXT("loaded"), NumRecords, Elapsed);
+	UE_LOG(LogNTReplayLog, Display, TEXT("%lld states (%.1f minutes at %.0f Hz), %lld corrections, %lld with no predicted state to check against"),
+		NumStates, NumStates / (TickRate * 60.0f), TickRate, NumCorrections, NumUnmatched);
+
+	for (const FDivergenceTracker* Tracker : { &Simulation, &Correction })
+	{
+		if (Tracker->NumSamples > 0)
+		{
+			UE_LOG(LogNTReplayLog, Display, TEXT("%-10s %lld checked, mean error %.3f cm, max %.3f cm"),
+				Tracker->Kind, (int64)Tracker->NumSamples, Tracker->TotalError / Tracker->NumSamples, Tracker->MaxError);
+		}
+	}
+
+	UE_LOG(LogNTReplayLog, Display, TEXT("%i divergence points over %.2f cm"), Points.Num(), Threshold);
+	for (int32 i = 0; i < FMath::Min(Points.Num(), MaxPoints); i++)
+	{
+		const FDivergencePoint& Point = Points[i];
+		UE_LOG(LogNTReplayLog, Display, TEXT("  %-10s Tick %-8i %9.2f s  %8.2f cm"), Point.Kind, Point.Tick, Point.Tick / TickRate, Point.Error);
+	}
+
+	FString CsvPath;
+	if (FParse::Value(*Params, TEXT("Csv="), CsvPath))
+	{
+		WriteCsv(CsvPath, Points);
+	}
+
+	return 0;
+}
+
+void UNTReplayLogCommandlet::WriteCsv(const FString& Path, const TArray<FDivergencePoint>& Points) const
+{
+	FString Output = TEXT("kind,tick,error_cm\n");
+	for (const FDivergencePoint& Point : Points)
+	{
+		Output += FString::Printf(TEXT("%s,%i,%.3f\n"), Point.Kind, Point.Tick, Point.Error);
+	}
+
+	if (FFileHelper::SaveStringToFile(Output, *Path))
+	{
+		UE_LOG(LogNTReplayLog, Display, TEXT("Divergence points written to %s"), *Path);
+	}
+	else
+	{
+		UE_LOG(LogNTReplayLog, Error, TEXT("Couldn't write divergence points to %s"), *Path);
+	}
+}
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "NTReplayLogCommandlet.generated.h"
+
+/**
+ * Re-simulates a move log offline and reports where it diverged. Runs headless, without loading a map.
+ * Usage: UE4Editor-Cmd.exe NTGame.uproject -run=NTReplayLog -Log=<path> [-Threshold=<cm>] [-MaxPoints=<n>] [-Csv=<path>]
+ *
+ * Two kinds of divergence are found, each reported where it starts rather than on every tick it lasts:
+ *   Simulation - A logged state the integrator can't reproduce from the one before it and its input. Contacts, usually.
+ *   Correction - (Client logs) The Server's state for a tick, against what we predicted for it. This is the rubber-banding.
+ */
+UCLASS()
+class UNTReplayLogCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UNTReplayLogCommandlet(const FObjectInitializer& ObjectInitializer);
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	struct FDivergencePoint
+	{
+		const TCHAR* Kind;
+		int32 Tick;
+		float Error;
+	};
+
+	/* Tracks one kind of divergence - Records a point when the error first goes over the threshold */
+	struct FDivergenceTracker
+	{
+		const TCHAR* Kind;
+		bool bDiverged;
+		int32 NumSamples;
+		double TotalError;
+		float MaxError;
+
+		FDivergenceTracker(const TCHAR* InKind)
+			: Kind(InKind)
+			, bDiverged(false)
+			, NumSamples(0)
+			, TotalError(0.0)
+			, MaxError(0.f)
+		{}
+
+		void AddSample(int32 Tick, float Error, float Threshold, TArray<FDivergencePoint>& Points);
+	};
+
+	void WriteCsv(const FString& Path, const TArray<FDivergencePoint>& Points) const;
+};
@@ -0,0 +1,196 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "NTBinarySearch.h"
+
+/**
+ * Fixed capacity ring buffer. Capacity is always a power of two, so wrapping is a mask rather than a branch.
+ * Head and Tail count up forever and are only masked on access, so Num() is just Head - Tail and a full buffer
+ * is never confused with an empty one.
+ *
+ * Elements are indexed logically - 0 is the oldest, Num() - 1 the newest.
+ */
+template<typename ElementType>
+class TNTRingBuffer
+{
+public:
+	TNTRingBuffer()
+		: Head(0)
+		, Tail(0)
+		, IndexMask(0)
+	{}
+
+	// Sets the capacity, rounded up to a power of two, and empties the buffer
+	void Resize(uint32 MinCapacity)
+	{
+		const uint32 NewCapacity = FMath::RoundUpToPowerOfTwo(FMath::Max(MinCapacity, 1u));
+		Elements.Reset();
+		Elements.SetNum(NewCapacity);
+		IndexMask = NewCapacity - 1;
+		Head = 0;
+		Tail = 0;
+	}
+
+	// Empties the buffer, keeping the capacity
+	void Reset()
+	{
+		Head = 0;
+		Tail = 0;
+	}
+
+	uint32 Num() const
+	{
+		return Head - Tail;
+	}
+
+	uint32 Capacity() const
+	{
+		return (uint32)Elements.Num();
+	}
+
+	bool IsEmpty() const
+	{
+		return Head == Tail;
+	}
+
+	bool IsFull() const
+	{
+		return Num() == Capacity();
+	}
+
+	// Adds to the newest end. If full, the oldest element is dropped to make room.
+	ElementType& Add(const ElementType& NewElement)
+	{
+		checkSlow(Capacity() > 0);
+		if (IsFull())
+		{
+			Tail++;
+		}
+
+		ElementType& Slot = Elements[Head & IndexMask];
+		Slot = NewElement;
+		Head++;
+		return Slot;
+	}
+
+	// Removes the oldest element
+	void Remove()
+	{
+		ensure(!IsEmpty());
+		if (!IsEmpty())
+		{
+			Tail++;
+		}
+	}
+
+	// Removes up to Count of the oldest elements
+	void RemoveOldest(uint32 Count)
+	{
+		Tail += FMath::Min(Count, Num());
+	}
+
+	ElementType& Oldest()
+	{
+		checkSlow(!IsEmpty());
+		return Elements[Tail & IndexMask];
+	}
+
+	const ElementType& Oldest() const
+	{
+		checkSlow(!IsEmpty());
+		return Elements[Tail & IndexMask];
+	}
+
+	ElementType& Newest()
+	{
+		checkSlow(!IsEmpty());
+		return Elements[(Head - 1) & IndexMask];
+	}
+
+	const ElementType& Newest() const
+	{
+		checkSlow(!IsEmpty());
+		return Elements[(Head - 1) & IndexMask];
+	}
+
+	ElementType& operator[](uint32 Index)
+	{
+		checkSlow(Index < Num());
+		return Elements[(Tail + Index) & IndexMask];
+	}
+
+	const ElementType& operator[](uint32 Index) const
+	{
+		checkSlow(Index < Num());
+		return Elements[(Tail + Index) & IndexMask];
+	}
+
+	/**
+	 * Binary search for the first element whose key is not less than Key. Returns Num() if there isn't one.
+	 * Keys returned by Projection must be ascending from oldest to newest.
+	 */
+	template<typename KeyType, typename ProjectionType>
+	uint32 LowerBound(const KeyType& Key, ProjectionType Projection) const
+	{
+		return FNTBinarySearch::LowerBound(Num(), [this, &Key, &Projection](uint32 Index) { return Projection((*this)[Index]) < Key; });
+	}
+
+	// Drops every element with a key less than Key, in a single seek
+	template<typename KeyType, typename ProjectionType>
+	void RemoveBefore(const KeyType& Key, ProjectionType Projection)
+	{
+		RemoveOldest(LowerBound(Key, Projection));
+	}
+
+	// --- ITERATION -------------------------------------------------------------------
+
+	template<typename BufferType, typename ValueType>
+	class TIterator
+	{
+	public:
+		TIterator(BufferType& InBuffer, uint32 InIndex)
+			: Buffer(InBuffer)
+			, Index(InIndex)
+		{}
+
+		ValueType& operator*() const
+		{
+			return Buffer[Index];
+		}
+
+		ValueType* operator->() const
+		{
+			return &Buffer[Index];
+		}
+
+		TIterator& operator++()
+		{
+			Index++;
+			return *this;
+		}
+
+		bool operator!=(const TIterator& Other) const
+		{
+			return Index != Other.Index;
+		}
+
+	private:
+		BufferType& Buffer;
+		uint32 Index;
+	};
+
+	typedef TIterator<TNTRingBuffer, ElementType> FIterator;
+	typedef TIterator<const TNTRingBuffer, const ElementType> FConstIterator;
+
+	FIterator begin() { return FIterator(*this, 0); }
+	FIterator end() { return FIterator(*this, Num()); }
+	FConstIterator begin() const { return FConstIterator(*this, 0); }
+	FConstIterator end() const { return FConstIterator(*this, Num()); }
+
+private:
+	TArray<ElementType> Elements;
+	uint32 Head;
+	uint32 Tail;
+	uint32 IndexMask;
+};
@@ -0,0 +1,262 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NTGame.h"
+#include "NTPawn.h"
+#include "NTCubeManager.h"
+#include "NTNetSettings.h"
+#include "NTSpatialGrid.h"
+#include "NTSnapshot.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Snapshot Bytes Sent"), STAT_NTSnapshotBytesSent, STATGROUP_NTNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Snapshot Cubes Sent"), STAT_NTSnapshotCubesSent, STATGROUP_NTNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Snapshot Cubes Deferred"), STAT_NTSnapshotCubesDeferred, STATGROUP_NTNet);
+DECLARE_CYCLE_STAT(TEXT("Build Snapshot"), STAT_NTBuildSnapshot, STATGROUP_NTPrediction);
+
+void FCubeSnapshotEntry::Serialize(FArchive& Ar)
+{
+	uint32 PackedId = (uint32)CubeId;
+	Ar.SerializeIntPacked(PackedId);
+	CubeId = (int32)PackedId;
+
+	State.Serialize(Ar);
+}
+
+void FCubeSnapshot::SerializeHeader(FArchive& Ar, uint32& NumEntries)
+{
+	Ar << ServerTick;
+	AckHeader.Serialize(Ar);
+	Ar.SerializeIntPacked(NumEntries);
+}
+
+int32 FCubeSnapshot::GetMaxHeaderBits()
+{
+	// Written out for real, so the budget can't drift from what NetSerialize sends
+	FCubeSnapshot Snapshot;
+	Snapshot.AckHeader.bValid = true;
+	Snapshot.AckHeader.bHasAck = true;
+	uint32 NumEntries = MaxEntries;
+
+	FBitWriter Writer(0, true);
+	Snapshot.SerializeHeader(Writer, NumEntries);
+	return (int32)Writer.GetNumBits();
+}
+
+bool FCubeSnapshot::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	uint32 NumEntries = Entries.Num();
+	SerializeHeader(Ar, NumEntries);
+
+	if (Ar.IsLoading())
+	{
+		if (NumEntries > MaxEntries)
+		{
+			Ar.SetError();
+			bOutSuccess = false;
+			return true;
+		}
+
+		Entries.SetNum(NumEntries);
+	}
+
+	for (FCubeSnapshotEntry& Entry : Entries)
+	{
+		Entry.Serialize(Ar);
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
+
+FNTSnapshotSender::FNTSnapshotSender()
+	: LastNumSent(0)
+	, LastNumDeferred(0)
+	, LastBytes(0)
+	, TimeSinceSend(0.f)
+{
+	const UNTNetSettings* Settings = GetDefault<UNTNetSettings>();
+	SendRate = Settings->SnapshotRate;
+	ByteBudget = Settings->SnapshotByteBudget;
+	RestRepeats = Settings->SnapshotRestRepeats;
+}
+
+float FNTSnapshotSender::GetPriority(const ANTPawn* Cube, const FVector& ViewLocation, bool bHasViewLocation, float CurrentTime)
+{
+	const UNTNetSettings* Settings = GetDefault<UNTNetSettings>();
+	float Priority = 1.f + Cube->CurrentPhysState.Velocity.Size() / Settings->SnapshotSpeedScale;
+
+	if (bHasViewLocation)
+	{
+		const float Distance = FVector::Dist(Cube->CurrentPhysState.Position, ViewLocation);
+		Priority *= Settings->SnapshotDistanceScale / (Settings->SnapshotDistanceScale + Distance);
+	}
+
+	if (CurrentTime - Cube->LastInteractionTime < Settings->SnapshotInteractionTime)
+	{
+		Priority *= Settings->SnapshotInteractionBoost;
+	}
+
+	return Priority;
+}
+
+bool FNTSnapshotSender::Update(float DeltaSeconds, const ANTCubeManager* Manager, const APawn* ViewerPawn, const FNTRelevancyCache* Relevancy, FCubeSnapshot& OutSnapshot)
+{
+	SCOPE_CYCLE_COUNTER(STAT_NTBuildSnapshot);
+
+	TimeSinceSend += DeltaSeconds;
+
+	const float SendInterval = 1.f / FMath::Max(SendRate, 1.f);
+	if (TimeSinceSend < SendInterval)
+	{
+		return false;
+	}
+
+	TimeSinceSend = FMath::Fmod(TimeSinceSend, SendInterval);
+
+	static const int32 HeaderBits = FCubeSnapshot::GetMaxHeaderBits();
+
+	// A due snapshot goes out even with no cubes in it - It's all that carries acks for the Client's input batches
+	OutSnapshot.Entries.Reset();
+	if (!Manager)
+	{
+		LastNumSent = 0;
+		LastNumDeferred = 0;
+		LastBytes = (HeaderBits + 7) >> 3;
+		INC_DWORD_STAT_BY(STAT_NTSnapshotBytesSent, LastBytes);
+		return true;
+	}
+
+	struct FCandidate
+	{
+		float Accumulator;
+		const ANTPawn* Cube;
+	};
+
+	const FVector ViewLocation = ViewerPawn ? ViewerPawn->GetActorLocation() : FVector::ZeroVector;
+	const float CurrentTime = Manager->GetWorld()->GetTimeSeconds();
+
+	// With a relevancy cache, only the cubes this viewer can see compete for space
+	TArray<ANTPawn*> RelevantCubes;
+	const bool bUseRelevancy = Relevancy && Relevancy->IsValid();
+	if (bUseRelevancy)
+	{
+		RelevantCubes.Reserve(Relevancy->GetRelevant().Num());
+		for (int32 RelevantId : Relevancy->GetRelevant())
+		{
+			ANTPawn* Cube = Manager->FindCube(RelevantId);
+			if (Cube)
+			{
+				RelevantCubes.Add(Cube);
+			}
+		}
+	}
+
+	const TArray<ANTPawn*>& SourceCubes = bUseRelevancy ? RelevantCubes : Manager->GetCubes();
+
+	// Accumulate - Cubes that keep missing out climb the list
+	TArray<FCandidate> Candidates;
+	Candidates.Reserve(SourceCubes.Num());
+
+	for (const ANTPawn* Cube : SourceCubes)
+	{
+		// The viewer's own cube has its own channel, ServerMoveData
+		if (Cube == ViewerPawn || Cube->CubeId == INDEX_NONE)
+		{
+			continue;
+		}
+
+		// The viewer already has this cube's resting state
+		if (Cube->IsAtRest())
+		{
+			const FRestSends* Sends = RestSends.Find(Cube->CubeId);
+			if (Sends && Sends->RestTick == Cube->GetRestTick() && Sends->Count >= RestRepeats)
+			{
+				continue;
+			}
+		}
+
+		float& Accumulator = Accumulators.FindOrAdd(Cube->CubeId);
+		Accumulator += GetPriority(Cube, ViewLocation, ViewerPawn != nullptr, CurrentTime);
+
+		FCandidate Candidate = { Accumulator, Cube };
+		Candidates.Add(Candidate);
+	}
+
+	Candidates.Sort([](const FCandidate& A, const FCandidate& B) { return A.Accumulator > B.Accumulator; });
+
+	// Fill - Highest first, until the next cube won't fit
+	OutSnapshot.ServerTick = Manager->GetServerTick();
+
+	const int32 BudgetBits = ByteBudget * 8;
+	int32 UsedBits = HeaderBits;
+
+	for (const FCandidate& Candidate : Candidates)
+	{
+		if (OutSnapshot.Entries.Num() >= FCubeSnapshot::MaxEntries)
+		{
+			break;
+		}
+
+		FCubeSnapshotEntry Entry;
+		Entry.CubeId = Candidate.Cube->CubeId;
+		Entry.State.FromState(Candidate.Cube->CurrentPhysState);
+
+		FBitWriter EntryWriter(0, true);
+		Entry.Serialize(EntryWriter);
+
+		const int32 EntryBits = (int32)EntryWriter.GetNumBits();
+		if (UsedBits + EntryBits > BudgetBits)
+		{
+			break;
+		}
+
+		UsedBits += EntryBits;
+		OutSnapshot.Entries.Add(Entry);
+		Accumulators.FindChecked(Entry.CubeId) = 0.f;
+
+		if (Candidate.Cube->IsAtRest())
+		{
+			FRestSends& Sends = RestSends.FindOrAdd(Entry.CubeId);
+			if (Sends.RestTick != Candidate.Cube->GetRestTick())
+			{
+				Sends.RestTick = Candidate.Cube->GetRestTick();
+				Sends.Count = 0;
+			}
+			Sends.Count++;
+		}
+	}
+
+	// Forget cubes that have gone
+	if (Accumulators.Num() > Candidates.Num() * 2 + 16)
+	{
+		TMap<int32, float> LiveAccumulators;
+		for (const FCandidate& Candidate : Candidates)
+		{
+			LiveAccumulators.Add(Candidate.Cube->CubeId, Accumulators.FindChecked(Candidate.Cube->CubeId));
+		}
+		Accumulators = MoveTemp(LiveAccumulators);
+	}
+
+	if (RestSends.Num() > Manager->GetNumCubes() * 2 + 16)
+	{
+		TMap<int32, FRestSends> LiveRestSends;
+		for (const ANTPawn* Cube : Manager->GetCubes())
+		{
+			const FRestSends* Sends = RestSends.Find(Cube->CubeId);
+			if (Sends && Cube->IsAtRest())
+			{
+				LiveRestSends.Add(Cube->CubeId, *Sends);
+			}
+		}
+		RestSends = MoveTemp(LiveRestSends);
+	}
+
+	LastNumSent = OutSnapshot.Entries.Num();
+	LastNumDeferred = Candidates.Num() - LastNumSent;
+	LastBytes = (UsedBits + 7) >> 3;
+
+	INC_DWORD_STAT_BY(STAT_NTSnapshotBytesSent, LastBytes);
+	INC_DWORD_STAT_BY(STAT_NTSnapshotCubesSent, LastNumSent);
+	INC_DWORD_STAT_BY(STAT_NTSnapshotCubesDeferred, LastNumDeferred);
+
+	return true;
+}
@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "NTNetSerialization.h"
+#include "NTAckSystem.h"
+#include "NTSnapshot.generated.h"
+
+class ANTPawn;
+class ANTCubeManager;
+
+/* One cube's authoritative state in a snapshot */
+struct FCubeSnapshotEntry
+{
+	int32 CubeId;
+	FCubeQuantizedState State;
+
+	FCubeSnapshotEntry()
+		: CubeId(INDEX_NONE)
+	{}
+
+	void Serialize(FArchive& Ar);
+};
+
+/**
+ * Authoritative state for many cubes at once, sent to a single Client in one unreliable RPC.
+ * Which cubes make it in is decided per connection by FNTSnapshotSender.
+ */
+USTRUCT()
+struct FCubeSnapshot
+{
+	GENERATED_USTRUCT_BODY()
+
+	enum { MaxEntries = 1024 };
+
+	// ANTCubeManager step this was taken on
+	UPROPERTY()
+	int32 ServerTick;
+
+	// Sequence for the Client to ack, and the Server's acks for the Client's input batches
+	FNTAckHeader AckHeader;
+
+	TArray<FCubeSnapshotEntry> Entries;
+
+	FCubeSnapshot()
+		: ServerTick(0)
+	{}
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	/* Most bits everything but the entries can take - Tick, a full ack header and the entry count */
+	static int32 GetMaxHeaderBits();
+
+private:
+	void SerializeHeader(FArchive& Ar, uint32& NumEntries);
+};
+
+template<>
+struct TStructOpsTypeTraits<FCubeSnapshot> : public TStructOpsTypeTraitsBase
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/**
+ * Server - Builds snapshots for one connection. Every cube has a priority accumulator that grows each send by how much
+ * the cube matters to this viewer right now. The highest accumulators are sent until the packet's byte budget is spent,
+ * and whatever's sent goes back to zero. Cubes that miss out keep accumulating, so everything gets sent eventually.
+ */
+struct NTGAME_API FNTSnapshotSender
+{
+	FNTSnapshotSender();
+
+	/* Snapshots sent per second, and the hard cap on each one's size. Start from UNTNetSettings. */
+	float SendRate;
+	int32 ByteBudget;
+
+	/**
+	 * Advances time and, if a snapshot is due, fills OutSnapshot. Returns false if none is due.
+	 * A due snapshot may have no entries - It still has to go, for the acks in its header.
+	 * Only cubes in Relevancy are considered when it's given and valid, otherwise every cube the manager has.
+	 */
+	bool Update(float DeltaSeconds, const ANTCubeManager* Manager, const APawn* ViewerPawn, const struct FNTRelevancyCache* Relevancy, FCubeSnapshot& OutSnapshot);
+
+	/* How much a cube matters to a viewer at this location - Speed, Distance and Recent Interaction */
+	static float GetPriority(const ANTPawn* Cube, const FVector& ViewLocation, bool bHasViewLocation, float CurrentTime);
+
+	/* Stats for the last snapshot */
+	int32 LastNumSent;
+	int32 LastNumDeferred;
+	int32 LastBytes;
+
+private:
+	TMap<int32, float> Accumulators;
+	float TimeSinceSend;
+
+	/* Cubes at rest are sent a few times, in case one is lost, then left out until they wake */
+	struct FRestSends
+	{
+		int32 RestTick;
+		int32 Count;
+
+		FRestSends() : RestTick(INDEX_NONE), Count(0) {}
+	};
+
+	TMap<int32, FRestSends> RestSends;
+	int32 RestRepeats;
+};
@@ -0,0 +1,175 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NTGame.h"
+#include "NTCubeIntegrator.h"
+#include "NTNetSettings.h"
+#include "NTSnapshotInterpolator.h"
+
+namespace
+{
+	// Playback speeds up or slows down by at most this much to reach the target delay
+	const float MaxTimeScaleAdjust = 0.1f;
+
+	// Further out than this and we jump straight to the target, rather than slewing
+	const double MaxPlaybackError = 0.5;
+
+	double GetSampleTime(const FNTInterpolationSample& Sample)
+	{
+		return Sample.Time;
+	}
+
+	void ToState(const FNTInterpolationSample& Sample, FCubeState& OutState)
+	{
+		OutState.Position = Sample.Position;
+		OutState.Velocity = Sample.Velocity;
+		OutState.AngularVelocity = Sample.AngularVelocity;
+		OutState.Rotation = Sample.Rotation;
+	}
+}
+
+FNTSnapshotInterpolator::FNTSnapshotInterpolator()
+{
+	Samples.Resize(Capacity);
+	Reset();
+}
+
+void FNTSnapshotInterpolator::Reset()
+{
+	Samples.Reset();
+	PlaybackTime = 0.0;
+	NewestArrivalTime = 0.0;
+	SampleInterval = 1.f / FMath::Max(GetDefault<UNTNetSettings>()->SnapshotRate, 1.f);
+	Jitter = 0.f;
+	LastTransitTime = 0.0;
+	NumExtrapolated = 0;
+}
+
+float FNTSnapshotInterpolator::GetTargetDelay() const
+{
+	const UNTNetSettings* Settings = GetDefault<UNTNetSettings>();
+	return SampleInterval + Jitter * Settings->InterpolationJitterMultiplier + Settings->InterpolationExtraDelay;
+}
+
+void FNTSnapshotInterpolator::AddSample(double ServerTime, const FCubeState& State, double ArrivalTime)
+{
+	const double TransitTime = ArrivalTime - ServerTime;
+
+	if (!Samples.IsEmpty())
+	{
+		const FNTInterpolationSample& Newest = Samples.Newest();
+		if (ServerTime <= Newest.Time)
+		{
+			return;
+		}
+
+		SampleInterval += ((float)(ServerTime - Newest.Time) - SampleInterval) * 0.1f;
+		Jitter += ((float)FMath::Abs(TransitTime - LastTransitTime) - Jitter) / 16.0f;
+	}
+	else
+	{
+		PlaybackTime = ServerTime - GetTargetDelay();
+	}
+
+	LastTransitTime = TransitTime;
+	NewestArrivalTime = ArrivalTime;
+
+	FNTInterpolationSample NewSample;
+	NewSample.Time = ServerTime;
+	NewSample.Position = State.Position;
+	NewSample.Velocity = State.Velocity;
+	NewSample.AngularVelocity = State.AngularVelocity;
+	NewSample.Rotation = State.Rotation;
+	Samples.Add(NewSample);
+}
+
+bool FNTSnapshotInterpolator::Sample(double CurrentTime, float DeltaSeconds, FCubeState& OutState)
+{
+	if (Samples.IsEmpty())
+	{
+		return false;
+	}
+
+	// Where the Server probably is now, and where we'd like to be playing
+	const double EstimatedServerTime = Samples.Newest().Time + (CurrentTime - NewestArrivalTime);
+	const double TargetTime = EstimatedServerTime - GetTargetDelay();
+	const double Error = TargetTime - PlaybackTime;
+
+	if (FMath::Abs(Error) > MaxPlaybackError)
+	{
+		PlaybackTime = TargetTime;
+	}
+	else
+	{
+		// Slew towards the target by playing slightly fast or slow, which is invisible compared to a jump
+		const float TimeScale = 1.f + FMath::Clamp((float)Error, -MaxTimeScaleAdjust, MaxTimeScaleAdjust);
+		PlaybackTime += DeltaSeconds * TimeScale;
+	}
+
+	if (Evaluate(PlaybackTime, OutState))
+	{
+		NumExtrapolated++;
+	}
+
+	// Keep two samples behind playback, for rotation tangents
+	const uint32 NextIndex = Samples.LowerBound(PlaybackTime, &GetSampleTime);
+	if (NextIndex > 2)
+	{
+		Samples.RemoveOldest(NextIndex - 2);
+	}
+
+	return true;
+}
+
+bool FNTSnapshotInterpolator::Evaluate(double Time, FCubeState& OutState) const
+{
+	const uint32 NextIndex = Samples.LowerBound(Time, &GetSampleTime);
+
+	// Before anything we have
+	if (NextIndex == 0)
+	{
+		ToState(Samples.Oldest(), OutState);
+		return false;
+	}
+
+	// Past the newest snapshot - Carry on with its velocities, but not forever
+	if (NextIndex == Samples.Num())
+	{
+		const FNTInterpolationSample& Newest = Samples.Newest();
+		const float MaxExtrapolation = GetDefault<UNTNetSettings>()->InterpolationMaxExtrapolation;
+		const float ExtrapolationTime = FMath::Min((float)(Time - Newest.Time), MaxExtrapolation);
+
+		FCubeSimParams Params;
+		Params.LinearDamping = 0.f;
+
+		ToState(Newest, OutState);
+		FCubeIntegrator::Integrate(OutState, ExtrapolationTime, Params);
+		return true;
+	}
+
+	const FNTInterpolationSample& From = Samples[NextIndex - 1];
+	const FNTInterpolationSample& To = Samples[NextIndex];
+
+	const float Duration = (float)(To.Time - From.Time);
+	const float Alpha = FMath::Clamp((float)(Time - From.Time) / Duration, 0.f, 1.f);
+
+	// Hermite position, with tangents from the velocities at each end
+	OutState.Position = FMath::CubicInterp(From.Position, From.Velocity * Duration, To.Position, To.Velocity * Duration, Alpha);
+	OutState.Velocity = FMath::Lerp(From.Velocity, To.Velocity, Alpha);
+	OutState.AngularVelocity = FMath::Lerp(From.AngularVelocity, To.AngularVelocity, Alpha);
+
+	// Squad when we have neighbours on both sides, otherwise slerp
+	if (NextIndex >= 2 && NextIndex + 1 < Samples.Num())
+	{
+		FQuat FromTangent, ToTangent;
+		FQuat::CalcTangents(Samples[NextIndex - 2].Rotation, From.Rotation, To.Rotation, 0.f, FromTangent);
+		FQuat::CalcTangents(From.Rotation, To.Rotation, Samples[NextIndex + 1].Rotation, 0.f, ToTangent);
+		OutState.Rotation = FQuat::Squad(From.Rotation, FromTangent, To.Rotation, ToTangent, Alpha);
+	}
+	else
+	{
+		OutState.Rotation = FQuat::Slerp(From.Rotation, To.Rotation, Alpha);
+	}
+
+	OutState.Rotation.Normalize();
+	return false;
+}
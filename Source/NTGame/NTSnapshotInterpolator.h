@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "NTRingBuffer.h"
+
+struct FCubeState;
+
+/* A snapshot state at a point in Server time. Same fields as FCubeState, which ANTPawn defines after including us. */
+struct FNTInterpolationSample
+{
+	double Time;
+	FVector Position;
+	FVector Velocity;
+	FVector AngularVelocity;
+	FQuat Rotation;
+
+	FNTInterpolationSample()
+		: Time(0.0)
+		, Position(ForceInitToZero)
+		, Velocity(ForceInitToZero)
+		, AngularVelocity(ForceInitToZero)
+		, Rotation(ForceInitToZero)
+	{}
+};
+
+/**
+ * Client - Plays back snapshot states for a cube we don't control. Playback runs a little behind the newest snapshot,
+ * far enough to cover the snapshot interval plus the jitter we're seeing, so there's nearly always a pair of states to
+ * interpolate between. When snapshots are late we extrapolate, but only for so long.
+ */
+struct NTGAME_API FNTSnapshotInterpolator
+{
+	enum { Capacity = 32 };
+
+	FNTSnapshotInterpolator();
+
+	void Reset();
+
+	/* ServerTime is when the state was simulated, ArrivalTime when we got it, both in seconds */
+	void AddSample(double ServerTime, const FCubeState& State, double ArrivalTime);
+
+	/* Advances playback and gets the state to show. Returns false until we have something to show. */
+	bool Sample(double CurrentTime, float DeltaSeconds, FCubeState& OutState);
+
+	/* How far behind the newest snapshot we're aiming to play, in seconds */
+	float GetTargetDelay() const;
+	float GetJitter() const { return Jitter; }
+
+	/* Frames shown past the newest snapshot */
+	uint32 NumExtrapolated;
+
+private:
+	/* Returns true if Time is past the newest sample and we had to extrapolate */
+	bool Evaluate(double Time, FCubeState& OutState) const;
+
+	TNTRingBuffer<FNTInterpolationSample> Samples;
+
+	/* Server time we're currently showing */
+	double PlaybackTime;
+
+	/* Local time the newest sample arrived */
+	double NewestArrivalTime;
+
+	/* Smoothed gap between snapshots, and inter-arrival jitter (RFC 3550), in seconds */
+	float SampleInterval;
+	float Jitter;
+	double LastTransitTime;
+};
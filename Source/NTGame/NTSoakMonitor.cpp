@@ -0,0 +1,221 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NTGame.h"
+#include "Json.h"
+#include "NTSoakMonitor.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogNTSoak, Log, All);
+
+namespace
+{
+	// Connection byte rates are per second already, no point sampling faster
+	const float ConnectionSampleInterval = 1.0f;
+}
+
+ANTSoakMonitor::ANTSoakMonitor(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = true;
+	PrimaryActorTick.TickGroup = ETickingGroup::TG_PostUpdateWork;
+
+	bReplicates = false;
+
+	Duration = 60.0f;
+	ElapsedTime = 0.f;
+	TimeSinceConnectionSample = 0.f;
+	bReportWritten = false;
+}
+
+bool ANTSoakMonitor::IsEnabled()
+{
+	return FParse::Param(FCommandLine::Get(), TEXT("NTSoak"));
+}
+
+ANTSoakMonitor* ANTSoakMonitor::Get(UWorld* World)
+{
+	if (!World)
+	{
+		return nullptr;
+	}
+
+	for (TActorIterator<ANTSoakMonitor> It(World); It; ++It)
+	{
+		if (!It->IsPendingKill())
+		{
+			return *It;
+		}
+	}
+
+	FActorSpawnParameters SpawnInfo;
+	SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnInfo.ObjectFlags |= RF_Transient;
+	return World->SpawnActor<ANTSoakMonitor>(SpawnInfo);
+}
+
+void ANTSoakMonitor::BeginPlay()
+{
+	Super::BeginPlay();
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	FParse::Value(CommandLine, TEXT("NTSoakDuration="), Duration);
+
+	if (!FParse::Value(CommandLine, TEXT("NTSoakReport="), ReportPath))
+	{
+		const TCHAR* RoleName = GetNetMode() == NM_Client ? TEXT("Client") : TEXT("Server");
+		ReportPath = FPaths::GameSavedDir() / TEXT("Soak") / FString::Printf(TEXT("%s_%u.json"), RoleName, FPlatformProcess::GetCurrentProcessId());
+	}
+
+	ApplyPacketSimulation();
+
+	UE_LOG(LogNTSoak, Log, TEXT("Soak run for %.0f seconds, reporting to %s"), Duration, *ReportPath);
+}
+
+void ANTSoakMonitor::ApplyPacketSimulation()
+{
+#if DO_ENABLE_NET_TEST
+	UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (!NetDriver)
+	{
+		return;
+	}
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	FPacketSimulationSettings Settings = NetDriver->PacketSimulationSettings;
+
+	bool bChanged = false;
+	bChanged |= FParse::Value(CommandLine, TEXT("NTPktLag="), Settings.PktLag);
+	bChanged |= FParse::Value(CommandLine, TEXT("NTPktLagVariance="), Settings.PktLagVariance);
+	bChanged |= FParse::Value(CommandLine, TEXT("NTPktLoss="), Settings.PktLoss);
+	bChanged |= FParse::Value(CommandLine, TEXT("NTPktOrder="), Settings.PktOrder);
+	bChanged |= FParse::Value(CommandLine, TEXT("NTPktDup="), Settings.PktDup);
+
+	if (bChanged)
+	{
+		NetDriver->SetPacketSimulationSettings(Settings);
+		UE_LOG(LogNTSoak, Log, TEXT("Packet simulation: Lag %dms, Variance %dms, Loss %d%%, Order %d, Dup %d%%"),
+			Settings.PktLag, Settings.PktLagVariance, Settings.PktLoss, Settings.PktOrder, Settings.PktDup);
+	}
+#endif
+}
+
+void ANTSoakMonitor::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (bReportWritten)
+	{
+		return;
+	}
+
+	FrameTimes.Add(FPlatformTime::ToMilliseconds(GGameThreadTime));
+
+	TimeSinceConnectionSample += DeltaSeconds;
+	if (TimeSinceConnectionSample >= ConnectionSampleInterval)
+	{
+		TimeSinceConnectionSample = 0.f;
+		SampleConnections();
+	}
+
+	ElapsedTime += DeltaSeconds;
+	if (ElapsedTime >= Duration)
+	{
+		WriteReport();
+		bReportWritten = true;
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void ANTSoakMonitor::RecordCorrection(float PositionError)
+{
+	CorrectionErrors.Add(PositionError);
+}
+
+void ANTSoakMonitor::SampleConnections()
+{
+	UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (!NetDriver)
+	{
+		return;
+	}
+
+	TArray<UNetConnection*> DriverConnections;
+	if (NetDriver->ServerConnection)
+	{
+		DriverConnections.Add(NetDriver->ServerConnection);
+	}
+	DriverConnections.Append(NetDriver->ClientConnections);
+
+	for (UNetConnection* Connection : DriverConnections)
+	{
+		if (Connection && Connection->State == USOCK_Open)
+		{
+			FConnectionSamples& Samples = Connections.FindOrAdd(Connection->LowLevelGetRemoteAddress(true));
+			Samples.InBytesPerSecond.Add(Connection->InBytesPerSecond);
+			Samples.OutBytesPerSecond.Add(Connection->OutBytesPerSecond);
+		}
+	}
+}
+
+float ANTSoakMonitor::GetPercentile(TArray<float>& Values, float Percentile)
+{
+	if (Values.Num() == 0)
+	{
+		return 0.f;
+	}
+
+	Values.Sort();
+	const int32 Index = FMath::Clamp(FMath::CeilToInt(Percentile * Values.Num()) - 1, 0, Values.Num() - 1);
+	return Values[Index];
+}
+
+float ANTSoakMonitor::GetMean(const TArray<float>& Values)
+{
+	double Total = 0.0;
+	for (const float Value : Values)
+	{
+		Total += Value;
+	}
+
+	return Values.Num() > 0 ? (float)(Total / Values.Num()) : 0.f;
+}
+
+void ANTSoakMonitor::WriteReport()
+{
+	FString Output;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+
+	Writer->WriteObjectStart();
+	Writer->WriteValue(TEXT("role"), FString(GetNetMode() == NM_Client ? TEXT("client") : TEXT("server")));
+	Writer->WriteValue(TEXT("duration"), ElapsedTime);
+
+	Writer->WriteValue(TEXT("corrections"), CorrectionErrors.Num());
+	Writer->WriteValue(TEXT("correctionsPerSecond"), ElapsedTime > 0.f ? CorrectionErrors.Num() / ElapsedTime : 0.f);
+	Writer->WriteValue(TEXT("positionErrorMean"), GetMean(CorrectionErrors));
+	Writer->WriteValue(TEXT("positionErrorP99"), GetPercentile(CorrectionErrors, 0.99f));
+
+	Writer->WriteValue(TEXT("frameMsMean"), GetMean(FrameTimes));
+	Writer->WriteValue(TEXT("frameMsP99"), GetPercentile(FrameTimes, 0.99f));
+
+	Writer->WriteArrayStart(TEXT("connections"));
+	for (const auto& Pair : Connections)
+	{
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("address"), Pair.Key);
+		Writer->WriteValue(TEXT("inBytesPerSecond"), GetMean(Pair.Value.InBytesPerSecond));
+		Writer->WriteValue(TEXT("outBytesPerSecond"), GetMean(Pair.Value.OutBytesPerSecond));
+		Writer->WriteObjectEnd();
+	}
+	Writer->WriteArrayEnd();
+
+	Writer->WriteObjectEnd();
+	Writer->Close();
+
+	if (FFileHelper::SaveStringToFile(Output, *ReportPath))
+	{
+		UE_LOG(LogNTSoak, Log, TEXT("Soak report written to %s"), *ReportPath);
+	}
+	else
+	{
+		UE_LOG(LogNTSoak, Error, TEXT("Couldn't write soak report to %s"), *ReportPath);
+	}
+}
@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "GameFramework/Actor.h"
+#include "NTSoakMonitor.generated.h"
+
+/**
+ * Collects metrics for an unattended soak run and writes them out as JSON when the run is over, then quits.
+ * One per world, on the Server and on each Client. See Scripts/RunSoakTest.sh.
+ *
+ * Command line:
+ *   -NTSoak                   Enable the monitor
+ *   -NTSoakDuration=<seconds> Length of the run, from the first player joining
+ *   -NTSoakReport=<path>      Where to write the report. Defaults to Saved/Soak/.
+ *   -NTPktLag=<ms> -NTPktLagVariance=<ms> -NTPktLoss=<percent> -NTPktOrder=<0|1> -NTPktDup=<percent>
+ *                             Packet simulation for everything this process sends. Not in shipping builds.
+ */
+UCLASS(NotPlaceable, Transient)
+class NTGAME_API ANTSoakMonitor : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ANTSoakMonitor(const FObjectInitializer& ObjectInitializer);
+	virtual void BeginPlay() override;
+	virtual void Tick(float DeltaSeconds) override;
+
+	/* True if -NTSoak is on the command line */
+	static bool IsEnabled();
+
+	/* Finds the monitor for this world, spawning one if there isn't one yet */
+	static ANTSoakMonitor* Get(UWorld* World);
+
+	/* Client - A correction moved our cube this far from where we'd predicted it */
+	void RecordCorrection(float PositionError);
+
+private:
+	void ApplyPacketSimulation();
+	void SampleConnections();
+	void WriteReport();
+
+	/* Sorts Values in place */
+	static float GetPercentile(TArray<float>& Values, float Percentile);
+	static float GetMean(const TArray<float>& Values);
+
+	float Duration;
+	FString ReportPath;
+	float ElapsedTime;
+	float TimeSinceConnectionSample;
+	bool bReportWritten;
+
+	/* Game thread time of each frame, in ms */
+	TArray<float> FrameTimes;
+
+	TArray<float> CorrectionErrors;
+
+	struct FConnectionSamples
+	{
+		TArray<float> InBytesPerSecond;
+		TArray<float> OutBytesPerSecond;
+	};
+
+	/* Keyed by remote address */
+	TMap<FString, FConnectionSamples> Connections;
+};
@@ -0,0 +1,154 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NTGame.h"
+#include "NTNetSettings.h"
+#include "NTBinarySearch.h"
+#include "NTSpatialGrid.h"
+
+FNTSpatialGrid::FNTSpatialGrid()
+{
+	Reset(GetDefault<UNTNetSettings>()->RelevancyCellSize);
+}
+
+void FNTSpatialGrid::Reset(float InCellSize)
+{
+	CellSize = FMath::Max(InCellSize, 1.f);
+	InvCellSize = 1.f / CellSize;
+	Cells.Reset();
+	ElementCells.Reset();
+}
+
+void FNTSpatialGrid::Add(int32 Element, const FVector& Position)
+{
+	if (ElementCells.Contains(Element))
+	{
+		Move(Element, Position);
+		return;
+	}
+
+	const FIntPoint Cell = GetCell(Position);
+	ElementCells.Add(Element, Cell);
+	AddToCell(Element, Cell);
+}
+
+void FNTSpatialGrid::Remove(int32 Element)
+{
+	FIntPoint Cell;
+	if (ElementCells.RemoveAndCopyValue(Element, Cell))
+	{
+		RemoveFromCell(Element, Cell);
+	}
+}
+
+void FNTSpatialGrid::Move(int32 Element, const FVector& Position)
+{
+	FIntPoint* CurrentCell = ElementCells.Find(Element);
+	if (!CurrentCell)
+	{
+		return;
+	}
+
+	const FIntPoint NewCell = GetCell(Position);
+	if (NewCell == *CurrentCell)
+	{
+		return;
+	}
+
+	RemoveFromCell(Element, *CurrentCell);
+	AddToCell(Element, NewCell);
+	*CurrentCell = NewCell;
+}
+
+void FNTSpatialGrid::AddToCell(int32 Element, const FIntPoint& Cell)
+{
+	Cells.FindOrAdd(Cell).Add(Element);
+}
+
+void FNTSpatialGrid::RemoveFromCell(int32 Element, const FIntPoint& Cell)
+{
+	TArray<int32>* Bucket = Cells.Find(Cell);
+	if (!Bucket)
+	{
+		return;
+	}
+
+	// Buckets are small, and order doesn't matter
+	const int32 Index = Bucket->Find(Element);
+	if (Index != INDEX_NONE)
+	{
+		Bucket->RemoveAtSwap(Index, 1, false);
+	}
+
+	if (Bucket->Num() == 0)
+	{
+		Cells.Remove(Cell);
+	}
+}
+
+int32 FNTSpatialGrid::Query(const FVector& Center, float Radius, TArray<int32>& OutElements) const
+{
+	const FIntPoint MinCell = GetCell(Center - FVector(Radius, Radius, 0.f));
+	const FIntPoint MaxCell = GetCell(Center + FVector(Radius, Radius, 0.f));
+	const float RadiusSquared = FMath::Square(Radius);
+
+	int32 NumVisited = 0;
+	for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+	{
+		for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+		{
+			// Skip the corners of the square that the circle doesn't reach
+			const float NearestX = FMath::Clamp(Center.X, X * CellSize, (X + 1) * CellSize);
+			const float NearestY = FMath::Clamp(Center.Y, Y * CellSize, (Y + 1) * CellSize);
+			if (FMath::Square(NearestX - Center.X) + FMath::Square(NearestY - Center.Y) > RadiusSquared)
+			{
+				continue;
+			}
+
+			NumVisited++;
+			const TArray<int32>* Bucket = Cells.Find(FIntPoint(X, Y));
+			if (Bucket)
+			{
+				OutElements.Append(*Bucket);
+			}
+		}
+	}
+
+	return NumVisited;
+}
+
+FNTRelevancyCache::FNTRelevancyCache()
+	: TimeSinceUpdate(0.f)
+	, bValid(false)
+{
+	const UNTNetSettings* Settings = GetDefault<UNTNetSettings>();
+	Radius = Settings->RelevancyDistance;
+	UpdateInterval = Settings->RelevancyUpdateInterval;
+}
+
+bool FNTRelevancyCache::Update(float DeltaSeconds, const FNTSpatialGrid& Grid, const FVector& ViewLocation)
+{
+	TimeSinceUpdate += DeltaSeconds;
+	if (bValid && TimeSinceUpdate < UpdateInterval)
+	{
+		return false;
+	}
+
+	TimeSinceUpdate = 0.f;
+	Relevant.Reset();
+	Grid.Query(ViewLocation, Radius, Relevant);
+	Relevant.Sort();
+	bValid = true;
+	return true;
+}
+
+void FNTRelevancyCache::Invalidate()
+{
+	Relevant.Reset();
+	bValid = false;
+}
+
+bool FNTRelevancyCache::IsRelevant(int32 Element) const
+{
+	const int32 First = FNTBinarySearch::LowerBound(Relevant.Num(), [this, Element](int32 Index) { return Relevant[Index] < Element; });
+	return First < Relevant.Num() && Relevant[First] == Element;
+}
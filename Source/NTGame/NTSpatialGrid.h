@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/**
+ * Uniform grid over the XY plane, bucketing elements (cube ids) by the cell they're in. Moving an element only touches the
+ * buckets when it crosses into another cell, so keeping it up to date every step is cheap.
+ * Queries visit the cells a circle overlaps and return everything in them - Cell granularity, not exact distance.
+ */
+struct NTGAME_API FNTSpatialGrid
+{
+	FNTSpatialGrid();
+
+	/* Empties the grid and changes the cell size */
+	void Reset(float InCellSize);
+
+	void Add(int32 Element, const FVector& Position);
+	void Remove(int32 Element);
+	void Move(int32 Element, const FVector& Position);
+
+	/* Appends every element in a cell within Radius of Center. Returns the number of cells visited. */
+	int32 Query(const FVector& Center, float Radius, TArray<int32>& OutElements) const;
+
+	int32 Num() const { return ElementCells.Num(); }
+	int32 NumCells() const { return Cells.Num(); }
+	float GetCellSize() const { return CellSize; }
+
+private:
+	FIntPoint GetCell(const FVector& Position) const
+	{
+		return FIntPoint(FMath::FloorToInt(Position.X * InvCellSize), FMath::FloorToInt(Position.Y * InvCellSize));
+	}
+
+	void AddToCell(int32 Element, const FIntPoint& Cell);
+	void RemoveFromCell(int32 Element, const FIntPoint& Cell);
+
+	TMap<FIntPoint, TArray<int32>> Cells;
+	TMap<int32, FIntPoint> ElementCells;
+
+	float CellSize;
+	float InvCellSize;
+};
+
+/**
+ * What one viewer can see, requeried from the grid every UpdateInterval rather than every time someone asks.
+ * Kept sorted, so lookups are a binary search.
+ */
+struct NTGAME_API FNTRelevancyCache
+{
+	FNTRelevancyCache();
+
+	/* Everything in a grid cell within this distance of the viewer is relevant. Starts from UNTNetSettings. */
+	float Radius;
+	float UpdateInterval;
+
+	/* Requeries when the interval is up. Returns true if it did. */
+	bool Update(float DeltaSeconds, const FNTSpatialGrid& Grid, const FVector& ViewLocation);
+
+	/* Drops the current set. Nothing is relevant through the cache until the next Update. */
+	void Invalidate();
+
+	bool IsValid() const { return bValid; }
+	bool IsRelevant(int32 Element) const;
+
+	/* Sorted element ids */
+	const TArray<int32>& GetRelevant() const { return Relevant; }
+
+private:
+	TArray<int32> Relevant;
+	float TimeSinceUpdate;
+	bool bValid;
+};
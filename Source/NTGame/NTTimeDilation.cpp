@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NTGame.h"
+#include "NTNetSettings.h"
+#include "NTTimeDilation.h"
+
+namespace
+{
+	// Without a report for this long, drift back to real time
+	const float ReportTimeout = 1.0f;
+}
+
+FNTTimeDilation::FNTTimeDilation()
+{
+	Reset();
+}
+
+void FNTTimeDilation::Reset()
+{
+	SmoothedSlack = 0.f;
+	Integral = 0.f;
+	TimeScale = 1.f;
+	TimeSinceReport = 0.f;
+	bHasReport = false;
+}
+
+void FNTTimeDilation::OnInputBufferReport(int32 Slack)
+{
+	// Depth moves a tick at a time as batches arrive, so smooth it before steering on it
+	SmoothedSlack = bHasReport ? SmoothedSlack + ((float)Slack - SmoothedSlack) * GetDefault<UNTNetSettings>()->TimeDilationSlackSmoothing : (float)Slack;
+	TimeSinceReport = 0.f;
+	bHasReport = true;
+}
+
+void FNTTimeDilation::Update(float DeltaSeconds, bool bAllowSpeedUp)
+{
+	const UNTNetSettings* Settings = GetDefault<UNTNetSettings>();
+	const float MaxAdjust = Settings->TimeDilationMaxAdjust;
+
+	TimeSinceReport += DeltaSeconds;
+	if (!bHasReport || TimeSinceReport > ReportTimeout)
+	{
+		Integral = 0.f;
+		TimeScale = FMath::FInterpConstantTo(TimeScale, 1.f, DeltaSeconds, MaxAdjust);
+		return;
+	}
+
+	// Positive slack means the Server has more of our input than it needs, so slow down
+	const float Error = -SmoothedSlack;
+
+	// Stop integrating once the output is pinned, so it can come back off the limit straight away
+	const float MaxIntegral = Settings->TimeDilationIntegralGain > 0.f ? MaxAdjust / Settings->TimeDilationIntegralGain : 0.f;
+	Integral = FMath::Clamp(Integral + Error * DeltaSeconds, -MaxIntegral, bAllowSpeedUp ? MaxIntegral : 0.f);
+
+	const float Adjust = Error * Settings->TimeDilationProportionalGain + Integral * Settings->TimeDilationIntegralGain;
+	TimeScale = 1.f + FMath::Clamp(Adjust, -MaxAdjust, bAllowSpeedUp ? MaxAdjust : 0.f);
+}
@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/**
+ * Client - Runs our simulation slightly fast or slow so the Server's input buffer for us sits at its target depth.
+ * Too deep and our inputs wait around on the Server, adding latency. Too shallow and the Server runs out of input.
+ *
+ * A PI controller on the slack the Server reports with each ServerMoveData. The output is a time scale a few percent
+ * either side of 1, so the change in rate is never noticeable.
+ */
+struct NTGAME_API FNTTimeDilation
+{
+	FNTTimeDilation();
+
+	void Reset();
+
+	/* Server input buffer depth minus its target, in ticks */
+	void OnInputBufferReport(int32 Slack);
+
+	/* bAllowSpeedUp is false once we're as far ahead of the Server as prediction allows */
+	void Update(float DeltaSeconds, bool bAllowSpeedUp);
+
+	float GetTimeScale() const { return TimeScale; }
+	float GetSmoothedSlack() const { return SmoothedSlack; }
+
+private:
+	float SmoothedSlack;
+	float Integral;
+	float TimeScale;
+
+	/* Time since the last report. Reports stop when ServerMoveData does, and we shouldn't steer on old news. */
+	float TimeSinceReport;
+	bool bHasReport;
+};